@@ -8,11 +8,63 @@ TEMPLATE = app
 SOURCES += \
     main.cpp \
     mainwindow.cpp \
-    frangiglwidget.cpp
+    frangiglwidget.cpp \
+    frangipipeline.cpp \
+    frangiengine.cpp \
+    frangicenterline.cpp \
+    frangicpupipeline.cpp \
+    frangicpukernels.cpp \
+    frangireadback.cpp \
+    frangiframequeue.cpp \
+    frangiframesource.cpp \
+    frangilatency.cpp \
+    frangiprofiler.cpp \
+    frangirecording.cpp \
+    frangireference.cpp \
+    frangischeduler.cpp \
+    frangishadermanager.cpp \
+    frangitargetpool.cpp \
+    frangitemporal.cpp \
+    frangitiledprocessor.cpp \
+    frangivesselgraph.cpp \
+    captureworker.cpp \
+    offlinerunner.cpp
 
 HEADERS += \
     mainwindow.h \
-    frangiglwidget.h
+    frangiglwidget.h \
+    frangipipeline.h \
+    frangiengine.h \
+    frangicenterline.h \
+    frangicpupipeline.h \
+    frangicpukernels.h \
+    frangicpukernels_impl.h \
+    frangigaussian.h \
+    frangiframe.h \
+    frangireadback.h \
+    frangiframequeue.h \
+    frangiframesource.h \
+    frangilatency.h \
+    frangiprofiler.h \
+    frangiprecision.h \
+    frangirecording.h \
+    frangireference.h \
+    frangischeduler.h \
+    frangishadermanager.h \
+    frangitargetpool.h \
+    frangitemporal.h \
+    frangitiledprocessor.h \
+    frangivesselgraph.h \
+    captureworker.h \
+    offlinerunner.h
+
+# AVX2 ядра собираются отдельно и выбираются во время выполнения по CPUID
+contains(QT_ARCH, x86_64)|contains(QT_ARCH, i386) {
+    CONFIG += simd
+    AVX2_SOURCES += frangicpukernels_avx2.cpp
+    !msvc: QMAKE_CFLAGS_AVX2 += -mfma
+    DEFINES += FRANGI_CPU_AVX2
+}
 
 # Правила по умолчанию для развертывания
 qnx: target.path = /tmp/$${TARGET}/bin
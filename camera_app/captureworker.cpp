@@ -0,0 +1,189 @@
+#include "captureworker.h"
+#include "frangilatency.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QVideoFrameFormat>
+
+// Плоскости отображенного кадра камеры (без копий).
+// Для форматов, которые конвейер не распаковывает, - невалидный вид
+static FrangiFrameView frameViewFromVideoFrame(const QVideoFrame &frame)
+{
+    FrangiFrameView view;
+    switch (frame.pixelFormat()) {
+        case QVideoFrameFormat::Format_NV12: view.format = FrangiFrameView::FormatNv12; break;
+        case QVideoFrameFormat::Format_YUYV: view.format = FrangiFrameView::FormatYuyv; break;
+        case QVideoFrameFormat::Format_UYVY: view.format = FrangiFrameView::FormatUyvy; break;
+        case QVideoFrameFormat::Format_RGBX8888:
+        case QVideoFrameFormat::Format_RGBA8888: view.format = FrangiFrameView::FormatRgbx; break;
+        case QVideoFrameFormat::Format_BGRX8888:
+        case QVideoFrameFormat::Format_BGRA8888: view.format = FrangiFrameView::FormatBgrx; break;
+        default: return view;
+    }
+    
+    view.width = frame.width();
+    view.height = frame.height();
+    for (int plane = 0; plane < qMin(frame.planeCount(), 2); ++plane) {
+        view.planes[plane] = frame.bits(plane);
+        view.strides[plane] = frame.bytesPerLine(plane);
+    }
+    view.timestamp = qMax<qint64>(frame.startTime(), 0);
+    return view;
+}
+
+CaptureWorker::CaptureWorker(FrangiFrameQueue *queue, QObject *parent)
+    : QObject(parent)
+    , m_queue(queue)
+    , m_pendingArrival(0)
+    , m_scheduled(false)
+    , m_buffer(nullptr)
+    , m_notified(false)
+    , m_source(nullptr)
+    , m_sourceTimer(nullptr)
+    , m_latencyPattern(false)
+{
+}
+
+CaptureWorker::~CaptureWorker()
+{
+    delete m_source;
+}
+
+void CaptureWorker::submit(const QVideoFrame &frame)
+{
+    if (!frame.isValid()) return;
+    
+    QMutexLocker locker(&m_mutex);
+    if (m_pending.isValid()) {
+        m_queue->countDropped();
+    }
+    m_pending = frame;
+    m_pendingArrival = frangiMonotonicTime();
+    
+    if (!m_scheduled) {
+        m_scheduled = true;
+        QMetaObject::invokeMethod(this, &CaptureWorker::processPending, Qt::QueuedConnection);
+    }
+}
+
+void CaptureWorker::playSource(FrangiFrameSource *source, double frameRate)
+{
+    delete m_source;
+    m_source = source;
+    
+    if (!m_sourceTimer) {
+        m_sourceTimer = new QTimer(this);
+        m_sourceTimer->setTimerType(Qt::PreciseTimer);
+        connect(m_sourceTimer, &QTimer::timeout, this, &CaptureWorker::readSourceFrame);
+    }
+    m_sourceTimer->start(qMax(1, qRound(1000.0 / frameRate)));
+}
+
+void CaptureWorker::readSourceFrame()
+{
+    const qint64 arrival = frangiMonotonicTime();
+    FrangiFrameView view;
+    if (!m_source->read(&view)) {
+        // Конец последовательности: воспроизводим по кругу
+        if (!m_source->rewind() || !m_source->read(&view)) {
+            qDebug() << "CaptureWorker: input stopped:" << m_source->errorString();
+            m_sourceTimer->stop();
+            return;
+        }
+    }
+    
+    FrangiFrameBuffer *buffer = takeBuffer();
+    if (!buffer) return;
+    QElapsedTimer timer;
+    timer.start();
+    buffer->assign(view);
+    buffer->arrivalTime = arrival;
+    if (m_latencyPattern.load(std::memory_order_relaxed)) {
+        frangiStampLatencyPattern(buffer, arrival / 1000000);
+    }
+    buffer->captureTime = timer.nsecsElapsed() / 1e6;
+    // Источник отдает форматы конвейера, конвертации нет
+    buffer->convertTime = 0.0;
+    publish();
+}
+
+void CaptureWorker::processPending()
+{
+    QVideoFrame frame;
+    qint64 arrival = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        frame = m_pending;
+        arrival = m_pendingArrival;
+        m_pending = QVideoFrame();
+        m_scheduled = false;
+    }
+    if (!frame.isValid()) return;
+    
+    FrangiFrameBuffer *buffer = takeBuffer();
+    if (!buffer) return;
+    
+    if (!convert(frame, buffer)) {
+        m_queue->countDropped();
+        return;
+    }
+    buffer->arrivalTime = arrival;
+    publish();
+}
+
+FrangiFrameBuffer *CaptureWorker::takeBuffer()
+{
+    // Буфер остается у worker'а до publish(), даже если кадр не удался
+    if (!m_buffer) {
+        m_buffer = m_queue->acquire();
+    }
+    if (!m_buffer) {
+        // Consumer держит больше буферов, чем рассчитан пул
+        qDebug() << "CaptureWorker: frame pool is empty";
+        m_queue->countDropped();
+    }
+    return m_buffer;
+}
+
+void CaptureWorker::publish()
+{
+    m_queue->push(m_buffer);
+    m_buffer = nullptr;
+    
+    if (!m_notified.exchange(true, std::memory_order_acq_rel)) {
+        emit frameReady();
+    }
+}
+
+bool CaptureWorker::convert(const QVideoFrame &frame, FrangiFrameBuffer *buffer)
+{
+    QElapsedTimer timer;
+    timer.start();
+    
+    QVideoFrame mapped(frame);
+    if (!mapped.map(QVideoFrame::ReadOnly)) {
+        qDebug() << "CaptureWorker: failed to map frame";
+        return false;
+    }
+    
+    // Плоскости копируются как есть: YUV -> RGB и переворот делает GPU
+    const FrangiFrameView view = frameViewFromVideoFrame(mapped);
+    if (view.isValid()) {
+        buffer->assign(view);
+    }
+    mapped.unmap();
+    buffer->captureTime = timer.nsecsElapsed() / 1e6;
+    timer.start();
+    
+    if (!view.isValid()) {
+        // Формат камеры, который конвейер не читает напрямую - через RGBX копию
+        const QImage image = frame.toImage();
+        if (image.isNull()) return false;
+        m_converted = image.convertToFormat(QImage::Format_RGBX8888);
+        FrangiFrameView converted = FrangiFrameView::fromImage(m_converted);
+        converted.timestamp = qMax<qint64>(frame.startTime(), 0);
+        buffer->assign(converted);
+    }
+    buffer->convertTime = timer.nsecsElapsed() / 1e6;
+    return true;
+}
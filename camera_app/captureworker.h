@@ -0,0 +1,73 @@
+#ifndef CAPTUREWORKER_H
+#define CAPTUREWORKER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QVideoFrame>
+#include <QTimer>
+#include <atomic>
+#include "frangiframequeue.h"
+#include "frangiframesource.h"
+
+// Разбор кадров камеры вне GUI потока. Живет в отдельном QThread:
+// отображает QVideoFrame, копирует плоскости в буфер пула FrangiFrameQueue
+// и публикует кадр в очередь. GUI поток получает frameReady()
+// и забирает самый новый кадр через takeLatest().
+class CaptureWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CaptureWorker(FrangiFrameQueue *queue, QObject *parent = nullptr);
+    ~CaptureWorker();
+
+    // Вызывается в потоке источника кадров (Qt::DirectConnection): запоминает
+    // кадр и будит поток захвата. Еще не разобранный предыдущий кадр
+    // отбрасывается, поэтому события не копятся, если разбор не успевает
+    void submit(const QVideoFrame &frame);
+
+    // Воспроизводит файловый источник по кругу с частотой frameRate вместо
+    // камеры (worker становится владельцем). Вызывать в потоке захвата
+    void playSource(FrangiFrameSource *source, double frameRate);
+    // Тестовый режим задержки: кадры файлового источника получают шаблон
+    // времени прихода (frangiStampLatencyPattern), как если бы камера снимала
+    // экран с этим шаблоном. Можно вызывать из любого потока
+    void setLatencyPatternEnabled(bool enabled) { m_latencyPattern.store(enabled, std::memory_order_relaxed); }
+
+    // Consumer вызывает перед takeLatest(): следующий кадр снова пришлет frameReady()
+    void acknowledge() { m_notified.store(false, std::memory_order_release); }
+
+signals:
+    // Одно уведомление на пачку кадров, пока consumer не вызвал acknowledge()
+    void frameReady();
+
+private slots:
+    void processPending();
+    void readSourceFrame();
+
+private:
+    bool convert(const QVideoFrame &frame, FrangiFrameBuffer *buffer);
+    FrangiFrameBuffer *takeBuffer();
+    void publish();
+
+    FrangiFrameQueue *m_queue;
+
+    // Последний пришедший кадр (под m_mutex)
+    QMutex m_mutex;
+    QVideoFrame m_pending;
+    qint64 m_pendingArrival;
+    bool m_scheduled;
+
+    // Буфер пула, который сейчас заполняет поток захвата
+    FrangiFrameBuffer *m_buffer;
+    // RGBX копия кадра для форматов, которые конвейер не читает напрямую
+    QImage m_converted;
+    std::atomic<bool> m_notified;
+
+    // Файловый источник и таймер его кадров
+    FrangiFrameSource *m_source;
+    QTimer *m_sourceTimer;
+    std::atomic<bool> m_latencyPattern;
+};
+
+#endif // CAPTUREWORKER_H
@@ -0,0 +1,296 @@
+// Бенчмарки конвейера Frangi (Google Benchmark): stage'и и весь конвейер
+// на синтетических кадрах для GL и CPU backend'ов.
+//
+//   ./frangi_bench --benchmark_out=frangi.json --benchmark_out_format=json
+//   ./frangi_bench --benchmark_filter='cpu/pipeline/.*'
+//   ./frangi_bench --benchmark_filter='gl/blur/.*'   # fragment и compute blur
+//
+// Stage'и меряются FrangiProfiler'ом (GPU - GL_TIME_ELAPSED, CPU - QElapsedTimer)
+// и отдаются как manual time, весь конвейер - по настенному времени
+// FrangiEngine::process() с синхронным чтением результата.
+#include <benchmark/benchmark.h>
+#include <QGuiApplication>
+#include <QImage>
+#include <QMap>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include <cmath>
+#include "frangiengine.h"
+
+namespace {
+
+const QSize kResolutions[] = {
+    QSize(320, 240),
+    QSize(640, 480),
+    QSize(1920, 1080),
+    QSize(3840, 2160)
+};
+
+const float kBlurSigmas[] = { 1.5f, 3.0f, 6.0f, 10.0f };
+// Масштабирование по числу потоков (кадры 640x480)
+const int kStreamCounts[] = { 1, 2, 4, 8 };
+const float kDefaultSigma = 1.5f;
+
+struct StageInfo
+{
+    const char *name;
+    FrangiProfiler::Section sections[4];
+    int sectionCount;
+};
+
+// Время stage'а - сумма выполненных в кадре sections. Blur включает
+// grayscale и invert: compute путь делает их при загрузке строки в blur X,
+// поэтому fragment и compute пути сравниваются по одной и той же работе
+const StageInfo kStages[] = {
+    { "grayscale", { FrangiProfiler::SectionGrayscale }, 1 },
+    { "blur", { FrangiProfiler::SectionGrayscale, FrangiProfiler::SectionInvert,
+                FrangiProfiler::SectionBlurX, FrangiProfiler::SectionBlurY }, 4 },
+    { "gradients", { FrangiProfiler::SectionGradients }, 1 },
+    { "hessian", { FrangiProfiler::SectionHessian }, 1 },
+    { "eigenvalues", { FrangiProfiler::SectionEigenvalues }, 1 },
+    { "vesselness", { FrangiProfiler::SectionVesselness }, 1 },
+    { "overlay", { FrangiProfiler::SectionOverlay }, 1 }
+};
+
+// Движки создаются один раз на backend: контекст и шейдеры не пересоздаются
+// между бенчмарками, FBO/буферы - только при смене разрешения
+QMap<int, FrangiEngine *> engines;
+QMap<int, FrangiEngine *> failedEngines;
+
+FrangiEngine *engineFor(FrangiEngine::Backend backend)
+{
+    if (engines.contains(backend)) return engines.value(backend);
+    if (failedEngines.contains(backend)) return nullptr;
+    
+    FrangiEngine *engine = new FrangiEngine();
+    engine->setBackend(backend);
+    if (!engine->initialize()) {
+        failedEngines.insert(backend, engine);
+        return nullptr;
+    }
+    engine->setBeta(0.5f);
+    engine->setC(15.0f);
+    engine->setInvertEnabled(true);
+    engine->profiler()->setEnabled(true);
+    engines.insert(backend, engine);
+    return engine;
+}
+
+// Темные извилистые сосуды разной ширины на неоднородном светлом фоне
+// с детерминированным шумом
+const QImage &syntheticFrame(const QSize &size)
+{
+    static QMap<qint64, QImage> frames;
+    const qint64 key = qint64(size.width()) << 32 | size.height();
+    if (frames.contains(key)) return frames[key];
+    
+    QImage image(size, QImage::Format_RGBX8888);
+    const int vesselCount = 12;
+    quint32 seed = 12345;
+    for (int y = 0; y < size.height(); ++y) {
+        uchar *line = image.scanLine(y);
+        const float v = float(y) / size.height();
+        for (int x = 0; x < size.width(); ++x) {
+            const float u = float(x) / size.width();
+            float value = 190.0f + 30.0f * std::sin(3.0f * u + 2.0f * v);
+            for (int i = 0; i < vesselCount; ++i) {
+                const float center = (i + 0.5f) / vesselCount + 0.03f * std::sin(12.0f * u + i);
+                const float width = (1.0f + i % 4) / size.height();
+                const float distance = (v - center) / width;
+                value -= 90.0f * std::exp(-0.5f * distance * distance);
+            }
+            seed = seed * 1664525u + 1013904223u;
+            value += float(seed >> 28) - 7.5f;
+            const uchar gray = uchar(qBound(0.0f, value, 255.0f));
+            line[4 * x + 0] = gray;
+            line[4 * x + 1] = uchar(gray * 0.8f);
+            line[4 * x + 2] = uchar(gray * 0.7f);
+            line[4 * x + 3] = 255;
+        }
+    }
+    frames.insert(key, image);
+    return frames[key];
+}
+
+void setThroughput(benchmark::State &state, const QSize &size)
+{
+    const double pixels = double(size.width()) * size.height();
+    state.counters["Mpix/s"] = benchmark::Counter(pixels * state.iterations() / 1e6,
+                                                  benchmark::Counter::kIsRate);
+    state.counters["pixels"] = pixels;
+}
+
+// Весь конвейер: загрузка кадра, все passes и чтение vesselness
+void benchmarkPipeline(benchmark::State &state, FrangiEngine::Backend backend, QSize size)
+{
+    FrangiEngine *engine = engineFor(backend);
+    if (!engine) {
+        state.SkipWithError("backend is not available");
+        return;
+    }
+    engine->setSigma(kDefaultSigma);
+    engine->setFusedEnabled(true);
+    
+    const FrangiFrameView frame = FrangiFrameView::fromImage(syntheticFrame(size));
+    engine->process(frame);  // прогрев: FBO и буферы под разрешение
+    
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(engine->process(frame));
+    }
+    engine->flushProfiler();
+    setThroughput(state, size);
+}
+
+// N потоков одним вызовом process(): Mpix/s по всем кадрам. Близкий к
+// линейному рост с числом потоков - пока GPU/CPU не насыщен
+void benchmarkStreams(benchmark::State &state, FrangiEngine::Backend backend, QSize size, int streamCount)
+{
+    FrangiEngine *engine = engineFor(backend);
+    if (!engine) {
+        state.SkipWithError("backend is not available");
+        return;
+    }
+    engine->setSigma(kDefaultSigma);
+    engine->setFusedEnabled(true);
+    
+    const QVector<FrangiFrameView> frames(streamCount, FrangiFrameView::fromImage(syntheticFrame(size)));
+    engine->process(frames);  // прогрев: атлас под число потоков
+    
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(engine->process(frames));
+    }
+    engine->flushProfiler();
+    setThroughput(state, QSize(size.width() * streamCount, size.height()));
+    state.counters["streams"] = streamCount;
+}
+
+// Отдельный stage: время берется из профайлера после каждого кадра.
+// Fused режим выключен, чтобы gradients/hessian/eigenvalues шли отдельными passes.
+// compute - compute путь blur'а GL backend'а вместо fragment passes
+void benchmarkStage(benchmark::State &state, FrangiEngine::Backend backend, QSize size,
+                    StageInfo stage, float sigma, bool compute)
+{
+    FrangiEngine *engine = engineFor(backend);
+    if (!engine) {
+        state.SkipWithError("backend is not available");
+        return;
+    }
+    if (compute && !engine->isComputeAvailable()) {
+        state.SkipWithError("compute shaders are not available");
+        return;
+    }
+    engine->setSigma(sigma);
+    engine->setFusedEnabled(false);
+    engine->setComputeEnabled(compute);
+    
+    const FrangiFrameView frame = FrangiFrameView::fromImage(syntheticFrame(size));
+    engine->process(frame);
+    engine->flushProfiler();
+    
+    FrangiProfiler *profiler = engine->profiler();
+    if (backend == FrangiEngine::BackendOpenGL && !profiler->gpuTimingAvailable()) {
+        state.SkipWithError("GPU timer queries are not available");
+        return;
+    }
+    
+    for (auto _ : state) {
+        engine->process(frame);
+        engine->flushProfiler();
+        
+        double milliseconds = 0.0;
+        bool measured = false;
+        for (int i = 0; i < stage.sectionCount; ++i) {
+            const double time = profiler->lastTime(stage.sections[i]);
+            if (time < 0.0) continue;
+            milliseconds += time;
+            measured = true;
+        }
+        if (!measured) {
+            state.SkipWithError("stage does not run as a separate pass in this backend");
+            break;
+        }
+        state.SetIterationTime(milliseconds / 1e3);
+    }
+    setThroughput(state, size);
+}
+
+void registerBenchmarks()
+{
+    const struct {
+        const char *name;
+        FrangiEngine::Backend backend;
+    } backends[] = {
+        { "gl", FrangiEngine::BackendOpenGL },
+        { "cpu", FrangiEngine::BackendCpu }
+    };
+    
+    for (const auto &backend : backends) {
+        for (const QSize &size : kResolutions) {
+            const QString resolution = QString("%1x%2").arg(size.width()).arg(size.height());
+            
+            benchmark::RegisterBenchmark(
+                    QString("%1/pipeline/%2").arg(backend.name, resolution).toUtf8().constData(),
+                    benchmarkPipeline, backend.backend, size)
+                ->Unit(benchmark::kMillisecond)
+                ->UseRealTime();
+            
+            if (size == QSize(640, 480)) {
+                for (int streamCount : kStreamCounts) {
+                    benchmark::RegisterBenchmark(
+                            QString("%1/streams:%2/%3").arg(backend.name).arg(streamCount).arg(resolution)
+                                .toUtf8().constData(),
+                            benchmarkStreams, backend.backend, size, streamCount)
+                        ->Unit(benchmark::kMillisecond)
+                        ->UseRealTime();
+                }
+            }
+            
+            for (const StageInfo &stage : kStages) {
+                const QString name = QString("%1/%2/%3").arg(backend.name, stage.name, resolution);
+                
+                // Стоимость blur растет с радиусом ядра - меряем несколько sigma,
+                // в GL backend'е - fragment и compute путь
+                if (qstrcmp(stage.name, "blur") == 0) {
+                    for (float sigma : kBlurSigmas) {
+                        for (bool compute : { false, true }) {
+                            if (compute && backend.backend != FrangiEngine::BackendOpenGL) continue;
+                            const QString path = backend.backend != FrangiEngine::BackendOpenGL ? QString()
+                                                 : compute ? QString("/compute") : QString("/fragment");
+                            benchmark::RegisterBenchmark(
+                                    QString("%1%2/sigma:%3").arg(name, path).arg(sigma).toUtf8().constData(),
+                                    benchmarkStage, backend.backend, size, stage, sigma, compute)
+                                ->Unit(benchmark::kMillisecond)
+                                ->UseManualTime();
+                        }
+                    }
+                } else {
+                    benchmark::RegisterBenchmark(name.toUtf8().constData(),
+                                                 benchmarkStage, backend.backend, size, stage, kDefaultSigma, false)
+                        ->Unit(benchmark::kMillisecond)
+                        ->UseManualTime();
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // Offscreen контекст без дисплея (EGL/surfaceless, llvmpipe)
+    FrangiEngine::prepareHeadlessEnvironment();
+    QGuiApplication app(argc, argv);
+    
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    
+    registerBenchmarks();
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    
+    qDeleteAll(engines);
+    qDeleteAll(failedEngines);
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include "frangicenterline.h"
+#include <cmath>
+
+namespace {
+
+inline float sampleClamped(const float *v, int width, int height, int x, int y)
+{
+    return v[qBound(0, y, height - 1) * width + qBound(0, x, width - 1)];
+}
+
+// Билинейная выборка в центрах пикселей, как mix() texelFetch'ей в шейдере
+inline float sampleBilinear(const float *v, int width, int height, float x, float y)
+{
+    const int x0 = int(std::floor(x));
+    const int y0 = int(std::floor(y));
+    const float tx = x - x0;
+    const float ty = y - y0;
+    const float top = sampleClamped(v, width, height, x0, y0) +
+                      (sampleClamped(v, width, height, x0 + 1, y0) - sampleClamped(v, width, height, x0, y0)) * tx;
+    const float bottom = sampleClamped(v, width, height, x0, y0 + 1) +
+                         (sampleClamped(v, width, height, x0 + 1, y0 + 1) - sampleClamped(v, width, height, x0, y0 + 1)) * tx;
+    return top + (bottom - top) * ty;
+}
+
+// Пиксель маски вне кадра - фон
+inline bool isForeground(const uchar *mask, int width, int height, int x, int y)
+{
+    return x >= 0 && y >= 0 && x < width && y < height && mask[y * width + x] == kFrangiCenterlineStrong;
+}
+
+} // namespace
+
+void frangiCenterlineNmsRows(const float *vesselness, uchar *mask, int width, int height,
+                             int begin, int end, const FrangiCenterlineParams &params)
+{
+    for (int y = begin; y < end; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const float v = vesselness[y * width + x];
+            uchar result = 0;
+            if (v >= params.lowThreshold) {
+                // Hessian vesselness: поперек гребня кривизна наибольшая по модулю
+                const float dxx = sampleClamped(vesselness, width, height, x + 1, y) +
+                                  sampleClamped(vesselness, width, height, x - 1, y) - 2.0f * v;
+                const float dyy = sampleClamped(vesselness, width, height, x, y + 1) +
+                                  sampleClamped(vesselness, width, height, x, y - 1) - 2.0f * v;
+                const float dxy = (sampleClamped(vesselness, width, height, x + 1, y + 1) -
+                                   sampleClamped(vesselness, width, height, x + 1, y - 1) -
+                                   sampleClamped(vesselness, width, height, x - 1, y + 1) +
+                                   sampleClamped(vesselness, width, height, x - 1, y - 1)) * 0.25f;
+                const float half = 0.5f * (dxx - dyy);
+                const float lambda = 0.5f * (dxx + dyy) - std::sqrt(half * half + dxy * dxy);
+                
+                // Из двух форм собственного вектора берется более длинная
+                float nx = dxy;
+                float ny = lambda - dxx;
+                if (nx * nx + ny * ny < (lambda - dyy) * (lambda - dyy) + dxy * dxy) {
+                    nx = lambda - dyy;
+                    ny = dxy;
+                }
+                const float length = std::sqrt(nx * nx + ny * ny);
+                if (length > 1e-12f) {
+                    nx /= length;
+                    ny /= length;
+                } else {
+                    nx = 1.0f;
+                    ny = 0.0f;
+                }
+                // Вектор смотрит вправо (или вниз кадра), как в шейдере с осью y вверх
+                if (nx < 0.0f || (nx == 0.0f && ny < 0.0f)) {
+                    nx = -nx;
+                    ny = -ny;
+                }
+                
+                // Несимметричное сравнение: на плато шириной 2 остается один пиксель
+                const float ahead = sampleBilinear(vesselness, width, height, x + nx, y + ny);
+                const float behind = sampleBilinear(vesselness, width, height, x - nx, y - ny);
+                if (v > ahead && v >= behind) {
+                    result = v >= params.highThreshold ? kFrangiCenterlineStrong : kFrangiCenterlineWeak;
+                }
+            }
+            mask[y * width + x] = result;
+        }
+    }
+}
+
+bool frangiHysteresisRows(const uchar *src, uchar *dst, int width, int height, int begin, int end)
+{
+    bool changed = false;
+    for (int y = begin; y < end; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uchar value = src[y * width + x];
+            if (value == kFrangiCenterlineWeak) {
+                for (int dy = -1; dy <= 1 && value != kFrangiCenterlineStrong; ++dy) {
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        if (isForeground(src, width, height, x + dx, y + dy)) {
+                            value = kFrangiCenterlineStrong;
+                            changed = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            dst[y * width + x] = value;
+        }
+    }
+    return changed;
+}
+
+bool frangiThinningRows(const uchar *src, uchar *dst, int width, int height, int begin, int end,
+                        int subiteration)
+{
+    bool changed = false;
+    for (int y = begin; y < end; ++y) {
+        for (int x = 0; x < width; ++x) {
+            if (!isForeground(src, width, height, x, y)) {
+                dst[y * width + x] = 0;
+                continue;
+            }
+            
+            // Соседи P2..P9 по часовой стрелке, начиная с севера
+            const bool p[8] = {
+                isForeground(src, width, height, x, y - 1),
+                isForeground(src, width, height, x + 1, y - 1),
+                isForeground(src, width, height, x + 1, y),
+                isForeground(src, width, height, x + 1, y + 1),
+                isForeground(src, width, height, x, y + 1),
+                isForeground(src, width, height, x - 1, y + 1),
+                isForeground(src, width, height, x - 1, y),
+                isForeground(src, width, height, x - 1, y - 1)
+            };
+            int neighbours = 0;
+            int transitions = 0;
+            for (int i = 0; i < 8; ++i) {
+                neighbours += p[i];
+                transitions += !p[i] && p[(i + 1) % 8];
+            }
+            
+            // P2, P4, P6, P8 = p[0], p[2], p[4], p[6]
+            const bool side = subiteration == 0 ? !(p[0] && p[2] && p[4]) && !(p[2] && p[4] && p[6])
+                                                : !(p[0] && p[2] && p[6]) && !(p[0] && p[4] && p[6]);
+            const bool remove = neighbours >= 2 && neighbours <= 6 && transitions == 1 && side;
+            dst[y * width + x] = remove ? 0 : kFrangiCenterlineStrong;
+            changed = changed || remove;
+        }
+    }
+    return changed;
+}
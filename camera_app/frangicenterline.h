@@ -0,0 +1,57 @@
+#ifndef FRANGICENTERLINE_H
+#define FRANGICENTERLINE_H
+
+#include <QtGlobal>
+
+// Выделение осевых линий сосудов по карте vesselness (stage Centerline):
+//  1. NMS: пиксель остается, если vesselness не меньше соседей поперек
+//     сосуда (собственный вектор Hessian'а vesselness с наибольшей по модулю
+//     кривизной) и выше low порога; выше high - сильный, иначе слабый;
+//  2. гистерезис: слабые пиксели, связанные с сильными, становятся сильными
+//     (pass - один пиксель распространения), оставшиеся слабые отбрасываются;
+//  3. параллельное утончение Zhang-Suen до 8-связного скелета в один пиксель.
+// Функции ниже - CPU версии шейдеров FrangiPipeline для полосы строк
+// [begin, end): маски width*height сверху вниз, "север" - строка y - 1
+// (вверх в GL). Результат совпадает с GL побитово, кроме vesselness,
+// равной соседу с точностью округления.
+
+struct FrangiCenterlineParams
+{
+    // Пороги по vesselness (для single-scale с c = 15 значения сосудов ~0.01,
+    // multi-scale дает значения порядка единицы)
+    float lowThreshold = 0.003f;
+    float highThreshold = 0.01f;
+    // Pass'ов гистерезиса: слабая цепочка длиннее не присоединяется
+    int hysteresisIterations = 16;
+    // Итераций утончения (по два подпрохода), не меньше одной: после NMS
+    // линии шириной 1-2 пикселя
+    int thinningIterations = 3;
+
+    bool operator==(const FrangiCenterlineParams &other) const
+    {
+        return lowThreshold == other.lowThreshold && highThreshold == other.highThreshold &&
+               hysteresisIterations == other.hysteresisIterations &&
+               thinningIterations == other.thinningIterations;
+    }
+    bool operator!=(const FrangiCenterlineParams &other) const { return !(*this == other); }
+};
+
+// Значения масок: кандидаты NMS и скелет (только Strong)
+const uchar kFrangiCenterlineWeak = 128;
+const uchar kFrangiCenterlineStrong = 255;
+
+// NMS и пороги: vesselness -> маска 0/Weak/Strong
+void frangiCenterlineNmsRows(const float *vesselness, uchar *mask, int width, int height,
+                             int begin, int end, const FrangiCenterlineParams &params);
+
+// Один pass гистерезиса: Weak с сильным 8-соседом становится Strong.
+// Возвращает true, если в полосе что-то изменилось
+bool frangiHysteresisRows(const uchar *src, uchar *dst, int width, int height, int begin, int end);
+
+// Подпроход Zhang-Suen (subiteration 0 или 1). Передним планом считается
+// только Strong, поэтому первый подпроход заодно отбрасывает слабые пиксели.
+// Возвращает true, если в полосе удалены пиксели
+bool frangiThinningRows(const uchar *src, uchar *dst, int width, int height, int begin, int end,
+                        int subiteration);
+
+#endif // FRANGICENTERLINE_H
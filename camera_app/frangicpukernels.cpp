@@ -0,0 +1,159 @@
+#include "frangicpukernels.h"
+#include "frangicpukernels_impl.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRANGI_CPU_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define FRANGI_CPU_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#ifdef FRANGI_CPU_AVX2
+// frangicpukernels_avx2.cpp
+const FrangiCpuKernels &frangiCpuKernelsAvx2();
+#endif
+
+namespace {
+
+struct ScalarOps
+{
+    typedef float Type;
+    typedef bool Mask;
+    enum { Width = 1 };
+
+    static float set1(float v) { return v; }
+    static float loadu(const float *p) { return *p; }
+    static void storeu(float *p, float v) { *p = v; }
+    static float add(float a, float b) { return a + b; }
+    static float sub(float a, float b) { return a - b; }
+    static float mul(float a, float b) { return a * b; }
+    static float div(float a, float b) { return a / b; }
+    static float fmadd(float a, float b, float c) { return a * b + c; }
+    static float min(float a, float b) { return a < b ? a : b; }
+    static float max(float a, float b) { return a > b ? a : b; }
+    static float sqrt(float a) { return std::sqrt(a); }
+    static float abs(float a) { return std::fabs(a); }
+    static bool less(float a, float b) { return a < b; }
+    static float select(bool m, float a, float b) { return m ? a : b; }
+    static float round(float a) { return std::nearbyint(a); }
+    static float ldexp2(float y, float n) { return std::ldexp(y, int(n)); }
+};
+
+#ifdef FRANGI_CPU_SSE2
+struct Sse2Ops
+{
+    typedef __m128 Type;
+    typedef __m128 Mask;
+    enum { Width = 4 };
+
+    static __m128 set1(float v) { return _mm_set1_ps(v); }
+    static __m128 loadu(const float *p) { return _mm_loadu_ps(p); }
+    static void storeu(float *p, __m128 v) { _mm_storeu_ps(p, v); }
+    static __m128 add(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+    static __m128 sub(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+    static __m128 mul(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+    static __m128 div(__m128 a, __m128 b) { return _mm_div_ps(a, b); }
+    static __m128 fmadd(__m128 a, __m128 b, __m128 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static __m128 min(__m128 a, __m128 b) { return _mm_min_ps(a, b); }
+    static __m128 max(__m128 a, __m128 b) { return _mm_max_ps(a, b); }
+    static __m128 sqrt(__m128 a) { return _mm_sqrt_ps(a); }
+    static __m128 abs(__m128 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static __m128 less(__m128 a, __m128 b) { return _mm_cmplt_ps(a, b); }
+    static __m128 select(__m128 m, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+    }
+    static __m128 round(__m128 a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+    static __m128 ldexp2(__m128 y, __m128 n)
+    {
+        __m128i e = _mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127)), 23);
+        return _mm_mul_ps(y, _mm_castsi128_ps(e));
+    }
+};
+#endif
+
+#ifdef FRANGI_CPU_NEON
+struct NeonOps
+{
+    typedef float32x4_t Type;
+    typedef uint32x4_t Mask;
+    enum { Width = 4 };
+
+    static float32x4_t set1(float v) { return vdupq_n_f32(v); }
+    static float32x4_t loadu(const float *p) { return vld1q_f32(p); }
+    static void storeu(float *p, float32x4_t v) { vst1q_f32(p, v); }
+    static float32x4_t add(float32x4_t a, float32x4_t b) { return vaddq_f32(a, b); }
+    static float32x4_t sub(float32x4_t a, float32x4_t b) { return vsubq_f32(a, b); }
+    static float32x4_t mul(float32x4_t a, float32x4_t b) { return vmulq_f32(a, b); }
+    static float32x4_t div(float32x4_t a, float32x4_t b) { return vdivq_f32(a, b); }
+    static float32x4_t fmadd(float32x4_t a, float32x4_t b, float32x4_t c) { return vfmaq_f32(c, a, b); }
+    static float32x4_t min(float32x4_t a, float32x4_t b) { return vminq_f32(a, b); }
+    static float32x4_t max(float32x4_t a, float32x4_t b) { return vmaxq_f32(a, b); }
+    static float32x4_t sqrt(float32x4_t a) { return vsqrtq_f32(a); }
+    static float32x4_t abs(float32x4_t a) { return vabsq_f32(a); }
+    static uint32x4_t less(float32x4_t a, float32x4_t b) { return vcltq_f32(a, b); }
+    static float32x4_t select(uint32x4_t m, float32x4_t a, float32x4_t b) { return vbslq_f32(m, a, b); }
+    static float32x4_t round(float32x4_t a) { return vrndnq_f32(a); }
+    static float32x4_t ldexp2(float32x4_t y, float32x4_t n)
+    {
+        int32x4_t e = vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127)), 23);
+        return vmulq_f32(y, vreinterpretq_f32_s32(e));
+    }
+};
+#endif
+
+bool cpuHasAvx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave || !fma) return false;
+    // ОС должна сохранять YMM регистры
+    if ((_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+const FrangiCpuKernels &frangiCpuKernelsScalar()
+{
+    static const FrangiCpuKernels kernels = FrangiCpuImpl::makeKernels<ScalarOps>("scalar");
+    return kernels;
+}
+
+const FrangiCpuKernels &frangiCpuKernels()
+{
+#ifdef FRANGI_CPU_AVX2
+    if (cpuHasAvx2()) {
+        return frangiCpuKernelsAvx2();
+    }
+#endif
+#if defined(FRANGI_CPU_SSE2)
+    static const FrangiCpuKernels kernels = FrangiCpuImpl::makeKernels<Sse2Ops>("sse2");
+    return kernels;
+#elif defined(FRANGI_CPU_NEON)
+    static const FrangiCpuKernels kernels = FrangiCpuImpl::makeKernels<NeonOps>("neon");
+    return kernels;
+#else
+    return frangiCpuKernelsScalar();
+#endif
+}
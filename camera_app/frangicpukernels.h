@@ -0,0 +1,58 @@
+#ifndef FRANGICPUKERNELS_H
+#define FRANGICPUKERNELS_H
+
+// Построчные ядра CPU backend'а Frangi фильтра.
+// Файл не зависит от Qt: реализации для AVX2 собираются в отдельной
+// единице трансляции с -mavx2 -mfma и выбираются во время выполнения.
+//
+// Соглашения для всех ядер:
+//  - count кратно FrangiCpuKernels::vectorWidth (строки выровнены),
+//    ядра могут писать за пределы реальной ширины строки в пределах stride;
+//  - источники должны иметь padding (копию крайних значений) слева и
+//    справа: blur - radius элементов, sobel - 1, hessian - 2.
+
+struct FrangiHessianRows
+{
+    const float *gxMid;   // gx текущей строки (для fxx, смещения x +-2)
+    const float *gxUp;    // gx строки "выше" (для fxy)
+    const float *gxDown;  // gx строки "ниже"
+    const float *gyUp;    // gy строки "выше" (для fyy)
+    const float *gyDown;  // gy строки "ниже"
+};
+
+struct FrangiVesselnessParams
+{
+    float derivativeScale;  // множитель разностей gradient'ов (1 / (2h) в шейдере)
+    float invBetaSq;        // 1 / beta^2
+    float invCSq;           // 1 / c^2
+};
+
+struct FrangiCpuKernels
+{
+    const char *name;
+    int vectorWidth;
+
+    // dst[x] = sum_k weights[k + radius] * src[x + k]
+    void (*blurHorizontal)(const float *src, float *dst, int count,
+                           const float *weights, int radius);
+
+    // dst[x] = sum_t weights[t] * rows[t][x]
+    void (*blurVertical)(const float *const *rows, const float *weights, int taps,
+                         float *dst, int count);
+
+    // Sobel 3x3 как в шейдере gradients (результат делится на 8)
+    void (*sobel)(const float *up, const float *mid, const float *down,
+                  float *gx, float *gy, int count);
+
+    // Hessian -> собственные значения 2x2 -> vesselness без промежуточных буферов
+    void (*hessianVesselness)(const FrangiHessianRows &rows, float *dst, int count,
+                              const FrangiVesselnessParams &params);
+};
+
+// Набор ядер для самого широкого ISA, доступного на текущем процессоре
+const FrangiCpuKernels &frangiCpuKernels();
+
+// Скалярная реализация (эталон для сравнения и fallback)
+const FrangiCpuKernels &frangiCpuKernelsScalar();
+
+#endif // FRANGICPUKERNELS_H
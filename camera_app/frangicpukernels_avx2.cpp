@@ -0,0 +1,42 @@
+// Собирается с -mavx2 -mfma (/arch:AVX2), вызывается только после проверки CPUID
+#include "frangicpukernels.h"
+#include "frangicpukernels_impl.h"
+#include <immintrin.h>
+
+namespace {
+
+struct Avx2Ops
+{
+    typedef __m256 Type;
+    typedef __m256 Mask;
+    enum { Width = 8 };
+
+    static __m256 set1(float v) { return _mm256_set1_ps(v); }
+    static __m256 loadu(const float *p) { return _mm256_loadu_ps(p); }
+    static void storeu(float *p, __m256 v) { _mm256_storeu_ps(p, v); }
+    static __m256 add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+    static __m256 sub(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+    static __m256 mul(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+    static __m256 div(__m256 a, __m256 b) { return _mm256_div_ps(a, b); }
+    static __m256 fmadd(__m256 a, __m256 b, __m256 c) { return _mm256_fmadd_ps(a, b, c); }
+    static __m256 min(__m256 a, __m256 b) { return _mm256_min_ps(a, b); }
+    static __m256 max(__m256 a, __m256 b) { return _mm256_max_ps(a, b); }
+    static __m256 sqrt(__m256 a) { return _mm256_sqrt_ps(a); }
+    static __m256 abs(__m256 a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static __m256 less(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static __m256 select(__m256 m, __m256 a, __m256 b) { return _mm256_blendv_ps(b, a, m); }
+    static __m256 round(__m256 a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static __m256 ldexp2(__m256 y, __m256 n)
+    {
+        __m256i e = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+        return _mm256_mul_ps(y, _mm256_castsi256_ps(e));
+    }
+};
+
+} // namespace
+
+const FrangiCpuKernels &frangiCpuKernelsAvx2()
+{
+    static const FrangiCpuKernels kernels = FrangiCpuImpl::makeKernels<Avx2Ops>("avx2");
+    return kernels;
+}
@@ -0,0 +1,141 @@
+#ifndef FRANGICPUKERNELS_IMPL_H
+#define FRANGICPUKERNELS_IMPL_H
+
+#include "frangicpukernels.h"
+
+// Общие шаблоны ядер. Параметр V - набор векторных операций конкретного ISA
+// (Type, Mask, Width и статические функции). Каждая единица трансляции
+// инстанцирует шаблоны со своим V из анонимного namespace, поэтому код,
+// собранный с -mavx2, не смешивается с базовым при линковке.
+
+namespace FrangiCpuImpl {
+
+// exp(x) по схеме Cephes: 2^n * P(r), относительная погрешность ~2e-7
+template <typename V>
+inline typename V::Type exp(typename V::Type x)
+{
+    x = V::min(x, V::set1(88.3f));
+    x = V::max(x, V::set1(-87.3f));
+
+    typename V::Type n = V::round(V::mul(x, V::set1(1.44269504088896341f)));
+    x = V::sub(x, V::mul(n, V::set1(0.693359375f)));
+    x = V::sub(x, V::mul(n, V::set1(-2.12194440e-4f)));
+
+    typename V::Type y = V::set1(1.9875691500e-4f);
+    y = V::fmadd(y, x, V::set1(1.3981999507e-3f));
+    y = V::fmadd(y, x, V::set1(8.3334519073e-3f));
+    y = V::fmadd(y, x, V::set1(4.1665795894e-2f));
+    y = V::fmadd(y, x, V::set1(1.6666665459e-1f));
+    y = V::fmadd(y, x, V::set1(5.0000001201e-1f));
+    y = V::fmadd(y, V::mul(x, x), V::add(x, V::set1(1.0f)));
+
+    return V::ldexp2(y, n);
+}
+
+template <typename V>
+void blurHorizontal(const float *src, float *dst, int count, const float *weights, int radius)
+{
+    for (int x = 0; x < count; x += V::Width) {
+        typename V::Type sum = V::set1(0.0f);
+        for (int k = -radius; k <= radius; ++k) {
+            sum = V::fmadd(V::set1(weights[k + radius]), V::loadu(src + x + k), sum);
+        }
+        V::storeu(dst + x, sum);
+    }
+}
+
+template <typename V>
+void blurVertical(const float *const *rows, const float *weights, int taps, float *dst, int count)
+{
+    // Проход по строкам во внешнем цикле: каждая строка читается последовательно
+    const typename V::Type w0 = V::set1(weights[0]);
+    for (int x = 0; x < count; x += V::Width) {
+        V::storeu(dst + x, V::mul(w0, V::loadu(rows[0] + x)));
+    }
+    for (int t = 1; t < taps; ++t) {
+        const typename V::Type w = V::set1(weights[t]);
+        const float *row = rows[t];
+        for (int x = 0; x < count; x += V::Width) {
+            V::storeu(dst + x, V::fmadd(w, V::loadu(row + x), V::loadu(dst + x)));
+        }
+    }
+}
+
+template <typename V>
+void sobel(const float *up, const float *mid, const float *down, float *gx, float *gy, int count)
+{
+    const typename V::Type two = V::set1(2.0f);
+    const typename V::Type eighth = V::set1(0.125f);
+    for (int x = 0; x < count; x += V::Width) {
+        typename V::Type left = V::add(V::add(V::loadu(up + x - 1), V::loadu(down + x - 1)),
+                                       V::mul(two, V::loadu(mid + x - 1)));
+        typename V::Type right = V::add(V::add(V::loadu(up + x + 1), V::loadu(down + x + 1)),
+                                        V::mul(two, V::loadu(mid + x + 1)));
+        typename V::Type top = V::add(V::add(V::loadu(up + x - 1), V::loadu(up + x + 1)),
+                                      V::mul(two, V::loadu(up + x)));
+        typename V::Type bottom = V::add(V::add(V::loadu(down + x - 1), V::loadu(down + x + 1)),
+                                         V::mul(two, V::loadu(down + x)));
+        V::storeu(gx + x, V::mul(V::sub(right, left), eighth));
+        V::storeu(gy + x, V::mul(V::sub(top, bottom), eighth));
+    }
+}
+
+template <typename V>
+void hessianVesselness(const FrangiHessianRows &rows, float *dst, int count,
+                       const FrangiVesselnessParams &params)
+{
+    typedef typename V::Type T;
+    const T scale = V::set1(params.derivativeScale);
+    const T half = V::set1(0.5f);
+    const T four = V::set1(4.0f);
+    const T zero = V::set1(0.0f);
+    const T one = V::set1(1.0f);
+    const T eps = V::set1(1e-6f);
+    const T negInvBetaSq = V::set1(-params.invBetaSq);
+    const T negInvCSq = V::set1(-params.invCSq);
+
+    for (int x = 0; x < count; x += V::Width) {
+        // Hessian
+        T fxx = V::mul(V::sub(V::loadu(rows.gxMid + x + 2), V::loadu(rows.gxMid + x - 2)), scale);
+        T fyy = V::mul(V::sub(V::loadu(rows.gyUp + x), V::loadu(rows.gyDown + x)), scale);
+        T fxy = V::mul(V::sub(V::loadu(rows.gxUp + x), V::loadu(rows.gxDown + x)), scale);
+
+        // Собственные значения 2x2, |lambda1| <= |lambda2|
+        T trace = V::add(fxx, fyy);
+        T det = V::sub(V::mul(fxx, fyy), V::mul(fxy, fxy));
+        T disc = V::max(V::sub(V::mul(trace, trace), V::mul(four, det)), zero);
+        T sqrtDisc = V::sqrt(disc);
+        T l1 = V::mul(half, V::add(trace, sqrtDisc));
+        T l2 = V::mul(half, V::sub(trace, sqrtDisc));
+        typename V::Mask swap = V::less(V::abs(l2), V::abs(l1));
+        T lambda1 = V::select(swap, l2, l1);
+        T lambda2 = V::select(swap, l1, l2);
+
+        // Vesselness
+        T rb = V::div(lambda1, V::add(lambda2, eps));
+        rb = V::mul(rb, rb);
+        T s2 = V::add(V::mul(lambda1, lambda1), V::mul(lambda2, lambda2));
+        T term1 = exp<V>(V::mul(rb, negInvBetaSq));
+        T term2 = V::sub(one, exp<V>(V::mul(s2, negInvCSq)));
+        T vesselness = V::mul(term1, term2);
+
+        V::storeu(dst + x, V::select(V::less(lambda2, zero), vesselness, zero));
+    }
+}
+
+template <typename V>
+FrangiCpuKernels makeKernels(const char *name)
+{
+    FrangiCpuKernels kernels;
+    kernels.name = name;
+    kernels.vectorWidth = V::Width;
+    kernels.blurHorizontal = &blurHorizontal<V>;
+    kernels.blurVertical = &blurVertical<V>;
+    kernels.sobel = &sobel<V>;
+    kernels.hessianVesselness = &hessianVesselness<V>;
+    return kernels;
+}
+
+} // namespace FrangiCpuImpl
+
+#endif // FRANGICPUKERNELS_IMPL_H
@@ -0,0 +1,565 @@
+#include "frangicpupipeline.h"
+#include "frangigaussian.h"
+#include <QThreadPool>
+#include <QSemaphore>
+#include <QtMath>
+#include <atomic>
+#include <cstring>
+
+FrangiCpuPipeline::FrangiCpuPipeline()
+    : m_kernels(&frangiCpuKernels())
+    , m_threadPool(QThreadPool::globalInstance())
+    , m_levels(1 + kFrangiMaxPyramidLevels)
+    , m_sigma(1.5f)
+    , m_beta(0.5f)
+    , m_c(15.0f)
+    , m_invertEnabled(true)
+    , m_multiScaleEnabled(false)
+    , m_gamma(2.0f)
+    , m_temporalEnabled(false)
+    , m_centerlineEnabled(false)
+{
+    m_weights = frangiGaussianWeights(m_sigma);
+    m_scales = frangiScaleRange(1.0f, 8.0f, 5);
+}
+
+void FrangiCpuPipeline::setSigma(float sigma)
+{
+    if (sigma == m_sigma) return;
+    m_sigma = sigma;
+    m_weights = frangiGaussianWeights(m_sigma);
+}
+
+void FrangiCpuPipeline::setScaleRange(float minSigma, float maxSigma, int count)
+{
+    m_scales = frangiScaleRange(minSigma, maxSigma, count);
+}
+
+void FrangiCpuPipeline::resize(int width, int height)
+{
+    // Уровни пирамиды: ceil(size / 2), как FBO в FrangiPipeline
+    int levelWidth = width;
+    int levelHeight = height;
+    for (Level &level : m_levels) {
+        resizeLevel(level, levelWidth, levelHeight);
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+    }
+    
+    m_offsetsFrameSize = QSize();
+    m_scaleMax.clear();
+    m_scaleMap.clear();
+}
+
+void FrangiCpuPipeline::updateRowOffsets(const QSize &frameSize)
+{
+    // Шейдеры используют h = 1/W (gradients) и h = 2/W (hessian) по обеим осям:
+    // по y это H/W строк всего кадра, в UV обрабатываемого кадра - (H/W) / height
+    const int height = m_levels[0].height;
+    const float rows = float(frameSize.height()) / frameSize.width();
+    const float gradientOffset = rows / height;
+    const float hessianOffset = 2.0f * rows / height;
+    m_gradientUp.resize(height);
+    m_gradientDown.resize(height);
+    m_hessianUp.resize(height);
+    m_hessianDown.resize(height);
+    for (int y = 0; y < height; ++y) {
+        m_gradientUp[y] = nearestRow(y, gradientOffset);
+        m_gradientDown[y] = nearestRow(y, -gradientOffset);
+        m_hessianUp[y] = nearestRow(y, hessianOffset);
+        m_hessianDown[y] = nearestRow(y, -hessianOffset);
+    }
+    m_offsetsFrameSize = frameSize;
+}
+
+void FrangiCpuPipeline::resizeLevel(Level &level, int width, int height)
+{
+    level.width = width;
+    level.height = height;
+    // Выравниваем по самому широкому вектору (8 float'ов для AVX2)
+    level.count = (width + 7) & ~7;
+    level.stride = level.count + 2 * kPadding;
+    
+    // Плоскости уровней пирамиды выделяются при первом multi-scale кадре
+    level.gray.clear();
+    level.blurX.clear();
+    level.blurY.clear();
+    level.gx.clear();
+    level.gy.clear();
+    level.vesselness.clear();
+    
+    // "Вверх" в GL (+v) - предыдущая строка сверху вниз
+    level.up1.resize(height);
+    level.down1.resize(height);
+    level.up2.resize(height);
+    level.down2.resize(height);
+    for (int y = 0; y < height; ++y) {
+        level.up1[y] = qMax(y - 1, 0);
+        level.down1[y] = qMin(y + 1, height - 1);
+        level.up2[y] = qMax(y - 2, 0);
+        level.down2[y] = qMin(y + 2, height - 1);
+    }
+    
+    // Билинейная выборка GL для центра каждого пикселя полного разрешения.
+    // По вертикали считаем в строках GL (снизу вверх) и переводим обратно
+    const Level &full = m_levels[0];
+    level.columnLow.resize(full.width);
+    level.columnHigh.resize(full.width);
+    level.columnWeight.resize(full.width);
+    for (int x = 0; x < full.width; ++x) {
+        const float t = (x + 0.5f) / full.width * width - 0.5f;
+        const int low = int(std::floor(t));
+        level.columnLow[x] = qBound(0, low, width - 1);
+        level.columnHigh[x] = qBound(0, low + 1, width - 1);
+        level.columnWeight[x] = t - low;
+    }
+    level.rowLow.resize(full.height);
+    level.rowHigh.resize(full.height);
+    level.rowWeight.resize(full.height);
+    for (int y = 0; y < full.height; ++y) {
+        const float t = (full.height - 1 - y + 0.5f) / full.height * height - 0.5f;
+        const int low = int(std::floor(t));
+        level.rowLow[y] = height - 1 - qBound(0, low, height - 1);
+        level.rowHigh[y] = height - 1 - qBound(0, low + 1, height - 1);
+        level.rowWeight[y] = t - low;
+    }
+}
+
+int FrangiCpuPipeline::nearestRow(int y, float offsetUv) const
+{
+    // В GL кадр зеркалирован: строка y сверху - это texel (H - 1 - y) снизу.
+    // Считаем координату так же, как шейдер, и округляем как GL_NEAREST
+    // с GL_CLAMP_TO_EDGE
+    const int height = m_levels[0].height;
+    const int glRow = height - 1 - y;
+    const float v = (glRow + 0.5f) / height + offsetUv;
+    const int sampled = qBound(0, int(std::floor(v * height)), height - 1);
+    return height - 1 - sampled;
+}
+
+void FrangiCpuPipeline::padRow(const Level &level, float *row) const
+{
+    // Копируем крайние значения в padding, затирая мусор от векторного хвоста
+    for (int x = -kPadding; x < 0; ++x) {
+        row[x] = row[0];
+    }
+    const float last = row[level.width - 1];
+    for (int x = level.width; x < level.count + kPadding; ++x) {
+        row[x] = last;
+    }
+}
+
+void FrangiCpuPipeline::parallelRows(int height, const std::function<void(int, int)> &body)
+{
+    const int maxBands = qMax(1, m_threadPool->maxThreadCount() * 4);
+    const int bandCount = qBound(1, height / kMinBandRows, maxBands);
+    
+    // Последнюю полосу выполняет вызывающий поток
+    QSemaphore done;
+    for (int band = 0; band < bandCount - 1; ++band) {
+        const int begin = height * band / bandCount;
+        const int end = height * (band + 1) / bandCount;
+        m_threadPool->start([&body, &done, begin, end]() {
+            body(begin, end);
+            done.release();
+        });
+    }
+    body(height * (bandCount - 1) / bandCount, height);
+    done.acquire(bandCount - 1);
+}
+
+void FrangiCpuPipeline::blur(Level &level, const QVector<float> &weights)
+{
+    const FrangiCpuKernels &k = *m_kernels;
+    const int radius = (weights.size() - 1) / 2;
+    
+    QElapsedTimer timer;
+    timer.start();
+    
+    // Stage 2a: Blur X (строка с padding'ом radius во временном буфере полосы)
+    parallelRows(level.height, [&](int begin, int end) {
+        QVector<float> padded(level.count + 2 * radius);
+        for (int y = begin; y < end; ++y) {
+            const float *src = level.row(level.gray, y);
+            float *line = padded.data() + radius;
+            for (int x = -radius; x < 0; ++x) line[x] = src[0];
+            memcpy(line, src, level.width * sizeof(float));
+            for (int x = level.width; x < level.count + radius; ++x) line[x] = src[level.width - 1];
+            k.blurHorizontal(line, level.row(level.blurX, y), level.count, weights.constData(), radius);
+        }
+    });
+    m_profiler.addCpuTime(FrangiProfiler::SectionBlurX, timer.nsecsElapsed() / 1e6);
+    timer.restart();
+    
+    // Stage 2b: Blur Y
+    parallelRows(level.height, [&](int begin, int end) {
+        QVector<const float *> rows(2 * radius + 1);
+        for (int y = begin; y < end; ++y) {
+            for (int t = -radius; t <= radius; ++t) {
+                rows[t + radius] = level.row(level.blurX, qBound(0, y + t, level.height - 1));
+            }
+            float *dst = level.row(level.blurY, y);
+            k.blurVertical(rows.constData(), weights.constData(), rows.size(), dst, level.count);
+            padRow(level, dst);
+        }
+    });
+    m_profiler.addCpuTime(FrangiProfiler::SectionBlurY, timer.nsecsElapsed() / 1e6);
+}
+
+void FrangiCpuPipeline::sobel(Level &level, const QVector<int> &up, const QVector<int> &down)
+{
+    // Stage 3: Gradients (Sobel)
+    FrangiCpuProfileScope scope(&m_profiler, FrangiProfiler::SectionGradients);
+    const FrangiCpuKernels &k = *m_kernels;
+    parallelRows(level.height, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            float *gx = level.row(level.gx, y);
+            float *gy = level.row(level.gy, y);
+            k.sobel(level.row(level.blurY, up[y]), level.row(level.blurY, y),
+                    level.row(level.blurY, down[y]), gx, gy, level.count);
+            padRow(level, gx);
+            padRow(level, gy);
+        }
+    });
+}
+
+void FrangiCpuPipeline::vesselness(Level &level, const QVector<int> &up, const QVector<int> &down,
+                                   float derivativeScale)
+{
+    // Stage 4-6: Hessian, Eigenvalues, Vesselness
+    FrangiCpuProfileScope scope(&m_profiler, FrangiProfiler::SectionVesselness);
+    const FrangiCpuKernels &k = *m_kernels;
+    FrangiVesselnessParams params;
+    params.derivativeScale = derivativeScale;
+    params.invBetaSq = 1.0f / (m_beta * m_beta);
+    params.invCSq = 1.0f / (m_c * m_c);
+    parallelRows(level.height, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            FrangiHessianRows rows;
+            rows.gxMid = level.row(level.gx, y);
+            rows.gxUp = level.row(level.gx, up[y]);
+            rows.gxDown = level.row(level.gx, down[y]);
+            rows.gyUp = level.row(level.gy, up[y]);
+            rows.gyDown = level.row(level.gy, down[y]);
+            k.hessianVesselness(rows, level.row(level.vesselness, y), level.count, params);
+        }
+    });
+}
+
+void FrangiCpuPipeline::downsample(Level &source, Level &target)
+{
+    // Среднее 2x2 как в downsample шейдере: пары строк считаются снизу
+    // (в GL кадр зеркалирован), при нечетном размере последний texel повторяется
+    FrangiCpuProfileScope scope(&m_profiler, FrangiProfiler::SectionDownsample);
+    parallelRows(target.height, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const int glRow = 2 * (target.height - 1 - y);
+            const float *low = source.row(source.gray, source.height - 1 - glRow);
+            const float *high = source.row(source.gray, source.height - 1 - qMin(glRow + 1, source.height - 1));
+            float *dst = target.row(target.gray, y);
+            for (int x = 0; x < target.width; ++x) {
+                const int x0 = 2 * x;
+                const int x1 = qMin(x0 + 1, source.width - 1);
+                dst[x] = (low[x0] + low[x1] + high[x0] + high[x1]) * 0.25f;
+            }
+            padRow(target, dst);
+        }
+    });
+}
+
+void FrangiCpuPipeline::accumulateScale(Level &level, float sigma, bool first)
+{
+    FrangiCpuProfileScope scope(&m_profiler, FrangiProfiler::SectionScaleMax);
+    const Level &full = m_levels[0];
+    const bool fullResolution = level.width == full.width && level.height == full.height;
+    parallelRows(full.height, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const float *low = level.row(level.vesselness, fullResolution ? y : level.rowLow[y]);
+            const float *high = level.row(level.vesselness, fullResolution ? y : level.rowHigh[y]);
+            const float rowWeight = fullResolution ? 0.0f : level.rowWeight[y];
+            float *maxRow = m_scaleMax.data() + y * full.width;
+            float *mapRow = m_scaleMap.data() + y * full.width;
+            for (int x = 0; x < full.width; ++x) {
+                float value;
+                if (fullResolution) {
+                    value = low[x];
+                } else {
+                    const int x0 = level.columnLow[x];
+                    const int x1 = level.columnHigh[x];
+                    const float columnWeight = level.columnWeight[x];
+                    const float lowValue = low[x0] + (low[x1] - low[x0]) * columnWeight;
+                    const float highValue = high[x0] + (high[x1] - high[x0]) * columnWeight;
+                    value = lowValue + (highValue - lowValue) * rowWeight;
+                }
+                if (first || value > maxRow[x]) {
+                    maxRow[x] = value;
+                    mapRow[x] = sigma;
+                }
+            }
+        }
+    });
+}
+
+void FrangiCpuPipeline::applyTemporal(QVector<float> &vesselness)
+{
+    if (!m_temporalEnabled) {
+        m_temporalSize = QSize();
+        return;
+    }
+    
+    // Те же pass'ы, что и в FrangiPipeline::processTemporal(). История
+    // другого размера (ROI, другой источник) не используется
+    FrangiCpuProfileScope scope(&m_profiler, FrangiProfiler::SectionTemporal);
+    Level &full = m_levels[0];
+    const int w = full.width;
+    const int h = full.height;
+    const int coarseHeight = frangiTemporalLumaSize(h);
+    const bool blend = m_temporalSize == QSize(w, h);
+    
+    m_temporalLuma.swap(m_temporalPreviousLuma);
+    m_temporalCoarse.swap(m_temporalPreviousCoarse);
+    m_temporalLuma.resize(w * h);
+    m_temporalCoarse.resize(frangiTemporalLumaSize(w) * coarseHeight);
+    const float *gray = full.row(full.gray, 0);
+    const bool inverted = m_invertEnabled;
+    parallelRows(h, [&](int begin, int end) {
+        frangiTemporalLumaRows(gray, full.stride, w, h, inverted, m_temporalLuma.data(), begin, end);
+    });
+    parallelRows(coarseHeight, [&](int begin, int end) {
+        frangiTemporalDownsampleRows(m_temporalLuma.constData(), w, h, m_temporalCoarse.data(), begin, end);
+    });
+    m_temporalSize = QSize(w, h);
+    
+    if (!blend) {
+        m_temporalHistory = vesselness;
+        return;
+    }
+    
+    const int blocksY = frangiTemporalBlockCount(h);
+    m_temporalMotion.resize(3 * frangiTemporalBlockCount(w) * blocksY);
+    parallelRows(blocksY, [&](int begin, int end) {
+        frangiTemporalMotionRows(m_temporalLuma.constData(), m_temporalPreviousLuma.constData(),
+                                 m_temporalCoarse.constData(), m_temporalPreviousCoarse.constData(), w, h,
+                                 m_temporalMotion.data(), begin, end, m_temporalParams);
+    });
+    
+    m_temporalScratch.resize(w * h);
+    parallelRows(h, [&](int begin, int end) {
+        frangiTemporalBlendRows(vesselness.constData(), m_temporalHistory.constData(), m_temporalMotion.constData(),
+                                w, h, m_temporalScratch.data(), begin, end, m_temporalParams);
+    });
+    m_temporalHistory.swap(m_temporalScratch);
+    vesselness = m_temporalHistory;
+}
+
+void FrangiCpuPipeline::extractCenterline(const QVector<float> &vesselness)
+{
+    if (!m_centerlineEnabled) {
+        m_centerline.clear();
+        return;
+    }
+    
+    // Те же pass'ы, что и в FrangiPipeline::processCenterline(), но без
+    // лишних: pass без изменений означает, что следующие тоже ничего не меняют
+    FrangiCpuProfileScope scope(&m_profiler, FrangiProfiler::SectionCenterline);
+    const int w = width();
+    const int h = height();
+    m_centerline.resize(w * h);
+    m_centerlineScratch.resize(w * h);
+    
+    parallelRows(h, [&](int begin, int end) {
+        frangiCenterlineNmsRows(vesselness.constData(), m_centerline.data(), w, h, begin, end, m_centerlineParams);
+    });
+    
+    std::atomic<bool> changed;
+    for (int i = 0; i < m_centerlineParams.hysteresisIterations; ++i) {
+        changed = false;
+        parallelRows(h, [&](int begin, int end) {
+            if (frangiHysteresisRows(m_centerline.constData(), m_centerlineScratch.data(), w, h, begin, end)) {
+                changed = true;
+            }
+        });
+        m_centerline.swap(m_centerlineScratch);
+        if (!changed) break;
+    }
+    
+    // Первая итерация обязательна: ее первый подпроход отбрасывает слабые пиксели
+    for (int i = 0; i < qMax(1, m_centerlineParams.thinningIterations); ++i) {
+        changed = false;
+        for (int subiteration = 0; subiteration < 2; ++subiteration) {
+            parallelRows(h, [&](int begin, int end) {
+                if (frangiThinningRows(m_centerline.constData(), m_centerlineScratch.data(), w, h, begin, end,
+                                       subiteration)) {
+                    changed = true;
+                }
+            });
+            m_centerline.swap(m_centerlineScratch);
+        }
+        if (!changed) break;
+    }
+}
+
+void FrangiCpuPipeline::grayscaleRow(const FrangiFrameView &frame, int y, float *dst) const
+{
+    // Та же формула, что в шейдере grayscale: 8-битные RGB каналы кадра
+    const uchar *src = frame.planes[0] + y * frame.strides[0];
+    float rgb[3];
+    switch (frame.format) {
+        case FrangiFrameView::FormatRgb24:
+            for (int x = 0; x < frame.width; ++x) {
+                dst[x] = src[3 * x] / 255.0f * 0.299f
+                       + src[3 * x + 1] / 255.0f * 0.587f
+                       + src[3 * x + 2] / 255.0f * 0.114f;
+            }
+            break;
+        case FrangiFrameView::FormatRgbx:
+            for (int x = 0; x < frame.width; ++x) {
+                dst[x] = src[4 * x] / 255.0f * 0.299f
+                       + src[4 * x + 1] / 255.0f * 0.587f
+                       + src[4 * x + 2] / 255.0f * 0.114f;
+            }
+            break;
+        case FrangiFrameView::FormatBgrx:
+            for (int x = 0; x < frame.width; ++x) {
+                dst[x] = src[4 * x + 2] / 255.0f * 0.299f
+                       + src[4 * x + 1] / 255.0f * 0.587f
+                       + src[4 * x] / 255.0f * 0.114f;
+            }
+            break;
+        case FrangiFrameView::FormatNv12: {
+            const uchar *uv = frame.planes[1] + (y / 2) * frame.strides[1];
+            for (int x = 0; x < frame.width; ++x) {
+                frangiYuvToRgb(src[x], uv[x & ~1], uv[x | 1], rgb);
+                dst[x] = rgb[0] * 0.299f + rgb[1] * 0.587f + rgb[2] * 0.114f;
+            }
+            break;
+        }
+        case FrangiFrameView::FormatYuyv:
+        case FrangiFrameView::FormatUyvy: {
+            // Смещения Y0/Y1/U/V внутри пары пикселей
+            const bool yuyv = frame.format == FrangiFrameView::FormatYuyv;
+            const int y0 = yuyv ? 0 : 1;
+            const int y1 = yuyv ? 2 : 3;
+            const int u = yuyv ? 1 : 0;
+            const int v = yuyv ? 3 : 2;
+            for (int x = 0; x < frame.width; ++x) {
+                const uchar *pair = src + (x / 2) * 4;
+                frangiYuvToRgb(pair[(x & 1) ? y1 : y0], pair[u], pair[v], rgb);
+                dst[x] = rgb[0] * 0.299f + rgb[1] * 0.587f + rgb[2] * 0.114f;
+            }
+            break;
+        }
+        case FrangiFrameView::FormatInvalid:
+            break;
+    }
+}
+
+QVector<float> FrangiCpuPipeline::process(const QImage &frame)
+{
+    if (frame.isNull()) return QVector<float>();
+    
+    FrangiFrameView view = FrangiFrameView::fromImage(frame);
+    if (view.isValid()) {
+        return process(view);
+    }
+    
+    const QImage rgbFrame = frame.convertToFormat(QImage::Format_RGB888);
+    return process(FrangiFrameView::fromImage(rgbFrame));
+}
+
+QVector<float> FrangiCpuPipeline::process(const FrangiFrameView &frame)
+{
+    QVector<float> result;
+    if (!frame.isValid()) return result;
+    
+    m_profiler.beginFrame();
+    
+    if (frame.width != width() || frame.height != height()) {
+        resize(frame.width, frame.height);
+    }
+    const QSize derivativeFrameSize = m_derivativeFrameSize.isEmpty() ? QSize(frame.width, frame.height)
+                                                                      : m_derivativeFrameSize;
+    if (derivativeFrameSize != m_offsetsFrameSize) {
+        updateRowOffsets(derivativeFrameSize);
+    }
+    
+    const bool multiScale = m_multiScaleEnabled && !m_scales.isEmpty();
+    int levelCount = 0;
+    if (multiScale) {
+        for (float sigma : m_scales) {
+            levelCount = qMax(levelCount, frangiPyramidLevel(sigma));
+        }
+    }
+    
+    // Плоскости выделяются по требованию: уровни пирамиды нужны только multi-scale
+    for (int i = 0; i <= levelCount; ++i) {
+        Level &level = m_levels[i];
+        const int planeSize = level.stride * level.height;
+        if (level.gray.size() == planeSize) continue;
+        level.gray.fill(0.0f, planeSize);
+        level.blurX.fill(0.0f, planeSize);
+        level.blurY.fill(0.0f, planeSize);
+        level.gx.fill(0.0f, planeSize);
+        level.gy.fill(0.0f, planeSize);
+        level.vesselness.fill(0.0f, planeSize);
+    }
+    
+    Level &full = m_levels[0];
+    const bool invert = m_invertEnabled;
+    
+    // Stage 0-1: Grayscale + Invert
+    QElapsedTimer grayscaleTimer;
+    grayscaleTimer.start();
+    parallelRows(full.height, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            float *dst = full.row(full.gray, y);
+            grayscaleRow(frame, y, dst);
+            if (invert) {
+                for (int x = 0; x < full.width; ++x) {
+                    dst[x] = 1.0f - dst[x];
+                }
+            }
+            padRow(full, dst);
+        }
+    });
+    m_profiler.addCpuTime(FrangiProfiler::SectionGrayscale, grayscaleTimer.nsecsElapsed() / 1e6);
+    
+    result.resize(full.width * full.height);
+    
+    if (!multiScale) {
+        // Single-scale: те же смещения и множитель, что и в шейдерах
+        blur(full, m_weights);
+        sobel(full, m_gradientUp, m_gradientDown);
+        vesselness(full, m_hessianUp, m_hessianDown, derivativeFrameSize.width() / 4.0f);  // 1 / (2h), h = 2/W
+        m_scaleMap.clear();
+        for (int y = 0; y < full.height; ++y) {
+            memcpy(result.data() + y * full.width, full.row(full.vesselness, y), full.width * sizeof(float));
+        }
+        applyTemporal(result);
+        extractCenterline(result);
+        return result;
+    }
+    
+    // Multi-scale: пирамида, vesselness каждого масштаба на своем уровне
+    // и максимум с sigma максимума на полном разрешении
+    for (int i = 1; i <= levelCount; ++i) {
+        downsample(m_levels[i - 1], m_levels[i]);
+    }
+    
+    m_scaleMax.resize(full.width * full.height);
+    m_scaleMap.resize(full.width * full.height);
+    for (int i = 0; i < m_scales.size(); ++i) {
+        const float sigma = m_scales[i];
+        const int levelIndex = frangiPyramidLevel(sigma);
+        Level &level = m_levels[levelIndex];
+        blur(level, frangiGaussianWeights(frangiLevelSigma(sigma, levelIndex)));
+        sobel(level, level.up1, level.down1);
+        vesselness(level, level.up2, level.down2, frangiScaleNormalization(sigma, m_gamma, levelIndex));
+        accumulateScale(level, sigma, i == 0);
+    }
+    
+    result = m_scaleMax;
+    applyTemporal(result);
+    extractCenterline(result);
+    return result;
+}
@@ -0,0 +1,192 @@
+#ifndef FRANGICPUPIPELINE_H
+#define FRANGICPUPIPELINE_H
+
+#include <QImage>
+#include <QSize>
+#include <QVector>
+#include <functional>
+#include "frangicenterline.h"
+#include "frangicpukernels.h"
+#include "frangiframe.h"
+#include "frangiprofiler.h"
+#include "frangitemporal.h"
+
+class QThreadPool;
+
+// CPU backend Frangi фильтра для машин без GPU (headless ноды, llvmpipe).
+// Повторяет шейдеры FrangiPipeline stage за stage'ем: grayscale/invert,
+// separable Gaussian (то же ядро ~3 sigma), Sobel, Hessian, собственные
+// значения 2x2 и vesselness. Строки обрабатываются SIMD ядрами (AVX2/SSE2/NEON,
+// выбор во время выполнения), полосы строк распределяются по QThreadPool.
+//
+// Точность относительно GL выхода: разница vesselness не больше ~1e-5
+// (ошибка float32 и полиномиального exp) для compute blur; fragment blur
+// берет пары texel'ей билинейной выборкой, точность которой ограничена
+// аппаратной фильтрацией (обычно 8 бит дробной части), там разница
+// достигает ~1e-3. Исключение - строки, где смещение
+// текстурной координаты в шейдерах gradients/hessian (h = 1/W и 2/W по обеим
+// осям) попадает ровно на границу texel'я, например Hessian для 4:3:
+// там драйвер может выбрать соседнюю строку, и значения в строке отличаются.
+//
+// Multi-scale режим повторяет пирамиду FrangiPipeline: усреднение 2x2 в той же
+// ориентации строк, что и в GL, и билинейное растяжение уровней; разница
+// с GL там определяется точностью аппаратной билинейной интерполяции.
+class FrangiCpuPipeline
+{
+public:
+    FrangiCpuPipeline();
+
+    // Параметры Frangi фильтра
+    void setSigma(float sigma);
+    void setBeta(float beta) { m_beta = beta; }
+    void setC(float c) { m_c = c; }
+    void setInvertEnabled(bool enabled) { m_invertEnabled = enabled; }
+    // Размер всего кадра для шагов производных, см. FrangiPipeline::setDerivativeFrameSize()
+    void setDerivativeFrameSize(const QSize &size) { m_derivativeFrameSize = size; }
+
+    // Multi-scale режим, см. FrangiPipeline
+    void setMultiScaleEnabled(bool enabled) { m_multiScaleEnabled = enabled; }
+    void setScales(const QVector<float> &scales) { m_scales = scales; }
+    void setScaleRange(float minSigma, float maxSigma, int count);
+    void setGamma(float gamma) { m_gamma = gamma; }
+
+    // Скелет сосудов (stage Centerline, см. frangicenterline.h) после vesselness
+    void setCenterlineEnabled(bool enabled) { m_centerlineEnabled = enabled; }
+    void setCenterlineParams(const FrangiCenterlineParams &params) { m_centerlineParams = params; }
+
+    // Temporal stage (см. frangitemporal.h): каждый process() - новый кадр
+    // того же источника. Выключение или смена размера сбрасывает историю
+    void setTemporalEnabled(bool enabled) { m_temporalEnabled = enabled; }
+    void setTemporalParams(const FrangiTemporalParams &params) { m_temporalParams = params; }
+
+    // Пул потоков для полос строк (по умолчанию QThreadPool::globalInstance())
+    void setThreadPool(QThreadPool *pool) { m_threadPool = pool; }
+
+    // Имя выбранного набора SIMD ядер ("avx2", "sse2", "neon", "scalar")
+    const char *isaName() const { return m_kernels->name; }
+
+    int width() const { return m_levels[0].width; }
+    int height() const { return m_levels[0].height; }
+
+    // Обрабатывает кадр, возвращает vesselness (width*height, строки сверху вниз).
+    // YUV кадры переводятся в RGB так же, как шейдер распаковки FrangiPipeline
+    QVector<float> process(const FrangiFrameView &frame);
+    QVector<float> process(const QImage &frame);
+
+    // Sigma максимума vesselness последнего кадра (пусто вне multi-scale режима)
+    const QVector<float> &scaleMap() const { return m_scaleMap; }
+    // Маска скелета последнего кадра (0/255, строки сверху вниз), пусто без centerline
+    const QVector<uchar> &centerline() const { return m_centerline; }
+
+    // Время stage'ей (CPU), по умолчанию выключено. Кадр профайлера - один process()
+    FrangiProfiler *profiler() { return &m_profiler; }
+
+private:
+    // Padding слева/справа у каждой строки плоскостей (>= 2 для Hessian)
+    static const int kPadding = 8;
+    // Минимальная высота полосы строк для одной задачи пула
+    static const int kMinBandRows = 16;
+
+    // Плоскости одного уровня пирамиды, уровень 0 - полное разрешение
+    struct Level {
+        Level() : width(0), height(0), count(0), stride(0) {}
+        float *row(QVector<float> &plane, int y) { return plane.data() + y * stride + kPadding; }
+
+        int width;
+        int height;
+        int count;   // ширина строки, выровненная по вектору
+        int stride;  // count + 2 * kPadding
+
+        // Плоскости промежуточных результатов
+        QVector<float> gray;
+        QVector<float> blurX;
+        QVector<float> blurY;
+        QVector<float> gx;
+        QVector<float> gy;
+        QVector<float> vesselness;
+
+        // Соседние строки на 1 и 2 пикселя (multi-scale режим, clamp к краю)
+        QVector<int> up1;
+        QVector<int> down1;
+        QVector<int> up2;
+        QVector<int> down2;
+
+        // Билинейное растяжение до полного разрешения: texel'и и веса по осям
+        QVector<int> columnLow;
+        QVector<int> columnHigh;
+        QVector<float> columnWeight;
+        QVector<int> rowLow;
+        QVector<int> rowHigh;
+        QVector<float> rowWeight;
+    };
+
+    void resize(int width, int height);
+    void updateRowOffsets(const QSize &frameSize);
+    void resizeLevel(Level &level, int width, int height);
+    void parallelRows(int height, const std::function<void(int, int)> &body);
+    void padRow(const Level &level, float *row) const;
+    int nearestRow(int y, float offsetUv) const;
+    void blur(Level &level, const QVector<float> &weights);
+    void sobel(Level &level, const QVector<int> &up, const QVector<int> &down);
+    void vesselness(Level &level, const QVector<int> &up, const QVector<int> &down,
+                    float derivativeScale);
+    void downsample(Level &source, Level &target);
+    void accumulateScale(Level &level, float sigma, bool first);
+    void applyTemporal(QVector<float> &vesselness);
+    void extractCenterline(const QVector<float> &vesselness);
+    void grayscaleRow(const FrangiFrameView &frame, int y, float *dst) const;
+
+    const FrangiCpuKernels *m_kernels;
+    QThreadPool *m_threadPool;
+
+    QVector<Level> m_levels;
+
+    // Максимум по масштабам и его sigma (строки сверху вниз, без padding'а)
+    QVector<float> m_scaleMax;
+    QVector<float> m_scaleMap;
+
+    FrangiProfiler m_profiler;
+
+    // Индексы соседних строк, которые выбирает GL_NEAREST в шейдерах
+    // gradients (смещение 1/W) и hessian (смещение 2/W)
+    QVector<int> m_gradientUp;
+    QVector<int> m_gradientDown;
+    QVector<int> m_hessianUp;
+    QVector<int> m_hessianDown;
+    // Размер кадра, для которого посчитаны смещения строк
+    QSize m_offsetsFrameSize;
+    QSize m_derivativeFrameSize;
+
+    QVector<float> m_weights;
+
+    // Параметры фильтра
+    float m_sigma;
+    float m_beta;
+    float m_c;
+    bool m_invertEnabled;
+
+    bool m_multiScaleEnabled;
+    QVector<float> m_scales;
+    float m_gamma;
+
+    // История vesselness, яркость (полная и уменьшенная) текущего и прошлого кадров и
+    // сдвиги блоков; m_temporalSize - размер кадра истории (пустой - нет)
+    bool m_temporalEnabled;
+    FrangiTemporalParams m_temporalParams;
+    QVector<float> m_temporalHistory;
+    QVector<float> m_temporalScratch;
+    QVector<float> m_temporalLuma;
+    QVector<float> m_temporalPreviousLuma;
+    QVector<float> m_temporalCoarse;
+    QVector<float> m_temporalPreviousCoarse;
+    QVector<float> m_temporalMotion;
+    QSize m_temporalSize;
+
+    bool m_centerlineEnabled;
+    FrangiCenterlineParams m_centerlineParams;
+    // Маска и буфер ping-pong'а гистерезиса и утончения
+    QVector<uchar> m_centerline;
+    QVector<uchar> m_centerlineScratch;
+};
+
+#endif // FRANGICPUPIPELINE_H
@@ -0,0 +1,493 @@
+#include "frangiengine.h"
+#include "frangipipeline.h"
+#include "frangicpupipeline.h"
+#include "frangigaussian.h"
+#include "frangivesselgraph.h"
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOffscreenSurface>
+#include <QSurfaceFormat>
+#include <QDebug>
+#include <climits>
+
+FrangiEngine::FrangiEngine(QObject *parent)
+    : QObject(parent)
+    , m_backend(BackendAuto)
+    , m_initialized(false)
+    , m_context(nullptr)
+    , m_surface(nullptr)
+    , m_pipeline(new FrangiPipeline())
+    , m_cpuPipeline(new FrangiCpuPipeline())
+    , m_temporalEnabled(false)
+    , m_centerlineEnabled(false)
+    , m_vesselGraph(new FrangiVesselGraph())
+    , m_vesselGraphSuspended(false)
+    , m_readbackFormat(FrangiReadbackR32F)
+    , m_cpuFrameIndex(0)
+{
+    qRegisterMetaType<FrangiVesselnessMap>();
+}
+
+FrangiEngine::~FrangiEngine()
+{
+    // Ресурсы конвейера удаляются в его контексте
+    bool current = makeCurrent();
+    delete m_pipeline;
+    if (current) {
+        doneCurrent();
+    }
+    
+    delete m_surface;
+    delete m_context;
+    delete m_cpuPipeline;
+    delete m_vesselGraph;
+}
+
+void FrangiEngine::prepareHeadlessEnvironment()
+{
+    // Если есть дисплей - оставляем платформу по умолчанию
+    if (qEnvironmentVariableIsSet("DISPLAY") || qEnvironmentVariableIsSet("WAYLAND_DISPLAY")) {
+        return;
+    }
+    
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "minimalegl");
+    }
+    
+    // Mesa: EGL без оконной системы и без DRM устройства
+    if (!qEnvironmentVariableIsSet("EGL_PLATFORM")) {
+        qputenv("EGL_PLATFORM", "surfaceless");
+    }
+}
+
+bool FrangiEngine::initialize()
+{
+    if (m_initialized) return true;
+    
+    if (m_backend == BackendCpu) {
+        qDebug() << "FrangiEngine initialized, CPU backend:" << m_cpuPipeline->isaName();
+        m_initialized = true;
+        return true;
+    }
+    
+    if (!initializeOpenGL()) {
+        if (m_backend == BackendOpenGL) {
+            return false;
+        }
+        qDebug() << "FrangiEngine: OpenGL unavailable, falling back to CPU backend:"
+                 << m_cpuPipeline->isaName();
+        m_backend = BackendCpu;
+        m_initialized = true;
+        return true;
+    }
+    
+    if (m_backend == BackendAuto) {
+        // Программный растеризатор медленнее SIMD ядер - в режиме Auto уходим на CPU
+        makeCurrent();
+        const QByteArray renderer = QByteArray(
+            reinterpret_cast<const char *>(m_context->functions()->glGetString(GL_RENDERER))).toLower();
+        doneCurrent();
+        
+        if (renderer.contains("llvmpipe") || renderer.contains("softpipe") || renderer.contains("swrast")) {
+            qDebug() << "FrangiEngine: software renderer" << renderer << "- using CPU backend:"
+                     << m_cpuPipeline->isaName();
+            m_backend = BackendCpu;
+        } else {
+            m_backend = BackendOpenGL;
+        }
+    }
+    
+    m_initialized = true;
+    return true;
+}
+
+bool FrangiEngine::initializeOpenGL()
+{
+    if (m_pipeline->isInitialized()) return true;
+    
+    // Остатки предыдущей неудачной попытки
+    delete m_surface;
+    delete m_context;
+    m_surface = nullptr;
+    
+    // 4.3 нужен для compute шейдеров, 3.3 - минимум для fragment пути
+    const QPair<int, int> versions[] = { qMakePair(4, 3), qMakePair(3, 3) };
+    for (const QPair<int, int> &version : versions) {
+        QSurfaceFormat format;
+        format.setVersion(version.first, version.second);
+        format.setProfile(QSurfaceFormat::CoreProfile);
+        
+        delete m_context;
+        m_context = new QOpenGLContext();
+        m_context->setFormat(format);
+        if (m_context->create() && m_context->format().version() >= version) {
+            break;
+        }
+    }
+    if (!m_context->isValid()) {
+        qDebug() << "FrangiEngine: failed to create OpenGL context";
+        return false;
+    }
+    
+    m_surface = new QOffscreenSurface();
+    m_surface->setFormat(m_context->format());
+    m_surface->create();
+    if (!m_surface->isValid()) {
+        qDebug() << "FrangiEngine: failed to create offscreen surface";
+        return false;
+    }
+    
+    if (!m_context->makeCurrent(m_surface)) {
+        qDebug() << "FrangiEngine: makeCurrent failed";
+        return false;
+    }
+    
+    m_pipeline->initialize();
+    
+    doneCurrent();
+    
+    qDebug() << "FrangiEngine initialized, context version:"
+             << m_context->format().majorVersion() << "." << m_context->format().minorVersion();
+    return true;
+}
+
+bool FrangiEngine::makeCurrent()
+{
+    return m_context && m_surface && m_context->makeCurrent(m_surface);
+}
+
+void FrangiEngine::doneCurrent()
+{
+    if (m_context) {
+        m_context->doneCurrent();
+    }
+}
+
+void FrangiEngine::setSigma(float sigma)
+{
+    m_pipeline->setSigma(sigma);
+    m_cpuPipeline->setSigma(sigma);
+}
+
+void FrangiEngine::setBeta(float beta)
+{
+    m_pipeline->setBeta(beta);
+    m_cpuPipeline->setBeta(beta);
+}
+
+void FrangiEngine::setC(float c)
+{
+    m_pipeline->setC(c);
+    m_cpuPipeline->setC(c);
+}
+
+void FrangiEngine::setInvertEnabled(bool enabled)
+{
+    m_pipeline->setInvertEnabled(enabled);
+    m_cpuPipeline->setInvertEnabled(enabled);
+}
+
+void FrangiEngine::setFusedEnabled(bool enabled)
+{
+    m_pipeline->setFusedEnabled(enabled);
+}
+
+void FrangiEngine::setComputeEnabled(bool enabled)
+{
+    m_pipeline->setComputeEnabled(enabled);
+}
+
+void FrangiEngine::setPrecision(FrangiPrecision precision)
+{
+    m_pipeline->setPrecision(precision);
+}
+
+bool FrangiEngine::isComputeAvailable() const
+{
+    return m_pipeline->isComputeAvailable();
+}
+
+void FrangiEngine::setReadbackCallback(ReadbackCallback callback)
+{
+    m_readbackCallback = std::move(callback);
+    m_pipeline->setAsyncReadbackEnabled(bool(m_readbackCallback));
+    m_pipeline->asyncReadback()->setCallback(m_readbackCallback);
+}
+
+void FrangiEngine::setReadbackFormat(FrangiReadbackFormat format)
+{
+    m_readbackFormat = format;
+    m_pipeline->asyncReadback()->setFormat(format);
+}
+
+void FrangiEngine::setReadbackRoi(const QRect &roi)
+{
+    m_readbackRoi = roi;
+    m_pipeline->asyncReadback()->setRoi(roi);
+}
+
+void FrangiEngine::flushReadback()
+{
+    if (!m_initialized || m_backend == BackendCpu) return;
+    
+    if (makeCurrent()) {
+        m_pipeline->asyncReadback()->flush();
+        doneCurrent();
+    }
+}
+
+FrangiProfiler *FrangiEngine::profiler()
+{
+    return m_backend == BackendCpu ? m_cpuPipeline->profiler() : m_pipeline->profiler();
+}
+
+void FrangiEngine::flushProfiler()
+{
+    if (!m_initialized) return;
+    
+    if (m_backend == BackendCpu) {
+        m_cpuPipeline->profiler()->flush();
+    } else if (makeCurrent()) {
+        m_pipeline->profiler()->flush();
+        doneCurrent();
+    }
+}
+
+void FrangiEngine::setMultiScaleEnabled(bool enabled)
+{
+    m_pipeline->setMultiScaleEnabled(enabled);
+    m_cpuPipeline->setMultiScaleEnabled(enabled);
+}
+
+void FrangiEngine::setScaleRange(float minSigma, float maxSigma, int count)
+{
+    m_pipeline->setScaleRange(minSigma, maxSigma, count);
+    m_cpuPipeline->setScaleRange(minSigma, maxSigma, count);
+}
+
+void FrangiEngine::setGamma(float gamma)
+{
+    m_pipeline->setGamma(gamma);
+    m_cpuPipeline->setGamma(gamma);
+}
+
+void FrangiEngine::setTemporalEnabled(bool enabled)
+{
+    m_temporalEnabled = enabled;
+    m_pipeline->setTemporalEnabled(enabled);
+    m_cpuPipeline->setTemporalEnabled(enabled);
+}
+
+void FrangiEngine::setTemporalParams(const FrangiTemporalParams &params)
+{
+    m_pipeline->setTemporalParams(params);
+    m_cpuPipeline->setTemporalParams(params);
+}
+
+void FrangiEngine::setCenterlineEnabled(bool enabled)
+{
+    m_centerlineEnabled = enabled;
+    m_cpuPipeline->setCenterlineEnabled(enabled);
+    if (!enabled) {
+        m_vesselGraph->clear();
+    }
+}
+
+void FrangiEngine::setCenterlineParams(const FrangiCenterlineParams &params)
+{
+    m_pipeline->setCenterlineParams(params);
+    m_cpuPipeline->setCenterlineParams(params);
+}
+
+void FrangiEngine::setDerivativeFrameSize(const QSize &size)
+{
+    m_pipeline->setDerivativeFrameSize(size);
+    m_cpuPipeline->setDerivativeFrameSize(size);
+}
+
+int FrangiEngine::maxFrameSize() const
+{
+    if (m_backend == BackendCpu || !m_pipeline->maxTextureSize()) return INT_MAX;
+    return m_pipeline->maxTextureSize();
+}
+
+int FrangiEngine::supportRadius(const QSize &frameSize) const
+{
+    // Hessian - разность gradients с шагом 2h, gradients - с шагом h, где
+    // h = 1/W по обеим осям (H/W пикселей по вертикали), плюс билинейная выборка
+    const int derivativeRows = qMax(1, int(std::ceil(double(frameSize.height()) / qMax(1, frameSize.width()))));
+    if (!m_pipeline->multiScaleEnabled()) {
+        return frangiGaussianRadius(m_pipeline->sigma()) + 3 * derivativeRows + 1;
+    }
+    
+    // Multi-scale: blur и производные в пикселях уровня, плюс интерполяция уровня
+    int radius = 0;
+    for (float sigma : m_pipeline->scales()) {
+        const int level = frangiPyramidLevel(sigma);
+        const int levelRadius = frangiGaussianRadius(frangiLevelSigma(sigma, level)) + 2 + 1;
+        radius = qMax(radius, (levelRadius + 1) << level);
+    }
+    return radius;
+}
+
+int FrangiEngine::tileAlignment() const
+{
+    if (!m_pipeline->multiScaleEnabled()) return 1;
+    
+    int levels = 0;
+    for (float sigma : m_pipeline->scales()) {
+        levels = qMax(levels, frangiPyramidLevel(sigma));
+    }
+    return 1 << levels;
+}
+
+FrangiVesselnessMap FrangiEngine::process(const QImage &frame)
+{
+    if (frame.isNull()) {
+        return FrangiVesselnessMap();
+    }
+    
+    FrangiFrameView view = FrangiFrameView::fromImage(frame);
+    if (view.isValid()) {
+        return process(view);
+    }
+    
+    const QImage rgbFrame = frame.convertToFormat(QImage::Format_RGB888);
+    return process(FrangiFrameView::fromImage(rgbFrame));
+}
+
+FrangiVesselnessMap FrangiEngine::process(const FrangiFrameView &frame)
+{
+    FrangiVesselnessMap result;
+    
+    if (!m_initialized || !frame.isValid()) {
+        return result;
+    }
+    
+    if (m_backend == BackendCpu) {
+        result.data = m_cpuPipeline->process(frame);
+        result.width = m_cpuPipeline->width();
+        result.height = m_cpuPipeline->height();
+        result.scales = m_cpuPipeline->scaleMap();
+        result.centerline = m_cpuPipeline->centerline();
+        updateVesselGraph(result);
+        
+        // Результат уже на CPU: отдаем его в формате асинхронного чтения сразу
+        if (m_readbackCallback) {
+            FrangiReadbackFrame readback = FrangiReadbackFrame::fromFloat(
+                result.data, result.width, result.height, m_readbackFormat, m_readbackRoi);
+            readback.timestamp = frame.timestamp;
+            readback.frameIndex = m_cpuFrameIndex++;
+            m_readbackCallback(readback);
+            return FrangiVesselnessMap();
+        }
+    } else {
+        if (!makeCurrent()) {
+            qDebug() << "FrangiEngine: makeCurrent failed";
+            return result;
+        }
+        
+        m_pipeline->setStreamCount(1);
+        m_pipeline->setFrame(frame);
+        m_pipeline->process(m_centerlineEnabled ? FrangiPipeline::StageCenterline
+                                                : FrangiPipeline::StageVesselness);
+        
+        // В асинхронном режиме результат заберет кольцо PBO
+        if (m_readbackCallback) {
+            doneCurrent();
+            return result;
+        }
+        
+        result.width = m_pipeline->width();
+        result.height = m_pipeline->height();
+        result.data = m_pipeline->readVesselness();
+        result.scales = m_pipeline->readScaleMap();
+        if (m_centerlineEnabled) {
+            result.centerline = m_pipeline->readCenterline();
+        }
+        
+        doneCurrent();
+        updateVesselGraph(result);
+    }
+    
+    if (m_callback) {
+        m_callback(result);
+    }
+    emit vesselnessReady(result);
+    
+    return result;
+}
+
+QVector<FrangiVesselnessMap> FrangiEngine::process(const QVector<FrangiFrameView> &frames)
+{
+    QVector<FrangiVesselnessMap> results;
+    
+    if (!m_initialized || frames.isEmpty()) {
+        return results;
+    }
+    
+    if (m_backend == BackendCpu) {
+        // Граф и temporal stage - по кадрам одного потока, как и в GL атласе
+        m_vesselGraphSuspended = frames.size() > 1;
+        m_cpuPipeline->setTemporalEnabled(m_temporalEnabled && frames.size() == 1);
+        for (const FrangiFrameView &frame : frames) {
+            results.append(process(frame));
+        }
+        m_vesselGraphSuspended = false;
+        m_cpuPipeline->setTemporalEnabled(m_temporalEnabled);
+        return results;
+    }
+    
+    if (!makeCurrent()) {
+        qDebug() << "FrangiEngine: makeCurrent failed";
+        return results;
+    }
+    
+    m_pipeline->setStreamCount(frames.size());
+    for (int i = 0; i < frames.size(); ++i) {
+        if (frames[i].isValid()) {
+            m_pipeline->setFrame(i, frames[i]);
+        }
+    }
+    m_pipeline->process(m_centerlineEnabled ? FrangiPipeline::StageCenterline
+                                            : FrangiPipeline::StageVesselness);
+    
+    results.resize(frames.size());
+    for (int i = 0; i < frames.size(); ++i) {
+        if (!frames[i].isValid()) continue;
+        const QRect rect = m_pipeline->streamRect(i);
+        results[i].width = rect.width();
+        results[i].height = rect.height();
+        results[i].data = m_pipeline->readVesselness(i);
+        if (m_centerlineEnabled) {
+            results[i].centerline = m_pipeline->readCenterline(i);
+        }
+    }
+    
+    doneCurrent();
+    
+    for (const FrangiVesselnessMap &result : results) {
+        if (result.isNull()) continue;
+        if (m_callback) {
+            m_callback(result);
+        }
+        emit vesselnessReady(result);
+    }
+    
+    return results;
+}
+
+void FrangiEngine::updateVesselGraph(const FrangiVesselnessMap &map)
+{
+    if (map.centerline.isEmpty() || m_vesselGraphSuspended) return;
+    
+    // Граф строится на CPU после чтения скелета
+    FrangiCpuProfileScope scope(profiler(), FrangiProfiler::SectionGraph);
+    const float *scales = map.scales.isEmpty() ? nullptr : map.scales.constData();
+    m_vesselGraph->update(map.centerline.constData(), map.width, map.height, scales, m_pipeline->sigma());
+}
+
+void FrangiEngine::submitFrame(const QImage &frame)
+{
+    process(frame);
+}
\ No newline at end of file
@@ -0,0 +1,182 @@
+#ifndef FRANGIENGINE_H
+#define FRANGIENGINE_H
+
+#include <QObject>
+#include <QImage>
+#include <QVector>
+#include <QMetaType>
+#include <functional>
+#include "frangicenterline.h"
+#include "frangiframe.h"
+#include "frangireadback.h"
+#include "frangiprofiler.h"
+#include "frangiprecision.h"
+
+class QOpenGLContext;
+class QOffscreenSurface;
+class FrangiPipeline;
+class FrangiCpuPipeline;
+class FrangiVesselGraph;
+
+// Карта vesselness одного кадра: width*height float'ов, строки сверху вниз
+struct FrangiVesselnessMap
+{
+    int width = 0;
+    int height = 0;
+    QVector<float> data;
+    // Multi-scale режим: sigma, на которой достигнут максимум (иначе пусто)
+    QVector<float> scales;
+    // Скелет сосудов (0/255), если включен centerline (иначе пусто)
+    QVector<uchar> centerline;
+
+    bool isNull() const { return data.isEmpty(); }
+    float at(int x, int y) const { return data.at(y * width + x); }
+};
+
+Q_DECLARE_METATYPE(FrangiVesselnessMap)
+
+// Headless движок Frangi фильтра.
+// Владеет собственным offscreen контекстом (QOffscreenSurface; на серверах
+// без дисплея - EGL/surfaceless Mesa, см. prepareHeadlessEnvironment())
+// и не зависит от QtWidgets. Все вызовы должны идти из того потока,
+// в котором был вызван initialize().
+class FrangiEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Где выполняется конвейер
+    enum Backend {
+        BackendAuto,    // GL, если есть аппаратный драйвер, иначе CPU
+        BackendOpenGL,  // шейдеры FrangiPipeline
+        BackendCpu      // SIMD ядра FrangiCpuPipeline
+    };
+
+    using ResultCallback = std::function<void(const FrangiVesselnessMap &)>;
+    using ReadbackCallback = std::function<void(const FrangiReadbackFrame &)>;
+
+    explicit FrangiEngine(QObject *parent = nullptr);
+    ~FrangiEngine();
+
+    // Выставляет переменные окружения для работы без дисплея
+    // (QT_QPA_PLATFORM=minimalegl, EGL_PLATFORM=surfaceless).
+    // Вызывать до создания QGuiApplication.
+    static void prepareHeadlessEnvironment();
+
+    // Выбор backend'а, вызывать до initialize()
+    void setBackend(Backend backend) { m_backend = backend; }
+    // После initialize() - фактически выбранный backend (OpenGL или Cpu)
+    Backend backend() const { return m_backend; }
+
+    // Создает контекст, surface и компилирует шейдеры (для GL backend'а)
+    bool initialize();
+    bool isInitialized() const { return m_initialized; }
+
+    // Параметры Frangi фильтра
+    void setSigma(float sigma);
+    void setBeta(float beta);
+    void setC(float c);
+    void setInvertEnabled(bool enabled);
+    // Fused passes 4-7 в GL backend'е (по умолчанию включено)
+    void setFusedEnabled(bool enabled);
+    // Compute blur в GL backend'е, если контекст 4.3+ (по умолчанию выключено)
+    void setComputeEnabled(bool enabled);
+    // Точность промежуточных FBO GL backend'а (по умолчанию Balanced)
+    void setPrecision(FrangiPrecision precision);
+    // Есть ли compute шейдеры в контексте GL backend'а (после initialize())
+    bool isComputeAvailable() const;
+    // Multi-scale режим: максимум по sigma из [minSigma, maxSigma] (логарифмический шаг)
+    void setMultiScaleEnabled(bool enabled);
+    void setScaleRange(float minSigma, float maxSigma, int count);
+    void setGamma(float gamma);
+    // Temporal stage: vesselness последовательных кадров process(const FrangiFrameView &)
+    // усредняется с компенсацией движения (см. frangitemporal.h), по умолчанию
+    // выключено. Для нескольких потоков не применяется
+    void setTemporalEnabled(bool enabled);
+    void setTemporalParams(const FrangiTemporalParams &params);
+    // Скелет сосудов в FrangiVesselnessMap::centerline и граф vesselGraph()
+    // (по умолчанию выключено)
+    void setCenterlineEnabled(bool enabled);
+    void setCenterlineParams(const FrangiCenterlineParams &params);
+    // Граф по скелетам последовательных кадров process(const FrangiFrameView &),
+    // обновляется инкрементально. В асинхронном режиме GL backend'а
+    // и для атласа из нескольких потоков не строится
+    const FrangiVesselGraph &vesselGraph() const { return *m_vesselGraph; }
+    // Размер всего изображения, когда в process() передаются его тайлы или ROI
+    // (см. FrangiPipeline::setDerivativeFrameSize()), пустой - размер кадра
+    void setDerivativeFrameSize(const QSize &size);
+    // Наибольшая сторона кадра для process() (GL_MAX_TEXTURE_SIZE в GL backend'е,
+    // без ограничения в CPU). Большие изображения - через FrangiTiledProcessor
+    int maxFrameSize() const;
+    // На сколько пикселей vesselness зависит от соседей при текущих параметрах
+    // (blur ~3 sigma и производные, в multi-scale режиме - на уровнях пирамиды)
+    // для изображения frameSize. Тайл с таким полем совпадает с обработкой целиком
+    int supportRadius(const QSize &frameSize) const;
+    // Кратность начала тайла: 2^L для уровней пирамиды multi-scale режима, иначе 1
+    int tileAlignment() const;
+
+    // Callback, вызываемый для каждого обработанного кадра (помимо сигнала)
+    void setResultCallback(ResultCallback callback) { m_callback = std::move(callback); }
+
+    // Асинхронное чтение результата (кольцо PBO + fence'ы в GL backend'е):
+    // callback получает кадр N, пока считается кадр N+2. Пока callback задан,
+    // process() не читает vesselness синхронно и возвращает пустую карту,
+    // vesselnessReady() и ResultCallback не вызываются
+    void setReadbackCallback(ReadbackCallback callback);
+    void setReadbackFormat(FrangiReadbackFormat format);
+    // Регион в координатах кадра (строки сверху вниз), пустой - весь кадр
+    void setReadbackRoi(const QRect &roi);
+    // Дожидается и отдает все кадры в очереди чтения
+    void flushReadback();
+
+    // Время stage'ей выбранного backend'а (GPU passes или CPU ядра), см.
+    // FrangiProfiler. flushProfiler() дожидается результатов последних кадров
+    FrangiProfiler *profiler();
+    void flushProfiler();
+
+    // Синхронная обработка: возвращает vesselness карту кадра
+    FrangiVesselnessMap process(const QImage &frame);
+    // То же для плоскостей кадра без конвертации (NV12/YUYV/RGB, см. FrangiFrameView)
+    FrangiVesselnessMap process(const FrangiFrameView &frame);
+    // Несколько потоков за один проход: в GL backend'е кадры обрабатываются
+    // одним атласом (см. FrangiPipeline::setStreamCount()), CPU backend
+    // считает их по очереди. Результат всегда синхронный, карты - в порядке
+    // кадров (пустая для невалидного кадра)
+    QVector<FrangiVesselnessMap> process(const QVector<FrangiFrameView> &frames);
+
+public slots:
+    // Асинхронный вариант для queued соединений: результат приходит
+    // через vesselnessReady() и callback
+    void submitFrame(const QImage &frame);
+
+signals:
+    void vesselnessReady(const FrangiVesselnessMap &map);
+
+private:
+    bool initializeOpenGL();
+    bool makeCurrent();
+    void doneCurrent();
+    void updateVesselGraph(const FrangiVesselnessMap &map);
+
+    Backend m_backend;
+    bool m_initialized;
+
+    QOpenGLContext *m_context;
+    QOffscreenSurface *m_surface;
+    FrangiPipeline *m_pipeline;
+    FrangiCpuPipeline *m_cpuPipeline;
+    ResultCallback m_callback;
+
+    bool m_temporalEnabled;
+    bool m_centerlineEnabled;
+    FrangiVesselGraph *m_vesselGraph;
+    // Кадры нескольких потоков в CPU backend'е: граф не обновляется
+    bool m_vesselGraphSuspended;
+
+    ReadbackCallback m_readbackCallback;
+    FrangiReadbackFormat m_readbackFormat;
+    QRect m_readbackRoi;
+    quint64 m_cpuFrameIndex;
+};
+
+#endif // FRANGIENGINE_H
\ No newline at end of file
@@ -0,0 +1,141 @@
+#ifndef FRANGIFRAME_H
+#define FRANGIFRAME_H
+
+#include <QImage>
+#include <QRect>
+#include <QtGlobal>
+#include <chrono>
+#include <cmath>
+
+// Монотонное время в наносекундах, общее для всех потоков (задержка кадра)
+inline qint64 frangiMonotonicTime()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Кадр в памяти источника без копирования и конвертации: указатели на
+// плоскости (например, отображенного QVideoFrame) и их stride'ы.
+// Строки идут сверху вниз. Данные должны быть валидны только на время
+// вызова setFrame()/process(): конвейер копирует их сразу.
+struct FrangiFrameView
+{
+    enum Format {
+        FormatInvalid,
+        FormatRgb24,  // R, G, B
+        FormatRgbx,   // R, G, B, X
+        FormatBgrx,   // B, G, R, X
+        FormatNv12,   // плоскость Y + плоскость UV с половинным разрешением
+        FormatYuyv,   // Y0, U, Y1, V на пару пикселей
+        FormatUyvy    // U, Y0, V, Y1 на пару пикселей
+    };
+
+    Format format = FormatInvalid;
+    int width = 0;
+    int height = 0;
+    const uchar *planes[2] = { nullptr, nullptr };
+    int strides[2] = { 0, 0 };
+    // Время захвата кадра в микросекундах (0, если неизвестно)
+    qint64 timestamp = 0;
+    // Приход кадра в приложение, frangiMonotonicTime() (0, если неизвестно)
+    qint64 arrivalTime = 0;
+
+    bool isValid() const
+    {
+        return format != FormatInvalid && width > 0 && height > 0 && planes[0] &&
+               (format != FormatNv12 || planes[1]);
+    }
+
+    bool isYuv() const
+    {
+        return format == FormatNv12 || format == FormatYuyv || format == FormatUyvy;
+    }
+
+    // Вид на QImage с 8-битными RGB каналами, иначе невалидный кадр
+    static FrangiFrameView fromImage(const QImage &image)
+    {
+        FrangiFrameView view;
+        switch (image.format()) {
+            case QImage::Format_RGB888: view.format = FormatRgb24; break;
+            case QImage::Format_RGBX8888:
+            case QImage::Format_RGBA8888:
+            case QImage::Format_RGBA8888_Premultiplied: view.format = FormatRgbx; break;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+            // 0xAARRGGBB в памяти little-endian - B, G, R, A
+            case QImage::Format_RGB32:
+            case QImage::Format_ARGB32:
+            case QImage::Format_ARGB32_Premultiplied: view.format = FormatBgrx; break;
+#endif
+            default: return view;
+        }
+        view.width = image.width();
+        view.height = image.height();
+        view.planes[0] = image.constBits();
+        view.strides[0] = int(image.bytesPerLine());
+        return view;
+    }
+
+    // Вид на прямоугольник кадра (строки сверху вниз) без копирования: только
+    // смещения указателей. Прямоугольник обрезается по кадру, а для YUV
+    // расширяется до четных границ (пары пикселей YUYV/UYVY, блоки 2x2 NV12);
+    // фактический регион - alignedRect()
+    FrangiFrameView cropped(const QRect &rect) const
+    {
+        const QRect region = alignedRect(rect);
+        FrangiFrameView view = *this;
+        if (region.isEmpty()) {
+            view.format = FormatInvalid;
+            return view;
+        }
+        view.width = region.width();
+        view.height = region.height();
+        switch (format) {
+            case FormatRgb24: view.planes[0] += region.y() * strides[0] + region.x() * 3; break;
+            case FormatRgbx:
+            case FormatBgrx: view.planes[0] += region.y() * strides[0] + region.x() * 4; break;
+            case FormatYuyv:
+            case FormatUyvy: view.planes[0] += region.y() * strides[0] + region.x() * 2; break;
+            case FormatNv12:
+                view.planes[0] += region.y() * strides[0] + region.x();
+                view.planes[1] += (region.y() / 2) * strides[1] + region.x();
+                break;
+            default: break;
+        }
+        return view;
+    }
+
+    QRect alignedRect(const QRect &rect) const
+    {
+        QRect region = rect.intersected(QRect(0, 0, width, height));
+        if (region.isEmpty() || !isYuv()) return region;
+
+        const int left = region.left() & ~1;
+        const int right = qMin(width, (region.right() + 2) & ~1);
+        int top = region.top();
+        int bottom = region.bottom() + 1;
+        if (format == FormatNv12) {
+            top &= ~1;
+            bottom = qMin(height, (bottom + 1) & ~1);
+        }
+        return QRect(left, top, right - left, bottom - top);
+    }
+};
+
+// Yuv -> RGB (BT.601, limited range), как в шейдере распаковки кадра FrangiPipeline.
+// Каналы округляются до 8 бит, как при записи в RGBA8 текстуру кадра
+inline void frangiYuvToRgb(uchar y, uchar u, uchar v, float rgb[3])
+{
+    const float luma = (y - 16.0f) * 1.164383f / 255.0f;
+    const float cb = (u - 128.0f) / 255.0f;
+    const float cr = (v - 128.0f) / 255.0f;
+    const float linear[3] = {
+        luma + 1.596027f * cr,
+        luma - 0.391762f * cb - 0.812968f * cr,
+        luma + 2.017232f * cb
+    };
+    for (int i = 0; i < 3; ++i) {
+        rgb[i] = std::round(qBound(0.0f, linear[i], 1.0f) * 255.0f) / 255.0f;
+    }
+}
+
+#endif // FRANGIFRAME_H
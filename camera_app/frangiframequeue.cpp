@@ -0,0 +1,149 @@
+#include "frangiframequeue.h"
+#include <cstring>
+
+void FrangiFrameBuffer::assign(const FrangiFrameView &frame)
+{
+    format = frame.format;
+    width = frame.width;
+    height = frame.height;
+    timestamp = frame.timestamp;
+    arrivalTime = frame.arrivalTime;
+    
+    // Вторая плоскость есть только у NV12: UV с половинным разрешением по вертикали
+    const int planeCount = frame.format == FrangiFrameView::FormatNv12 ? 2 : 1;
+    for (int plane = 0; plane < 2; ++plane) {
+        if (plane >= planeCount) {
+            planes[plane].clear();
+            strides[plane] = 0;
+            continue;
+        }
+        
+        const int rows = plane == 0 ? frame.height : (frame.height + 1) / 2;
+        const int stride = frame.strides[plane];
+        // resize() не освобождает память при том же или меньшем размере,
+        // поэтому в установившемся режиме кадры копируются без аллокаций
+        planes[plane].resize(stride * rows);
+        memcpy(planes[plane].data(), frame.planes[plane], size_t(stride) * rows);
+        strides[plane] = stride;
+    }
+}
+
+FrangiFrameView FrangiFrameBuffer::view() const
+{
+    FrangiFrameView view;
+    view.format = format;
+    view.width = width;
+    view.height = height;
+    view.timestamp = timestamp;
+    view.arrivalTime = arrivalTime;
+    for (int plane = 0; plane < 2; ++plane) {
+        view.planes[plane] = planes[plane].isEmpty() ? nullptr
+                                                     : reinterpret_cast<const uchar *>(planes[plane].constData());
+        view.strides[plane] = strides[plane];
+    }
+    return view;
+}
+
+FrangiFrameQueue::FrangiFrameQueue()
+    : m_head(0)
+    , m_tail(0)
+    , m_freeHead(0)
+    , m_freeTail(0)
+    , m_producerSpare(nullptr)
+    , m_dropped(0)
+    , m_processed(0)
+{
+    for (int i = 0; i < kCapacity; ++i) {
+        m_slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+    
+    // Все буферы пула изначально свободны
+    for (int i = 0; i < kPoolSize; ++i) {
+        m_free[i].store(&m_pool[i], std::memory_order_relaxed);
+    }
+    m_freeHead.store(kPoolSize, std::memory_order_release);
+}
+
+FrangiFrameQueue::~FrangiFrameQueue()
+{
+}
+
+FrangiFrameBuffer *FrangiFrameQueue::acquire()
+{
+    if (m_producerSpare) {
+        FrangiFrameBuffer *buffer = m_producerSpare;
+        m_producerSpare = nullptr;
+        return buffer;
+    }
+    
+    const quint64 tail = m_freeTail.load(std::memory_order_relaxed);
+    if (tail == m_freeHead.load(std::memory_order_acquire)) {
+        // Не бывает, пока consumer держит не больше одного буфера
+        return nullptr;
+    }
+    FrangiFrameBuffer *buffer = m_free[tail % kPoolSize].load(std::memory_order_relaxed);
+    m_freeTail.store(tail + 1, std::memory_order_release);
+    return buffer;
+}
+
+void FrangiFrameQueue::push(FrangiFrameBuffer *buffer)
+{
+    const quint64 head = m_head.load(std::memory_order_relaxed);
+    quint64 tail = m_tail.load(std::memory_order_acquire);
+    
+    if (head - tail == quint64(kCapacity)) {
+        // Кольцо заполнено: забираем самый старый кадр. Если CAS не удался,
+        // consumer только что забрал его сам и место уже есть
+        FrangiFrameBuffer *oldest = m_slots[tail % kCapacity].load(std::memory_order_acquire);
+        if (m_tail.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel,
+                                           std::memory_order_acquire)) {
+            m_producerSpare = oldest;
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    
+    m_slots[head % kCapacity].store(buffer, std::memory_order_release);
+    m_head.store(head + 1, std::memory_order_release);
+}
+
+FrangiFrameBuffer *FrangiFrameQueue::pop()
+{
+    quint64 tail = m_tail.load(std::memory_order_acquire);
+    while (true) {
+        if (tail == m_head.load(std::memory_order_acquire)) return nullptr;
+        
+        // Слот читается до CAS: если producer успел отбросить этот кадр,
+        // CAS не удастся и прочитанный указатель не используется
+        FrangiFrameBuffer *buffer = m_slots[tail % kCapacity].load(std::memory_order_acquire);
+        if (m_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel,
+                                         std::memory_order_acquire)) {
+            return buffer;
+        }
+    }
+}
+
+FrangiFrameBuffer *FrangiFrameQueue::takeLatest()
+{
+    FrangiFrameBuffer *latest = nullptr;
+    while (FrangiFrameBuffer *buffer = pop()) {
+        if (latest) {
+            // Обработка не успевает за камерой: старый кадр уже не нужен
+            release(latest);
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        latest = buffer;
+    }
+    if (latest) {
+        m_processed.fetch_add(1, std::memory_order_relaxed);
+    }
+    return latest;
+}
+
+void FrangiFrameQueue::release(FrangiFrameBuffer *buffer)
+{
+    if (!buffer) return;
+    
+    const quint64 head = m_freeHead.load(std::memory_order_relaxed);
+    m_free[head % kPoolSize].store(buffer, std::memory_order_relaxed);
+    m_freeHead.store(head + 1, std::memory_order_release);
+}
@@ -0,0 +1,81 @@
+#ifndef FRANGIFRAMEQUEUE_H
+#define FRANGIFRAMEQUEUE_H
+
+#include <QByteArray>
+#include <atomic>
+#include "frangiframe.h"
+
+// Кадр в буфере пула: копия плоскостей (память переиспользуется между
+// кадрами). Исходный кадр показывает FrangiGLWidget из текстуры конвейера
+struct FrangiFrameBuffer
+{
+    FrangiFrameView::Format format = FrangiFrameView::FormatInvalid;
+    int width = 0;
+    int height = 0;
+    qint64 timestamp = 0;
+    qint64 arrivalTime = 0;
+    QByteArray planes[2];
+    int strides[2] = { 0, 0 };
+    // Время разбора в потоке захвата, мс (для FrangiProfiler)
+    double captureTime = 0.0;   // отображение и копирование плоскостей
+    double convertTime = 0.0;   // конвертация формата, который конвейер не читает
+
+    // Копирует плоскости кадра, не уменьшая выделенную память
+    void assign(const FrangiFrameView &frame);
+    FrangiFrameView view() const;
+};
+
+// Очередь кадров между потоком захвата (producer) и GUI потоком (consumer)
+// без блокировок. Кольцо на kCapacity кадров при переполнении отбрасывает
+// самый старый: producer сдвигает tail через CAS, consumer забирает кадры
+// тем же CAS, поэтому кадр получает ровно одна сторона. Буферы берутся из
+// пула на kCapacity + 2 штуки, выделенного заранее: в кольце, у producer'а
+// и у consumer'а одновременно.
+class FrangiFrameQueue
+{
+public:
+    static const int kCapacity = 3;
+    static const int kPoolSize = kCapacity + 2;
+
+    FrangiFrameQueue();
+    ~FrangiFrameQueue();
+
+    // Producer: свободный буфер для записи и публикация заполненного
+    FrangiFrameBuffer *acquire();
+    void push(FrangiFrameBuffer *buffer);
+
+    // Consumer: самый новый кадр (более старые возвращаются в пул как
+    // отброшенные) или nullptr; release() возвращает буфер в пул
+    FrangiFrameBuffer *takeLatest();
+    void release(FrangiFrameBuffer *buffer);
+
+    // Кадр, отброшенный до очереди (можно вызывать из любого потока)
+    void countDropped() { m_dropped.fetch_add(1, std::memory_order_relaxed); }
+
+    quint64 droppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+    quint64 processedCount() const { return m_processed.load(std::memory_order_relaxed); }
+
+private:
+    FrangiFrameBuffer *pop();
+
+    FrangiFrameBuffer m_pool[kPoolSize];
+
+    // Кольцо кадров: head пишет только producer, tail двигают обе стороны (CAS).
+    // Индексы растут монотонно, поэтому ABA невозможна
+    std::atomic<FrangiFrameBuffer *> m_slots[kCapacity];
+    std::atomic<quint64> m_head;
+    std::atomic<quint64> m_tail;
+
+    // Свободные буферы от consumer'а к producer'у (обычное SPSC кольцо)
+    std::atomic<FrangiFrameBuffer *> m_free[kPoolSize];
+    std::atomic<quint64> m_freeHead;
+    std::atomic<quint64> m_freeTail;
+
+    // Буфер, отброшенный producer'ом при переполнении (только поток producer'а)
+    FrangiFrameBuffer *m_producerSpare;
+
+    std::atomic<quint64> m_dropped;
+    std::atomic<quint64> m_processed;
+};
+
+#endif // FRANGIFRAMEQUEUE_H
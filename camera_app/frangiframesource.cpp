@@ -0,0 +1,270 @@
+#include "frangiframesource.h"
+#include "frangirecording.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <cstring>
+
+FrangiFrameSource *FrangiFrameSource::open(const QString &path, QString *error)
+{
+    FrangiFrameSource *source = nullptr;
+    bool opened = false;
+    
+    const QFileInfo info(path);
+    if (info.isFile() && info.suffix().compare("y4m", Qt::CaseInsensitive) == 0) {
+        FrangiY4mSource *y4m = new FrangiY4mSource();
+        opened = y4m->open(path);
+        source = y4m;
+    } else if (info.isFile() && info.suffix().compare("frec", Qt::CaseInsensitive) == 0) {
+        FrangiRecordingSource *recording = new FrangiRecordingSource();
+        opened = recording->open(path);
+        source = recording;
+    } else if (canOpen(path)) {
+        FrangiImageSequenceSource *sequence = new FrangiImageSequenceSource();
+        opened = sequence->open(path);
+        source = sequence;
+    } else {
+        if (error) *error = QString("Unsupported input: %1").arg(path);
+        return nullptr;
+    }
+    
+    if (!opened) {
+        if (error) *error = source->errorString();
+        delete source;
+        return nullptr;
+    }
+    return source;
+}
+
+bool FrangiFrameSource::canOpen(const QString &path)
+{
+    const QFileInfo info(path);
+    if (info.isDir()) return true;
+    if (!info.isFile()) return false;
+    
+    if (info.suffix().compare("y4m", Qt::CaseInsensitive) == 0) return true;
+    if (info.suffix().compare("frec", Qt::CaseInsensitive) == 0) return true;
+    return QDir::match(FrangiImageSequenceSource::nameFilters(), info.fileName());
+}
+
+bool FrangiY4mSource::open(const QString &path)
+{
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = QString("Cannot open %1: %2").arg(path, m_file.errorString());
+        return false;
+    }
+    
+    const QByteArray header = m_file.readLine(1024);
+    if (!parseHeader(header.trimmed())) {
+        m_file.close();
+        return false;
+    }
+    m_dataOffset = m_file.pos();
+    
+    // Y4M хранит плоскости подряд; NV12 - Y и чередующиеся UV на 4:2:0
+    const int chromaWidth = (m_width + 1) / 2;
+    const int chromaHeight = (m_height + 1) / 2;
+    qint64 frameSize = qint64(m_width) * m_height;
+    switch (m_chroma) {
+        case Chroma420: frameSize += 2 * qint64(chromaWidth) * chromaHeight; break;
+        case Chroma422: frameSize += 2 * qint64(chromaWidth) * m_height; break;
+        case Chroma444: frameSize += 2 * qint64(m_width) * m_height; break;
+        case ChromaMono: break;
+    }
+    m_raw.resize(int(frameSize));
+    m_nv12.resize(m_width * m_height + 2 * chromaWidth * chromaHeight);
+    return true;
+}
+
+bool FrangiY4mSource::parseHeader(const QByteArray &header)
+{
+    const QList<QByteArray> tokens = header.split(' ');
+    if (tokens.isEmpty() || tokens.first() != "YUV4MPEG2") {
+        m_error = "Not a YUV4MPEG2 stream";
+        return false;
+    }
+    
+    m_chroma = Chroma420;
+    for (int i = 1; i < tokens.size(); ++i) {
+        const QByteArray &token = tokens[i];
+        if (token.isEmpty()) continue;
+        
+        const QByteArray value = token.mid(1);
+        switch (token[0]) {
+            case 'W': m_width = value.toInt(); break;
+            case 'H': m_height = value.toInt(); break;
+            case 'F': {
+                const QList<QByteArray> ratio = value.split(':');
+                if (ratio.size() == 2 && ratio[1].toDouble() > 0.0) {
+                    m_frameRate = ratio[0].toDouble() / ratio[1].toDouble();
+                }
+                break;
+            }
+            case 'C':
+                // 420jpeg/420paldv/420mpeg2 отличаются только положением цветности
+                if (value == "420" || value == "420jpeg" || value == "420paldv" || value == "420mpeg2") {
+                    m_chroma = Chroma420;
+                } else if (value == "422") {
+                    m_chroma = Chroma422;
+                } else if (value == "444") {
+                    m_chroma = Chroma444;
+                } else if (value == "mono") {
+                    m_chroma = ChromaMono;
+                } else {
+                    m_error = QString("Unsupported Y4M colorspace C%1").arg(QString::fromLatin1(value));
+                    return false;
+                }
+                break;
+            default:
+                // I (interlacing), A (aspect), X (комментарии) не влияют на кадр
+                break;
+        }
+    }
+    
+    if (m_width <= 0 || m_height <= 0) {
+        m_error = "Y4M header has no frame size";
+        return false;
+    }
+    return true;
+}
+
+bool FrangiY4mSource::read(FrangiFrameView *frame)
+{
+    if (!m_file.isOpen()) return false;
+    
+    // Каждый кадр начинается со строки FRAME (параметры кадра игнорируются)
+    const QByteArray marker = m_file.readLine(1024);
+    if (marker.isEmpty()) return false;
+    if (!marker.startsWith("FRAME")) {
+        m_error = QString("Broken Y4M frame header at %1").arg(m_file.pos());
+        return false;
+    }
+    if (m_file.read(m_raw.data(), m_raw.size()) != m_raw.size()) {
+        m_error = "Truncated Y4M frame";
+        return false;
+    }
+    
+    const int chromaWidth = (m_width + 1) / 2;
+    const int chromaHeight = (m_height + 1) / 2;
+    const int lumaSize = m_width * m_height;
+    const uchar *raw = reinterpret_cast<const uchar *>(m_raw.constData());
+    uchar *nv12 = reinterpret_cast<uchar *>(m_nv12.data());
+    memcpy(nv12, raw, lumaSize);
+    
+    // Цветность -> чередующиеся UV с половинным разрешением
+    uchar *uv = nv12 + lumaSize;
+    const uchar *u = raw + lumaSize;
+    switch (m_chroma) {
+        case Chroma420: {
+            const uchar *v = u + chromaWidth * chromaHeight;
+            for (int i = 0; i < chromaWidth * chromaHeight; ++i) {
+                uv[2 * i] = u[i];
+                uv[2 * i + 1] = v[i];
+            }
+            break;
+        }
+        case Chroma422: {
+            const uchar *v = u + chromaWidth * m_height;
+            for (int y = 0; y < chromaHeight; ++y) {
+                const int y0 = 2 * y;
+                const int y1 = qMin(y0 + 1, m_height - 1);
+                for (int x = 0; x < chromaWidth; ++x) {
+                    uchar *dst = uv + (y * chromaWidth + x) * 2;
+                    dst[0] = uchar((u[y0 * chromaWidth + x] + u[y1 * chromaWidth + x] + 1) / 2);
+                    dst[1] = uchar((v[y0 * chromaWidth + x] + v[y1 * chromaWidth + x] + 1) / 2);
+                }
+            }
+            break;
+        }
+        case Chroma444: {
+            const uchar *v = u + lumaSize;
+            for (int y = 0; y < chromaHeight; ++y) {
+                const int y0 = 2 * y;
+                const int y1 = qMin(y0 + 1, m_height - 1);
+                for (int x = 0; x < chromaWidth; ++x) {
+                    const int x0 = 2 * x;
+                    const int x1 = qMin(x0 + 1, m_width - 1);
+                    uchar *dst = uv + (y * chromaWidth + x) * 2;
+                    dst[0] = uchar((u[y0 * m_width + x0] + u[y0 * m_width + x1] +
+                                    u[y1 * m_width + x0] + u[y1 * m_width + x1] + 2) / 4);
+                    dst[1] = uchar((v[y0 * m_width + x0] + v[y0 * m_width + x1] +
+                                    v[y1 * m_width + x0] + v[y1 * m_width + x1] + 2) / 4);
+                }
+            }
+            break;
+        }
+        case ChromaMono:
+            memset(uv, 128, 2 * chromaWidth * chromaHeight);
+            break;
+    }
+    
+    frame->format = FrangiFrameView::FormatNv12;
+    frame->width = m_width;
+    frame->height = m_height;
+    frame->planes[0] = nv12;
+    frame->planes[1] = uv;
+    frame->strides[0] = m_width;
+    frame->strides[1] = 2 * chromaWidth;
+    frame->timestamp = m_frameRate > 0.0 ? qint64(m_frameIndex * 1000000.0 / m_frameRate) : 0;
+    ++m_frameIndex;
+    return true;
+}
+
+bool FrangiY4mSource::rewind()
+{
+    m_frameIndex = 0;
+    return m_file.isOpen() && m_file.seek(m_dataOffset);
+}
+
+QStringList FrangiImageSequenceSource::nameFilters()
+{
+    return QStringList() << "*.png" << "*.tif" << "*.tiff" << "*.jpg" << "*.jpeg"
+                         << "*.bmp" << "*.pgm" << "*.ppm";
+}
+
+bool FrangiImageSequenceSource::open(const QString &path)
+{
+    const QFileInfo info(path);
+    if (info.isDir()) {
+        QDir dir(path);
+        const QStringList names = dir.entryList(nameFilters(), QDir::Files, QDir::Name);
+        for (const QString &name : names) {
+            m_files << dir.absoluteFilePath(name);
+        }
+    } else if (info.isFile()) {
+        m_files << info.absoluteFilePath();
+    }
+    
+    if (m_files.isEmpty()) {
+        m_error = QString("No images in %1").arg(path);
+        return false;
+    }
+    m_index = 0;
+    return true;
+}
+
+bool FrangiImageSequenceSource::read(FrangiFrameView *frame)
+{
+    if (m_index >= m_files.size()) return false;
+    
+    const QString &path = m_files[m_index++];
+    if (!m_image.load(path)) {
+        m_error = QString("Cannot load %1").arg(path);
+        return false;
+    }
+    
+    FrangiFrameView view = FrangiFrameView::fromImage(m_image);
+    if (!view.isValid()) {
+        m_image = m_image.convertToFormat(QImage::Format_RGB888);
+        view = FrangiFrameView::fromImage(m_image);
+    }
+    *frame = view;
+    return true;
+}
+
+bool FrangiImageSequenceSource::rewind()
+{
+    m_index = 0;
+    return true;
+}
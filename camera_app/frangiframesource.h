@@ -0,0 +1,87 @@
+#ifndef FRANGIFRAMESOURCE_H
+#define FRANGIFRAMESOURCE_H
+
+#include <QFile>
+#include <QImage>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "frangiframe.h"
+
+// Файловый источник кадров для работы без камеры (регрессионные наборы,
+// бенчмарки). Кадры читаются по запросу, без привязки ко времени:
+// скорость задает тот, кто вызывает read().
+class FrangiFrameSource
+{
+public:
+    virtual ~FrangiFrameSource() {}
+
+    // Следующий кадр; false в конце потока или при ошибке (см. errorString()).
+    // Плоскости кадра действительны до следующего вызова read()/rewind()
+    virtual bool read(FrangiFrameView *frame) = 0;
+    // Возврат к первому кадру
+    virtual bool rewind() = 0;
+    // Частота кадров из файла (0 - неизвестна)
+    virtual double frameRate() const { return 0.0; }
+    QString errorString() const { return m_error; }
+
+    // Источник по пути: *.y4m - Y4M поток, *.frec - запись FrangiRecorder
+    // (FrangiRecordingSource), каталог - последовательность
+    // изображений, файл изображения - последовательность из одного кадра.
+    // Для остальных путей (и при ошибке открытия) - nullptr
+    static FrangiFrameSource *open(const QString &path, QString *error = nullptr);
+    // Может ли open() прочитать путь (видео файлы читает QMediaPlayer приложения)
+    static bool canOpen(const QString &path);
+
+protected:
+    QString m_error;
+};
+
+// Несжатый YUV4MPEG2 поток (8 бит: C420*, C422, C444, Cmono).
+// Кадры отдаются как NV12: цветность 4:2:2/4:4:4 усредняется до 4:2:0
+class FrangiY4mSource : public FrangiFrameSource
+{
+public:
+    bool open(const QString &path);
+
+    bool read(FrangiFrameView *frame) override;
+    bool rewind() override;
+    double frameRate() const override { return m_frameRate; }
+
+private:
+    enum Chroma { Chroma420, Chroma422, Chroma444, ChromaMono };
+
+    bool parseHeader(const QByteArray &header);
+
+    QFile m_file;
+    qint64 m_dataOffset = 0;  // начало первого FRAME
+    int m_width = 0;
+    int m_height = 0;
+    double m_frameRate = 0.0;
+    Chroma m_chroma = Chroma420;
+    qint64 m_frameIndex = 0;
+
+    QByteArray m_raw;  // плоскости кадра в формате файла
+    QByteArray m_nv12;  // Y + чередующиеся UV
+};
+
+// Последовательность изображений (PNG, TIFF, JPEG, BMP, PGM/PPM), отсортированная
+// по имени. Изображения в форматах FrangiFrameView::fromImage() отдаются без
+// конвертации, остальные (16 бит, grayscale, палитра) - через RGB888
+class FrangiImageSequenceSource : public FrangiFrameSource
+{
+public:
+    bool open(const QString &path);
+
+    bool read(FrangiFrameView *frame) override;
+    bool rewind() override;
+
+    static QStringList nameFilters();
+
+private:
+    QStringList m_files;
+    int m_index = 0;
+    QImage m_image;
+};
+
+#endif // FRANGIFRAMESOURCE_H
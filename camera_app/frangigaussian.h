@@ -0,0 +1,106 @@
+#ifndef FRANGIGAUSSIAN_H
+#define FRANGIGAUSSIAN_H
+
+#include <QVector>
+#include <QtGlobal>
+#include <cmath>
+
+// Максимальный радиус ядра: 3 * sigma для максимального sigma в MainWindow (10.0)
+// с запасом. Под него рассчитаны uniform массивы и shared memory тайлы шейдеров
+static const int kFrangiMaxBlurRadius = 32;
+
+// Число выборок fragment шейдера blur с линейной выборкой: центр + пары texel'ей
+static const int kFrangiMaxLinearTaps = 1 + (kFrangiMaxBlurRadius + 1) / 2;
+
+// Радиус ядра ~3 sigma
+inline int frangiGaussianRadius(float sigma)
+{
+    return qBound(1, int(std::ceil(3.0f * sigma)), kFrangiMaxBlurRadius);
+}
+
+// Нормированные веса Gaussian ядра, weights[i + radius] соответствует смещению i
+inline QVector<float> frangiGaussianWeights(float sigma, int radius)
+{
+    QVector<float> weights(2 * radius + 1);
+    float totalWeight = 0.0f;
+    for (int i = -radius; i <= radius; ++i) {
+        float weight = std::exp(-float(i * i) / (2.0f * sigma * sigma));
+        weights[i + radius] = weight;
+        totalWeight += weight;
+    }
+    for (float &weight : weights) {
+        weight /= totalWeight;
+    }
+    return weights;
+}
+
+inline QVector<float> frangiGaussianWeights(float sigma)
+{
+    return frangiGaussianWeights(sigma, frangiGaussianRadius(sigma));
+}
+
+// Ядро для линейной выборки: texel'и 2i-1 и 2i объединяются в одну билинейную
+// выборку со смещением между ними, поэтому число выборок почти вдвое меньше.
+// mergedWeights[0] / offsets[0] - центральный texel, остальные - симметричные пары
+inline void frangiLinearSampledKernel(const QVector<float> &weights,
+                                      QVector<float> &mergedWeights, QVector<float> &offsets)
+{
+    const int radius = (weights.size() - 1) / 2;
+    const int taps = 1 + (radius + 1) / 2;
+    mergedWeights.resize(taps);
+    offsets.resize(taps);
+    
+    mergedWeights[0] = weights[radius];
+    offsets[0] = 0.0f;
+    for (int tap = 1; tap < taps; ++tap) {
+        const int i = 2 * tap - 1;
+        const float w1 = weights[radius + i];
+        const float w2 = i + 1 <= radius ? weights[radius + i + 1] : 0.0f;
+        mergedWeights[tap] = w1 + w2;
+        offsets[tap] = (i * w1 + (i + 1) * w2) / (w1 + w2);
+    }
+}
+
+// Multi-scale режим: число уровней пирамиды сверх полного разрешения
+static const int kFrangiMaxPyramidLevels = 3;
+
+// Уровень пирамиды для sigma: на уровне L остается sigma ~1-2 пикселя уровня,
+// поэтому крупные масштабы не требуют больших ядер
+inline int frangiPyramidLevel(float sigma)
+{
+    if (sigma <= 2.0f) return 0;
+    return qBound(0, int(std::ceil(std::log2(sigma / 2.0f))), kFrangiMaxPyramidLevels);
+}
+
+// Sigma blur'а на уровне L в пикселях уровня. Усреднение 2x2 на каждом уровне
+// уже дает дисперсию (4^L - 1) / 12 в пикселях полного разрешения
+inline float frangiLevelSigma(float sigma, int level)
+{
+    const float levelScale = float(1 << (2 * level));
+    const float variance = (sigma * sigma - (levelScale - 1.0f) / 12.0f) / levelScale;
+    return std::sqrt(qMax(variance, 0.25f));
+}
+
+// Множитель Hessian'а на уровне L: центральная разность с шагом 2 пикселя
+// (1 / 4), переход к пикселям полного разрешения (1 / 4^L) и нормировка sigma^gamma
+inline float frangiScaleNormalization(float sigma, float gamma, int level)
+{
+    return std::pow(sigma, gamma) / (4.0f * float(1 << (2 * level)));
+}
+
+// count значений sigma от minSigma до maxSigma с логарифмическим шагом
+inline QVector<float> frangiScaleRange(float minSigma, float maxSigma, int count)
+{
+    QVector<float> scales;
+    if (count <= 1) {
+        scales.append(minSigma);
+        return scales;
+    }
+    const float ratio = std::log(maxSigma / minSigma) / (count - 1);
+    for (int i = 0; i < count; ++i) {
+        scales.append(minSigma * std::exp(ratio * i));
+    }
+    return scales;
+}
+
+#endif // FRANGIGAUSSIAN_H
@@ -3,11 +3,13 @@
 
 #include <QOpenGLWidget>
 #include <QOpenGLExtraFunctions>
-#include <QOpenGLShaderProgram>
-#include <QOpenGLFramebufferObject>
-#include <QOpenGLTexture>
-#include <QOpenGLVertexArrayObject>
 #include <QImage>
+#include <QVector>
+#include "frangilatency.h"
+#include "frangipipeline.h"
+
+class FrangiVesselGraph;
+class QTimer;
 
 class FrangiGLWidget : public QOpenGLWidget, protected QOpenGLExtraFunctions
 {
@@ -18,76 +20,150 @@ public:
     ~FrangiGLWidget();
 
     void setFrame(const QImage &frame);
+    // Плоскости кадра копируются в PBO до возврата (без QImage и конвертаций)
+    void setFrame(const FrangiFrameView &frame);
+    // Несколько потоков: кадры попадают в тайлы атласа, виджет показывает их
+    // сеткой. Потоки без кадра показываются черными
+    void setStreamCount(int count) { m_pipeline->setStreamCount(count); update(); }
+    void setFrame(int stream, const FrangiFrameView &frame);
+    
+    // ROI режим (только один поток): прямоугольник, выделенный мышью на виджете,
+    // становится регионом кадра, который обрабатывает конвейер (со следующего
+    // кадра), двойной щелчок возвращает весь кадр. Производные считаются
+    // в масштабе всего кадра, поэтому внутри ROI результат тот же, кроме
+    // полосы ~3 sigma у его краев
+    void setRoiSelectionEnabled(bool enabled);
+    // Регион в координатах кадра (строки сверху вниз), пустой - весь кадр
+    void setRoi(const QRect &roi) { m_roi = roi; update(); }
+    QRect roi() const { return m_roi; }
     
     // Параметры Frangi фильтра
-    void setSigma(float sigma) { m_sigma = sigma; update(); }
-    void setBeta(float beta) { m_beta = beta; update(); }
-    void setC(float c) { m_c = c; update(); }
+    void setSigma(float sigma) { m_pipeline->setSigma(sigma); update(); }
+    void setBeta(float beta) { m_pipeline->setBeta(beta); update(); }
+    void setC(float c) { m_pipeline->setC(c); update(); }
     
     // Выбор отображаемого stage
     void setDisplayStage(int stage) { m_displayStage = stage; update(); }
     
+    // Скелет сосудов (stage Centerline) и граф по нему. Граф обновляется
+    // в paintGL() синхронным чтением маски, только пока показан этот stage
+    // и поток один
+    void setCenterlineParams(const FrangiCenterlineParams &params) { m_pipeline->setCenterlineParams(params); update(); }
+    const FrangiVesselGraph &vesselGraph() const { return *m_vesselGraph; }
+    
+    // Split view: слева исходный кадр из текстуры конвейера, справа выбранный stage.
+    // Превью не требует ни масштабирования, ни конвертации на CPU
+    void setSplitViewEnabled(bool enabled) { m_splitView = enabled; update(); }
+    
     // Включить/выключить инверсию
-    void setInvertEnabled(bool enabled) { m_invertEnabled = enabled; update(); }
+    void setInvertEnabled(bool enabled) { m_pipeline->setInvertEnabled(enabled); update(); }
+    
+    // Fused режим для passes 4-7 (для stage'ей 3-5 всегда используется полная цепочка)
+    void setFusedEnabled(bool enabled) { m_pipeline->setFusedEnabled(enabled); update(); }
+    
+    // Compute шейдеры для blur (GL 4.3+; для stage'ей 0-1 всегда fragment путь)
+    void setComputeEnabled(bool enabled) { m_pipeline->setComputeEnabled(enabled); update(); }
+    
+    // Точность промежуточных FBO (пересоздаются со следующим кадром)
+    void setPrecision(FrangiPrecision precision) { m_pipeline->setPrecision(precision); update(); }
+    
+    // Still режим: кадр не меняется, промежуточные stage'и сохраняются и
+    // изменение параметра пересчитывает только зависящие от него passes
+    void setStillMode(bool enabled) { m_pipeline->setStillMode(enabled); }
+    
+    // Multi-scale режим: максимум vesselness по нескольким sigma (для stage'ей 6-7)
+    void setMultiScaleEnabled(bool enabled) { m_pipeline->setMultiScaleEnabled(enabled); update(); }
+    void setScaleRange(float minSigma, float maxSigma, int count) { m_pipeline->setScaleRange(minSigma, maxSigma, count); update(); }
+    
+    // Temporal stage: vesselness усредняется по кадрам с компенсацией движения
+    void setTemporalEnabled(bool enabled) { m_pipeline->setTemporalEnabled(enabled); update(); }
+    
+    // Уменьшение кадра перед конвейером (см. FrangiPipeline::setProcessingDownscale),
+    // со следующего кадра. Stage'и растягиваются на тот же прямоугольник виджета
+    void setProcessingDownscale(int factor) { m_pipeline->setProcessingDownscale(factor); }
+    
+    // Асинхронное чтение vesselness после каждой отрисовки (см. FrangiAsyncReadback).
+    // Callback вызывается из paintGL() с задержкой в 2 кадра
+    void setReadbackCallback(FrangiAsyncReadback::Callback callback);
+    void setReadbackFormat(FrangiReadbackFormat format) { m_pipeline->asyncReadback()->setFormat(format); }
+    void setReadbackRoi(const QRect &roi) { m_pipeline->asyncReadback()->setRoi(roi); }
+
+    // Профилирование passes (GL_TIME_ELAPSED) и HUD с p50/p95/p99 поверх кадра
+    void setProfilingEnabled(bool enabled) { m_pipeline->profiler()->setEnabled(enabled); update(); }
+    void setHudVisible(bool visible) { m_hudVisible = visible; update(); }
+    FrangiProfiler *profiler() { return m_pipeline->profiler(); }
+    
+    // Задержка кадров первого потока: приход -> загрузка -> GPU (GL fence после
+    // отрисовки) -> показ (frameSwapped). Гистограммы копятся до clear()
+    FrangiLatencyTracker *latencyTracker() { return m_latencyTracker; }
+    // Тестовый режим задержки: поверх кадра рисуется шаблон текущего времени
+    // (для камеры, снимающей экран), из кадров читается их шаблон, и трекер
+    // получает glass-to-glass. Виджет перерисовывается непрерывно
+    void setLatencyPatternEnabled(bool enabled) { m_latencyPattern = enabled; update(); }
     
     // Размер изображения для шейдеров
-    int getImageWidth() const { return m_fboGray ? m_fboGray->width() : 512; }
-    int getImageHeight() const { return m_fboGray ? m_fboGray->height() : 512; }
+    int getImageWidth() const { return m_pipeline->width() ? m_pipeline->width() : 512; }
+    int getImageHeight() const { return m_pipeline->height() ? m_pipeline->height() : 512; }
 
 protected:
     void initializeGL() override;
     void resizeGL(int w, int h) override;
     void paintGL() override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
 
-private:
-    void createShaders();
-    void createFramebuffers();
-    void recreateFramebuffers(int width, int height);
-    void renderPass(QOpenGLShaderProgram *program, QOpenGLFramebufferObject *target,
-                    QOpenGLTexture *inputTexture);
-    void processFrame();
-
-    // Шейдерные программы
-    QOpenGLShaderProgram *m_grayscaleShader;
-    QOpenGLShaderProgram *m_invertShader;
-    QOpenGLShaderProgram *m_blurXShader;
-    QOpenGLShaderProgram *m_blurYShader;
-    QOpenGLShaderProgram *m_gradientsShader;
-    QOpenGLShaderProgram *m_hessianShader;
-    QOpenGLShaderProgram *m_eigenvaluesShader;
-    QOpenGLShaderProgram *m_vesselnessShader;
-    QOpenGLShaderProgram *m_overlayShader;
-    QOpenGLShaderProgram *m_visualizeShader;
+private slots:
+    void onFrameSwapped();
+    void pollFences();
 
-    // Framebuffers для промежуточных результатов
-    QOpenGLFramebufferObject *m_fboGray;
-    QOpenGLFramebufferObject *m_fboInvert;
-    QOpenGLFramebufferObject *m_fboBlurX;
-    QOpenGLFramebufferObject *m_fboBlurY;
-    QOpenGLFramebufferObject *m_fboGradients;
-    QOpenGLFramebufferObject *m_fboHessian;
-    QOpenGLFramebufferObject *m_fboEigenvalues;
-    QOpenGLFramebufferObject *m_fboVesselness;
-    QOpenGLFramebufferObject *m_fboOverlay;
+private:
+    // Кадр, отрисованный, но еще не показанный или не законченный GPU
+    struct PendingFrame
+    {
+        GLsync fence;
+        FrangiFrameTimes times;
+    };
 
-    // Входная текстура
-    QOpenGLTexture *m_inputTexture;
-    QImage m_currentFrame;
+    void drawHud();
+    void drawLatencyPattern();
+    void recordFrameTimes(const FrangiFrameView &frame);
+    void updateVesselGraph();
+    // Регион кадра для конвейера: roi - ROI, обрезанный по кадру (пустой - весь
+    // кадр). Запоминается для выбора мышью
+    QRect updateFrameRegion(const QSize &frameSize, const QRect &roi);
+    QPoint widgetToFrame(const QPoint &pos) const;
+    // Область выбранного stage'а в координатах виджета (правая половина в split view)
+    QRect outputRect() const;
 
-    // Параметры фильтра
-    float m_sigma;
-    float m_beta;
-    float m_c;
+    // Весь конвейер обработки живет в FrangiPipeline, виджет только показывает результат
+    FrangiPipeline *m_pipeline;
     
-    // Какой stage показывать (0=grayscale, 1=invert, 2=blur, 3=gradients, 4=hessian, 5=eigenvalues, 6=vesselness, 7=overlay)
+    // Какой stage показывать (0=grayscale, 1=invert, 2=blur, 3=gradients, 4=hessian, 5=eigenvalues, 6=vesselness, 7=overlay, 8=centerline)
     int m_displayStage;
-    
-    // Включена ли инверсия
-    bool m_invertEnabled;
+    FrangiVesselGraph *m_vesselGraph;
 
-    // Quad для рендеринга
-    QOpenGLVertexArrayObject *m_vao;
-    GLuint m_vbo;
+    // Показывать ли статистику профайлера
+    bool m_hudVisible;
+    bool m_splitView;
+    
+    // ROI режим: выбранный регион и регион кадра, который сейчас показан
+    bool m_roiSelectionEnabled;
+    QRect m_roi;
+    QRect m_shownRegion;
+    bool m_dragging;
+    QPoint m_dragStart;
+    QPoint m_dragEnd;
+    
+    // Задержка: времена последнего загруженного кадра (до его отрисовки)
+    // и кадры с fence'ами в порядке отрисовки
+    FrangiLatencyTracker *m_latencyTracker;
+    bool m_latencyPattern;
+    FrangiFrameTimes m_frameTimes;
+    bool m_frameTimesPending;
+    QVector<PendingFrame> m_pendingFrames;
+    QTimer *m_fenceTimer;
 };
 
 #endif // FRANGIGLWIDGET_H
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "frangilatency.h"
+#include "frangiframequeue.h"
+#include <QPainter>
+#include <cmath>
+
+namespace {
+
+const int kCellCount = kFrangiPatternBits + 2;
+const quint32 kPatternMask = (1u << kFrangiPatternBits) - 1;
+
+// Клетка шаблона в кадре: полоса высотой в десятую часть кадра
+QRect patternCell(int cell, int width, int height)
+{
+    const int left = cell * width / kCellCount;
+    const int right = (cell + 1) * width / kCellCount;
+    return QRect(left, 0, right - left, qMax(1, height / 10));
+}
+
+// Клетки слева направо: белая, черная, биты кода Грея от старшего
+QVector<bool> patternCells(qint64 timeMs)
+{
+    const quint32 value = quint32(timeMs) & kPatternMask;
+    const quint32 gray = value ^ (value >> 1);
+    QVector<bool> cells(kCellCount);
+    cells[0] = true;
+    cells[1] = false;
+    for (int bit = 0; bit < kFrangiPatternBits; ++bit) {
+        cells[2 + bit] = (gray >> (kFrangiPatternBits - 1 - bit)) & 1;
+    }
+    return cells;
+}
+
+// Яркость пикселя (0-255) в любом формате кадра
+int pixelLuma(const FrangiFrameView &frame, int x, int y)
+{
+    const uchar *row = frame.planes[0] + y * frame.strides[0];
+    switch (frame.format) {
+        case FrangiFrameView::FormatRgb24: return (row[3 * x] + row[3 * x + 1] + row[3 * x + 2]) / 3;
+        case FrangiFrameView::FormatRgbx:
+        case FrangiFrameView::FormatBgrx: return (row[4 * x] + row[4 * x + 1] + row[4 * x + 2]) / 3;
+        case FrangiFrameView::FormatNv12: return row[x];
+        case FrangiFrameView::FormatYuyv: return row[2 * x];
+        case FrangiFrameView::FormatUyvy: return row[2 * x + 1];
+        case FrangiFrameView::FormatInvalid: break;
+    }
+    return 0;
+}
+
+} // namespace
+
+FrangiLatencyHistogram::FrangiLatencyHistogram()
+    : m_bins(kBinCount, 0)
+    , m_count(0)
+    , m_sum(0.0)
+    , m_max(0.0)
+{
+}
+
+void FrangiLatencyHistogram::add(double milliseconds)
+{
+    milliseconds = qMax(0.0, milliseconds);
+    ++m_bins[qMin(kBinCount - 1, int(milliseconds))];
+    ++m_count;
+    m_sum += milliseconds;
+    m_max = qMax(m_max, milliseconds);
+}
+
+void FrangiLatencyHistogram::clear()
+{
+    m_bins.fill(0);
+    m_count = 0;
+    m_sum = 0.0;
+    m_max = 0.0;
+}
+
+double FrangiLatencyHistogram::percentile(double fraction) const
+{
+    if (m_count == 0) return 0.0;
+    const quint64 target = quint64(std::ceil(fraction * m_count));
+    quint64 accumulated = 0;
+    for (int bin = 0; bin < kBinCount; ++bin) {
+        accumulated += m_bins[bin];
+        if (accumulated >= target) {
+            return bin == kBinCount - 1 ? m_max : bin + 1.0;
+        }
+    }
+    return m_max;
+}
+
+void FrangiLatencyTracker::addFrame(const FrangiFrameTimes &times)
+{
+    m_lastFrame = times;
+    if (!times.capture) return;
+    
+    m_histograms[CaptureToUpload].add((times.upload - times.capture) / 1e6);
+    m_histograms[CaptureToGpuDone].add((times.gpuDone - times.capture) / 1e6);
+    m_histograms[CaptureToPresent].add((times.present - times.capture) / 1e6);
+    // Кадр виден, когда он и показан, и дорисован GPU
+    if (times.content) {
+        m_histograms[GlassToGlass].add((qMax(times.present, times.gpuDone) - times.content) / 1e6);
+    }
+}
+
+void FrangiLatencyTracker::clear()
+{
+    for (FrangiLatencyHistogram &histogram : m_histograms) {
+        histogram.clear();
+    }
+    m_lastFrame = FrangiFrameTimes();
+}
+
+const char *FrangiLatencyTracker::intervalName(Interval interval)
+{
+    switch (interval) {
+        case CaptureToUpload: return "capture>upload";
+        case CaptureToGpuDone: return "capture>gpu";
+        case CaptureToPresent: return "capture>present";
+        case GlassToGlass: return "glass>glass";
+        case IntervalCount: break;
+    }
+    return "";
+}
+
+QImage frangiLatencyPatternImage(qint64 timeMs, const QSize &size)
+{
+    QImage image(size.width(), patternCell(0, size.width(), size.height()).height(), QImage::Format_RGB32);
+    const QVector<bool> cells = patternCells(timeMs);
+    QPainter painter(&image);
+    for (int cell = 0; cell < kCellCount; ++cell) {
+        painter.fillRect(patternCell(cell, size.width(), size.height()), cells[cell] ? Qt::white : Qt::black);
+    }
+    return image;
+}
+
+void frangiStampLatencyPattern(FrangiFrameBuffer *frame, qint64 timeMs)
+{
+    const QVector<bool> cells = patternCells(timeMs);
+    // Limited range для YUV, цветность полосы - нейтральная
+    const bool yuv = frame->format == FrangiFrameView::FormatNv12 || frame->format == FrangiFrameView::FormatYuyv ||
+                     frame->format == FrangiFrameView::FormatUyvy;
+    const uchar white = yuv ? 235 : 255;
+    const uchar black = yuv ? 16 : 0;
+    for (int cell = 0; cell < kCellCount; ++cell) {
+        const QRect rect = patternCell(cell, frame->width, frame->height);
+        const uchar value = cells[cell] ? white : black;
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            uchar *row = reinterpret_cast<uchar *>(frame->planes[0].data()) + y * frame->strides[0];
+            for (int x = rect.left(); x <= rect.right(); ++x) {
+                switch (frame->format) {
+                    case FrangiFrameView::FormatRgb24:
+                        row[3 * x] = row[3 * x + 1] = row[3 * x + 2] = value;
+                        break;
+                    case FrangiFrameView::FormatRgbx:
+                    case FrangiFrameView::FormatBgrx:
+                        row[4 * x] = row[4 * x + 1] = row[4 * x + 2] = value;
+                        break;
+                    case FrangiFrameView::FormatNv12:
+                        row[x] = value;
+                        break;
+                    case FrangiFrameView::FormatYuyv:
+                        row[2 * x] = value;
+                        row[2 * x + 1] = 128;
+                        break;
+                    case FrangiFrameView::FormatUyvy:
+                        row[2 * x] = 128;
+                        row[2 * x + 1] = value;
+                        break;
+                    case FrangiFrameView::FormatInvalid:
+                        return;
+                }
+            }
+            if (frame->format == FrangiFrameView::FormatNv12 && y % 2 == 0) {
+                uchar *chroma = reinterpret_cast<uchar *>(frame->planes[1].data()) + (y / 2) * frame->strides[1];
+                for (int x = rect.left() & ~1; x <= rect.right(); ++x) {
+                    chroma[x] = 128;
+                }
+            }
+        }
+    }
+}
+
+bool frangiReadLatencyPattern(const FrangiFrameView &frame, qint64 nowMs, qint64 *timeMs)
+{
+    if (!frame.isValid()) return false;
+    
+    // Средняя яркость центральной половины клетки: края размыты камерой
+    QVector<int> levels(kCellCount);
+    for (int cell = 0; cell < kCellCount; ++cell) {
+        const QRect rect = patternCell(cell, frame.width, frame.height);
+        const QRect core = rect.adjusted(rect.width() / 4, rect.height() / 4, -rect.width() / 4, -rect.height() / 4);
+        int sum = 0;
+        int count = 0;
+        for (int y = core.top(); y <= core.bottom(); ++y) {
+            for (int x = core.left(); x <= core.right(); ++x) {
+                sum += pixelLuma(frame, x, y);
+                ++count;
+            }
+        }
+        levels[cell] = count ? sum / count : 0;
+    }
+    
+    // Без контраста опорных клеток шаблона в кадре нет
+    if (levels[0] - levels[1] < 64) return false;
+    const int threshold = (levels[0] + levels[1]) / 2;
+    quint32 gray = 0;
+    for (int bit = 0; bit < kFrangiPatternBits; ++bit) {
+        gray = (gray << 1) | (levels[2 + bit] > threshold ? 1u : 0u);
+    }
+    quint32 value = gray;
+    for (quint32 shift = gray >> 1; shift; shift >>= 1) {
+        value ^= shift;
+    }
+    
+    // Восстанавливаем старшие биты по текущему времени
+    const qint64 age = (quint32(nowMs) - value) & kPatternMask;
+    *timeMs = nowMs - age;
+    return true;
+}
@@ -0,0 +1,91 @@
+#ifndef FRANGILATENCY_H
+#define FRANGILATENCY_H
+
+#include <QImage>
+#include <QVector>
+#include "frangiframe.h"
+
+struct FrangiFrameBuffer;
+
+// Моменты одного кадра по frangiMonotonicTime(), нс (0 - неизвестно)
+struct FrangiFrameTimes
+{
+    qint64 mediaTimestamp = 0;  // QVideoFrame::startTime() источника, мкс
+    qint64 content = 0;         // время из шаблона в самом кадре (тестовый режим)
+    qint64 capture = 0;         // приход кадра в поток захвата
+    qint64 upload = 0;          // кадр загружен в конвейер (команды GL отправлены)
+    qint64 gpuDone = 0;         // GL fence после обработки и отрисовки сработал
+    qint64 present = 0;         // frameSwapped() виджета
+};
+
+// Гистограмма задержек с корзинами по 1 мс; последняя корзина - все, что
+// не меньше kBinCount - 1 мс
+class FrangiLatencyHistogram
+{
+public:
+    static const int kBinCount = 250;
+
+    FrangiLatencyHistogram();
+
+    void add(double milliseconds);
+    void clear();
+
+    quint64 count() const { return m_count; }
+    double mean() const { return m_count ? m_sum / m_count : 0.0; }
+    double max() const { return m_max; }
+    // Верхняя граница корзины, в которой лежит доля fraction задержек
+    double percentile(double fraction) const;
+    const QVector<quint64> &bins() const { return m_bins; }
+
+private:
+    QVector<quint64> m_bins;
+    quint64 m_count;
+    double m_sum;
+    double m_max;
+};
+
+// Задержки кадров по интервалам: от прихода кадра до загрузки, готовности
+// GPU и показа, и glass-to-glass - от времени в шаблоне кадра до показа
+// (только в тестовом режиме, см. frangiStampLatencyPattern()). Показ - момент
+// frameSwapped(): scanout монитора сюда не входит.
+class FrangiLatencyTracker
+{
+public:
+    enum Interval {
+        CaptureToUpload,
+        CaptureToGpuDone,
+        CaptureToPresent,
+        GlassToGlass,
+        IntervalCount
+    };
+
+    // Кадр с известными capture, upload, gpuDone и present
+    void addFrame(const FrangiFrameTimes &times);
+    void clear();
+
+    const FrangiLatencyHistogram &histogram(Interval interval) const { return m_histograms[interval]; }
+    const FrangiFrameTimes &lastFrame() const { return m_lastFrame; }
+    static const char *intervalName(Interval interval);
+
+private:
+    FrangiLatencyHistogram m_histograms[IntervalCount];
+    FrangiFrameTimes m_lastFrame;
+};
+
+// Шаблон времени для измерения задержки целиком: полоса сверху кадра из
+// kFrangiPatternBits + 2 клеток - белая и черная (опорные уровни) и биты
+// времени в миллисекундах (по модулю 2^kFrangiPatternBits, код Грея: кадр,
+// снятый во время смены шаблона, ошибается не больше чем на одну единицу)
+const int kFrangiPatternBits = 24;
+
+// Рисует шаблон времени timeMs в полосе сверху кадра (на экране - для
+// съемки камерой)
+QImage frangiLatencyPatternImage(qint64 timeMs, const QSize &size);
+// Вписывает шаблон в плоскости кадра: файловый источник вместо камеры,
+// которая снимала бы шаблон на экране
+void frangiStampLatencyPattern(FrangiFrameBuffer *frame, qint64 timeMs);
+// Время из шаблона кадра, ближайшее к nowMs и не позже него; false - шаблона
+// в кадре нет (клетки неконтрастны)
+bool frangiReadLatencyPattern(const FrangiFrameView &frame, qint64 nowMs, qint64 *timeMs);
+
+#endif // FRANGILATENCY_H
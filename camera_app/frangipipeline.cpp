@@ -0,0 +1,2447 @@
+#include "frangipipeline.h"
+#include <QDebug>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+FrangiPipeline::FrangiPipeline()
+    : m_initialized(false)
+    , m_maxTextureSize(0)
+    , m_shaders(new FrangiShaderManager())
+    , m_unpackShader(nullptr)
+    , m_grayscaleShader(nullptr)
+    , m_invertShader(nullptr)
+    , m_blurXShader(nullptr)
+    , m_blurYShader(nullptr)
+    , m_gradientsShader(nullptr)
+    , m_hessianShader(nullptr)
+    , m_eigenvaluesShader(nullptr)
+    , m_vesselnessShader(nullptr)
+    , m_fusedVesselnessShader(nullptr)
+    , m_overlayShader(nullptr)
+    , m_visualizeShader(nullptr)
+    , m_downsampleShader(nullptr)
+    , m_scaleMaxShader(nullptr)
+    , m_centerlineNmsShader(nullptr)
+    , m_hysteresisShader(nullptr)
+    , m_thinningShader(nullptr)
+    , m_temporalLumaShader(nullptr)
+    , m_temporalDownsampleShader(nullptr)
+    , m_temporalMotionShader(nullptr)
+    , m_temporalBlendShader(nullptr)
+    , m_blurXComputeShader(nullptr)
+    , m_blurYComputeShader(nullptr)
+    , m_fboFrame(nullptr)
+    , m_targetPool(new FrangiTargetPool())
+    , m_displayStage(StageOverlay)
+    , m_scaleAccumIndex(0)
+    , m_uploads(1)
+    , m_streamCount(1)
+    , m_tileWidth(0)
+    , m_tileHeight(0)
+    , m_tileGutter(0)
+    , m_atlasColumns(1)
+    , m_atlasRows(1)
+    , m_processingDownscale(1)
+    , m_requestedDownscale(1)
+    , m_hasFrame(false)
+    , m_frameTimestamp(0)
+    , m_frameArrival(0)
+    , m_dirtyStage(StageGrayscale)
+    , m_stillMode(false)
+    , m_validPyramidLevels(0)
+    , m_multiScaleValid(false)
+    , m_frameProcessed(false)
+    , m_asyncReadback(new FrangiAsyncReadback())
+    , m_asyncReadbackEnabled(false)
+    , m_profiler(new FrangiProfiler())
+    , m_sigma(1.5f)
+    , m_beta(0.5f)
+    , m_c(15.0f)
+    , m_invertEnabled(true)  // По умолчанию инверсия включена
+    , m_multiScaleEnabled(false)
+    , m_multiScaleActive(false)
+    , m_gamma(2.0f)
+    , m_fusedEnabled(true)
+    , m_temporalEnabled(false)
+    , m_temporalActive(false)
+    , m_temporalIndex(0)
+    , m_temporalHistoryValid(false)
+    , m_temporalNewFrame(false)
+    , m_computeEnabled(false)
+    , m_computeAvailable(false)
+    , m_weightsUbo(0)
+    , m_computeImageFormat(0)
+    , m_precision(FrangiPrecisionBalanced)
+    , m_framebuffersDirty(false)
+    , m_blurRadius(0)
+    , m_blurWeightsDirty(true)
+    , m_vao(nullptr)
+    , m_vbo(0)
+{
+    for (int stage = 0; stage < kStageCount; ++stage) {
+        m_stageTargets[stage] = nullptr;
+    }
+    m_fboScaleAccum[0] = nullptr;
+    m_fboScaleAccum[1] = nullptr;
+    for (int i = 0; i < 2; ++i) {
+        m_temporalHistory[i] = nullptr;
+        m_temporalLuma[i] = nullptr;
+        m_temporalCoarse[i] = nullptr;
+    }
+    updateBlurKernel();
+    setScaleRange(1.0f, 8.0f, 5);
+}
+
+FrangiPipeline::~FrangiPipeline()
+{
+    // Контекст, в котором создавались ресурсы, должен быть текущим
+    delete m_shaders;
+    
+    delete m_fboFrame;
+    releaseScaleLevels();
+    releaseTemporalTargets();
+    delete m_targetPool;
+    
+    delete m_vao;
+    delete m_asyncReadback;
+    delete m_profiler;
+    
+    if (m_vbo) {
+        glDeleteBuffers(1, &m_vbo);
+    }
+    
+    if (m_weightsUbo) {
+        glDeleteBuffers(1, &m_weightsUbo);
+    }
+    
+    if (m_initialized) {
+        for (const StreamUpload &upload : m_uploads) {
+            glDeleteTextures(2, upload.planeTextures);
+            glDeleteBuffers(2 * kUploadRingSize, upload.uploadPbos);
+        }
+    }
+}
+
+void FrangiPipeline::initialize()
+{
+    if (m_initialized) return;
+    
+    initializeOpenGLFunctions();
+    m_targetPool->initialize();
+    
+    qDebug() << "FrangiPipeline: OpenGL version:" << (const char*)glGetString(GL_VERSION);
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &m_maxTextureSize);
+    
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    
+    // Создаем VAO и VBO для quad
+    m_vao = new QOpenGLVertexArrayObject();
+    m_vao->create();
+    m_vao->bind();
+    
+    float vertices[] = {
+        -1.0f, -1.0f, 0.0f, 0.0f,
+         1.0f, -1.0f, 1.0f, 0.0f,
+        -1.0f,  1.0f, 0.0f, 1.0f,
+         1.0f,  1.0f, 1.0f, 1.0f
+    };
+    
+    glGenBuffers(1, &m_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    
+    m_vao->release();
+    
+    createShaders();
+    m_asyncReadback->initialize();
+    
+    m_initialized = true;
+}
+
+void FrangiPipeline::setFrame(const QImage &frame)
+{
+    if (frame.isNull()) {
+        qDebug() << "Frame is null!";
+        return;
+    }
+    
+    // Форматы, которые шейдер распаковки читает напрямую, не конвертируются
+    FrangiFrameView view = FrangiFrameView::fromImage(frame);
+    if (view.isValid()) {
+        setFrame(view);
+        return;
+    }
+    
+    QImage rgbFrame = frame.convertToFormat(QImage::Format_RGB888);
+    setFrame(FrangiFrameView::fromImage(rgbFrame));
+}
+
+void FrangiPipeline::setFrame(int stream, const FrangiFrameView &frame)
+{
+    if (!m_initialized || stream < 0 || stream >= m_streamCount) return;
+    
+    if (!frame.isValid()) {
+        qDebug() << "Frame is invalid!";
+        return;
+    }
+    
+    // Новый кадр профайлера: загрузка всех потоков и passes до следующего кадра потока 0
+    if (stream == 0) {
+        m_profiler->beginFrame();
+    }
+    FrangiCpuProfileScope uploadScope(m_profiler, FrangiProfiler::SectionUpload);
+    FrangiGpuProfileScope unpackScope(m_profiler, FrangiProfiler::SectionUnpack);
+    
+    // Новое уменьшение меняет тайлы всех потоков и ядро blur'а
+    if (m_requestedDownscale != m_processingDownscale) {
+        m_processingDownscale = m_requestedDownscale;
+        for (StreamUpload &other : m_uploads) {
+            other.frameSize = scaledFrameSize(other.sourceSize);
+        }
+        updateBlurKernel();
+        invalidate(StageGrayscale);
+    }
+    
+    // Пересоздаем framebuffer'ы если размер изображения изменился
+    StreamUpload &upload = m_uploads[stream];
+    upload.sourceSize = QSize(frame.width, frame.height);
+    upload.frameSize = scaledFrameSize(upload.sourceSize);
+    updateAtlasLayout();
+    
+    // Номер формата для шейдера распаковки: 0 - RGB, 1 - NV12, 2 - YUYV, 3 - UYVY
+    const int pairWidth = (frame.width + 1) / 2;
+    int unpackFormat = 0;
+    switch (frame.format) {
+        case FrangiFrameView::FormatRgb24:
+            uploadPlane(upload, 0, frame.planes[0], frame.strides[0], frame.width, frame.height, GL_RGB8, GL_RGB, 3);
+            break;
+        case FrangiFrameView::FormatRgbx:
+            uploadPlane(upload, 0, frame.planes[0], frame.strides[0], frame.width, frame.height, GL_RGBA8, GL_RGBA, 4);
+            break;
+        case FrangiFrameView::FormatBgrx:
+            uploadPlane(upload, 0, frame.planes[0], frame.strides[0], frame.width, frame.height, GL_RGBA8, GL_BGRA, 4);
+            break;
+        case FrangiFrameView::FormatNv12:
+            uploadPlane(upload, 0, frame.planes[0], frame.strides[0], frame.width, frame.height, GL_R8, GL_RED, 1);
+            uploadPlane(upload, 1, frame.planes[1], frame.strides[1], pairWidth, (frame.height + 1) / 2, GL_RG8, GL_RG, 2);
+            unpackFormat = 1;
+            break;
+        case FrangiFrameView::FormatYuyv:
+        case FrangiFrameView::FormatUyvy:
+            // Пара пикселей - один RGBA texel
+            uploadPlane(upload, 0, frame.planes[0], frame.strides[0], pairWidth, frame.height, GL_RGBA8, GL_RGBA, 4);
+            unpackFormat = frame.format == FrangiFrameView::FormatYuyv ? 2 : 3;
+            break;
+        case FrangiFrameView::FormatInvalid:
+            return;
+    }
+    upload.uploadIndex = (upload.uploadIndex + 1) % kUploadRingSize;
+    
+    unpackFrame(stream, unpackFormat);
+    m_hasFrame = true;
+    m_frameTimestamp = frame.timestamp;
+    m_frameArrival = frame.arrivalTime;
+    m_frameProcessed = false;
+    m_temporalNewFrame = true;
+    invalidate(StageGrayscale);
+}
+
+void FrangiPipeline::uploadPlane(StreamUpload &upload, int plane, const uchar *data, int stride,
+                                 int width, int height, GLenum internalFormat, GLenum format,
+                                 int bytesPerPixel)
+{
+    // Текстура пересоздается только при смене размера или формата
+    if (!upload.planeTextures[plane]) {
+        glGenTextures(1, &upload.planeTextures[plane]);
+    }
+    glBindTexture(GL_TEXTURE_2D, upload.planeTextures[plane]);
+    if (upload.planeWidths[plane] != width || upload.planeHeights[plane] != height ||
+        upload.planeFormats[plane] != internalFormat) {
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        upload.planeWidths[plane] = width;
+        upload.planeHeights[plane] = height;
+        upload.planeFormats[plane] = internalFormat;
+    }
+    
+    // Stride, кратный размеру пикселя, передается через GL_UNPACK_ROW_LENGTH
+    // и плоскость копируется одним memcpy, иначе - построчно без padding'а
+    const int rowBytes = width * bytesPerPixel;
+    const bool rowLength = stride % bytesPerPixel == 0;
+    const int size = rowLength ? stride * (height - 1) + rowBytes : rowBytes * height;
+    
+    // Кольцо PBO: пока GPU забирает PBO предыдущих кадров, пишем в следующий.
+    // GL_MAP_INVALIDATE_BUFFER_BIT позволяет драйверу не ждать старое содержимое
+    const int pboIndex = plane * kUploadRingSize + upload.uploadIndex;
+    if (!upload.uploadPbos[pboIndex]) {
+        glGenBuffers(1, &upload.uploadPbos[pboIndex]);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload.uploadPbos[pboIndex]);
+    if (upload.uploadPboSizes[pboIndex] < size) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        upload.uploadPboSizes[pboIndex] = size;
+    }
+    
+    void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped) {
+        if (rowLength) {
+            memcpy(mapped, data, size);
+        } else {
+            for (int y = 0; y < height; ++y) {
+                memcpy(static_cast<uchar *>(mapped) + y * rowBytes, data + y * stride, rowBytes);
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, rowLength ? stride / bytesPerPixel : 0);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, nullptr);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    } else {
+        qDebug() << "Failed to map upload PBO";
+    }
+    
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void FrangiPipeline::unpackFrame(int stream, int unpackFormat)
+{
+    // Распаковка плоскостей в RGBA8 кадр в порядке строк GL. В атласе
+    // рисуется тайл вместе с полями: координаты за кадром прижимаются к краю
+    const StreamUpload &upload = m_uploads[stream];
+    const QRect frameRect = streamRect(stream);
+    m_fboFrame->bind();
+    glViewport(frameRect.x() - m_tileGutter, frameRect.y() - m_tileGutter,
+               m_tileWidth + 2 * m_tileGutter, m_tileHeight + 2 * m_tileGutter);
+    m_unpackShader->bind();
+    m_unpackShader->setUniformValue(uniform(m_unpackShader, "uFormat"), unpackFormat);
+    m_unpackShader->setUniformValue(uniform(m_unpackShader, "uOrigin"), frameRect.topLeft());
+    m_unpackShader->setUniformValue(uniform(m_unpackShader, "uFrameSize"), frameRect.size());
+    m_unpackShader->setUniformValue(uniform(m_unpackShader, "uSourceSize"), upload.sourceSize);
+    m_unpackShader->setUniformValue(uniform(m_unpackShader, "uDownscale"), m_processingDownscale);
+    m_vao->bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, upload.planeTextures[0]);
+    m_unpackShader->setUniformValue(uniform(m_unpackShader, "uPlane0"), 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, upload.planeTextures[unpackFormat == 1 ? 1 : 0]);
+    m_unpackShader->setUniformValue(uniform(m_unpackShader, "uPlane1"), 1);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glActiveTexture(GL_TEXTURE0);
+    m_vao->release();
+    m_unpackShader->release();
+    m_fboFrame->release();
+}
+
+void FrangiPipeline::setStreamCount(int count)
+{
+    count = qMax(1, count);
+    if (count == m_streamCount) return;
+    
+    while (m_uploads.size() < count) {
+        m_uploads.append(StreamUpload());
+    }
+    for (int i = count; i < m_uploads.size(); ++i) {
+        m_uploads[i].sourceSize = QSize();
+        m_uploads[i].frameSize = QSize();
+    }
+    m_streamCount = count;
+    m_framebuffersDirty = true;
+}
+
+void FrangiPipeline::updateAtlasLayout()
+{
+    int tileWidth = 0;
+    int tileHeight = 0;
+    for (int i = 0; i < m_streamCount; ++i) {
+        tileWidth = qMax(tileWidth, m_uploads[i].frameSize.width());
+        tileHeight = qMax(tileHeight, m_uploads[i].frameSize.height());
+    }
+    
+    // Поле покрывает носитель blur'а и Sobel + Hessian (три шага, по y шаг
+    // растянут в H/W раз) плюс texel на билинейную выборку. Blur - с радиусом
+    // для максимального sigma (в пикселях уменьшенного кадра), поэтому смена
+    // sigma не перестраивает атлас и не стирает тайлы других потоков
+    int gutter = 0;
+    if (m_streamCount > 1) {
+        const float aspect = qMax(1.0f, float(tileHeight) / float(qMax(1, tileWidth)));
+        const int blurRadius = (kFrangiMaxBlurRadius + m_processingDownscale - 1) / m_processingDownscale;
+        gutter = blurRadius + int(std::ceil(3.0f * aspect)) + 1;
+    }
+    const int columns = int(std::ceil(std::sqrt(float(m_streamCount))));
+    const int rows = (m_streamCount + columns - 1) / columns;
+    
+    const bool changed = tileWidth != m_tileWidth || tileHeight != m_tileHeight ||
+                         gutter != m_tileGutter || columns != m_atlasColumns || rows != m_atlasRows;
+    m_tileWidth = tileWidth;
+    m_tileHeight = tileHeight;
+    m_tileGutter = gutter;
+    m_atlasColumns = columns;
+    m_atlasRows = rows;
+    
+    if (!m_fboFrame || changed || m_framebuffersDirty) {
+        recreateFramebuffers(columns * (tileWidth + 2 * gutter), rows * (tileHeight + 2 * gutter));
+    }
+}
+
+QRect FrangiPipeline::streamRect(int stream) const
+{
+    if (stream < 0 || stream >= m_streamCount) return QRect();
+    
+    const int cellWidth = m_tileWidth + 2 * m_tileGutter;
+    const int cellHeight = m_tileHeight + 2 * m_tileGutter;
+    const int column = stream % m_atlasColumns;
+    const int row = m_atlasRows - 1 - stream / m_atlasColumns;
+    const QSize size = m_uploads[stream].frameSize;
+    return QRect(column * cellWidth + m_tileGutter, row * cellHeight + m_tileGutter,
+                 size.width(), size.height());
+}
+
+void FrangiPipeline::setDerivativeFrameSize(const QSize &size)
+{
+    if (size == m_derivativeFrameSize) return;
+    m_derivativeFrameSize = size;
+    invalidate(StageGradients);
+}
+
+QSize FrangiPipeline::scaledFrameSize(const QSize &size) const
+{
+    if (size.isEmpty()) return size;
+    return QSize((size.width() + m_processingDownscale - 1) / m_processingDownscale,
+                 (size.height() + m_processingDownscale - 1) / m_processingDownscale);
+}
+
+QSize FrangiPipeline::derivativeFrameSize() const
+{
+    if (!m_derivativeFrameSize.isEmpty()) return scaledFrameSize(m_derivativeFrameSize);
+    return QSize(qMax(1, m_tileWidth), qMax(1, m_tileHeight));
+}
+
+QVector2D FrangiPipeline::sobelStep() const
+{
+    // Шаг Sobel - 1/W кадра по обеим осям в UV кадра (по y это H/W texel'а).
+    // В атласе и для тайла большого изображения то же смещение в texel'ах
+    // пересчитывается в UV обрабатываемой текстуры
+    const QSize frame = derivativeFrameSize();
+    return QVector2D(1.0f / width(), float(frame.height()) / frame.width() / height());
+}
+
+void FrangiPipeline::createShaders()
+{
+    QString vertexShader = R"(
+        #version 330 core
+        layout(location = 0) in vec2 position;
+        layout(location = 1) in vec2 texCoord;
+        out vec2 vUv;
+        
+        void main() {
+            vUv = texCoord;
+            gl_Position = vec4(position, 0.0, 1.0);
+        }
+    )";
+    m_shaders->initialize(vertexShader);
+    
+    // Unpack shader - плоскости кадра -> RGB. Кадр в памяти идет сверху вниз,
+    // поэтому строка переворачивается здесь, а не копией на CPU. При
+    // уменьшении texel - среднее uDownscale x uDownscale пикселей кадра
+    m_unpackShader = m_shaders->createProgram("unpack", R"(
+        #version 330 core
+        out vec4 FragColor;
+        uniform sampler2D uPlane0;
+        uniform sampler2D uPlane1;
+        uniform int uFormat;  // 0 - RGB, 1 - NV12, 2 - YUYV, 3 - UYVY
+        uniform ivec2 uOrigin;     // левый нижний угол кадра в атласе
+        uniform ivec2 uFrameSize;  // размер после уменьшения
+        uniform ivec2 uSourceSize;
+        uniform int uDownscale;
+        
+        // Пиксель p кадра (строки сверху вниз)
+        vec3 decode(ivec2 p) {
+            if(uFormat == 0) {
+                return texelFetch(uPlane0, p, 0).rgb;
+            }
+            
+            float y;
+            vec2 chroma;
+            if(uFormat == 1) {
+                y = texelFetch(uPlane0, p, 0).r;
+                chroma = texelFetch(uPlane1, p / 2, 0).rg;
+            } else {
+                // Texel хранит пару пикселей: Y0 U Y1 V (YUYV) или U Y0 V Y1 (UYVY)
+                vec4 pair = texelFetch(uPlane0, ivec2(p.x / 2, p.y), 0);
+                bool odd = (p.x & 1) != 0;
+                if(uFormat == 2) {
+                    y = odd ? pair.b : pair.r;
+                    chroma = pair.ga;
+                } else {
+                    y = odd ? pair.a : pair.g;
+                    chroma = pair.rb;
+                }
+            }
+            
+            // BT.601, limited range
+            float luma = (y - 16.0 / 255.0) * 1.164383;
+            float cb = chroma.x - 128.0 / 255.0;
+            float cr = chroma.y - 128.0 / 255.0;
+            vec3 rgb = vec3(luma + 1.596027 * cr,
+                            luma - 0.391762 * cb - 0.812968 * cr,
+                            luma + 2.017232 * cb);
+            return clamp(rgb, 0.0, 1.0);
+        }
+        
+        void main() {
+            // Поля тайла повторяют крайние пиксели, как GL_CLAMP_TO_EDGE
+            ivec2 q = clamp(ivec2(gl_FragCoord.xy) - uOrigin, ivec2(0), uFrameSize - 1);
+            vec3 sum = vec3(0.0);
+            for(int y = 0; y < uDownscale; y++) {
+                for(int x = 0; x < uDownscale; x++) {
+                    ivec2 s = min(q * uDownscale + ivec2(x, y), uSourceSize - 1);
+                    sum += decode(ivec2(s.x, uSourceSize.y - 1 - s.y));
+                }
+            }
+            FragColor = vec4(sum / float(uDownscale * uDownscale), 1.0);
+        }
+    )");
+    
+    // Grayscale shader
+    m_grayscaleShader = m_shaders->createProgram("grayscale", R"(
+        #version 330 core
+        in vec2 vUv;
+        out vec4 FragColor;
+        uniform sampler2D uTexture;
+        
+        void main() {
+            vec4 color = texture(uTexture, vUv);
+            float gray = dot(color.rgb, vec3(0.299, 0.587, 0.114));
+            FragColor = vec4(gray, gray, gray, 1.0);
+        }
+    )");
+    
+    // Invert shader
+    m_invertShader = m_shaders->createProgram("invert", R"(
+        #version 330 core
+        in vec2 vUv;
+        out vec4 FragColor;
+        uniform sampler2D uTexture;
+        
+        void main() {
+            vec4 color = texture(uTexture, vUv);
+            float inverted = 1.0 - color.x;
+            FragColor = vec4(inverted, inverted, inverted, 1.0);
+        }
+    )");
+    
+    // Blur X shader: веса и смещения считаются на CPU в updateBlurKernel(),
+    // пары texel'ей берутся одной билинейной выборкой
+    m_blurXShader = m_shaders->createProgram("blur x", QString(R"(
+        #version 330 core
+        #define MAX_TAPS %1
+        in vec2 vUv;
+        out vec4 FragColor;
+        uniform sampler2D uTexture;
+        uniform float uWeights[MAX_TAPS];
+        uniform float uOffsets[MAX_TAPS];
+        uniform int uTapCount;
+        
+        void main() {
+            float texel = 1.0 / float(textureSize(uTexture, 0).x);
+            vec4 sum = texture(uTexture, vUv) * uWeights[0];
+            
+            for(int i = 1; i < uTapCount; i++) {
+                vec2 offset = vec2(texel, 0.0) * uOffsets[i];
+                sum += (texture(uTexture, vUv + offset) + texture(uTexture, vUv - offset)) * uWeights[i];
+            }
+            
+            FragColor = sum;
+        }
+    )").arg(kFrangiMaxLinearTaps));
+    
+    // Blur Y shader: веса и смещения считаются на CPU в updateBlurKernel(),
+    // пары texel'ей берутся одной билинейной выборкой
+    m_blurYShader = m_shaders->createProgram("blur y", QString(R"(
+        #version 330 core
+        #define MAX_TAPS %1
+        in vec2 vUv;
+        out vec4 FragColor;
+        uniform sampler2D uTexture;
+        uniform float uWeights[MAX_TAPS];
+        uniform float uOffsets[MAX_TAPS];
+        uniform int uTapCount;
+        
+        void main() {
+            float texel = 1.0 / float(textureSize(uTexture, 0).y);
+            vec4 sum = texture(uTexture, vUv) * uWeights[0];
+            
+            for(int i = 1; i < uTapCount; i++) {
+                vec2 offset = vec2(0.0, texel) * uOffsets[i];
+                sum += (texture(uTexture, vUv + offset) + texture(uTexture, vUv - offset)) * uWeights[i];
+            }
+            
+            FragColor = sum;
+        }
+    )").arg(kFrangiMaxLinearTaps));
+    
+    // Gradients shader (Sobel)
+    m_gradientsShader = m_shaders->createProgram("gradients", R"(
+        #version 330 core
+        in vec2 vUv;
+        out vec4 FragColor;
+        uniform sampler2D uTexture;
+        uniform vec2 uStep;  // шаг в UV, см. FrangiPipeline::sobelStep()
+        
+        void main() {
+            vec2 h = uStep;
+            
+            // Sobel X
+            float gx = texture(uTexture, vUv + vec2(-h.x, -h.y)).x * -1.0;
+            gx += texture(uTexture, vUv + vec2(-h.x, 0.0)).x * -2.0;
+            gx += texture(uTexture, vUv + vec2(-h.x, h.y)).x * -1.0;
+            gx += texture(uTexture, vUv + vec2(h.x, -h.y)).x * 1.0;
+            gx += texture(uTexture, vUv + vec2(h.x, 0.0)).x * 2.0;
+            gx += texture(uTexture, vUv + vec2(h.x, h.y)).x * 1.0;
+            gx /= 8.0;
+            
+            // Sobel Y
+            float gy = texture(uTexture, vUv + vec2(-h.x, -h.y)).x * -1.0;
+            gy += texture(uTexture, vUv + vec2(0.0, -h.y)).x * -2.0;
+            gy += texture(uTexture, vUv + vec2(h.x, -h.y)).x * -1.0;
+            gy += texture(uTexture, vUv + vec2(-h.x, h.y)).x * 1.0;
+            gy += texture(uTexture, vUv + vec2(0.0, h.y)).x * 2.0;
+            gy += texture(uTexture, vUv + vec2(h.x, h.y)).x * 1.0;
+            gy /= 8.0;
+            
+            FragColor = vec4(gx, gy, 0.0, 1.0);
+        }
+    )");
+    
+    // Hessian shader
+    m_hessianShader = m_shaders->createProgram("hessian", R"(
+        #version 330 core
+        in vec2 vUv;
+        out vec4 FragColor;
+        uniform sampler2D uTexture;
+        uniform vec2 uStep;              // два шага Sobel
+        uniform float uDerivativeScale;  // 1 / (2h) в долях ширины кадра
+        
+        void main() {
+            vec2 h = uStep;
+            
+            vec4 c = texture(uTexture, vUv);
+            vec4 px = texture(uTexture, vUv + vec2(h.x, 0.0));
+            vec4 nx = texture(uTexture, vUv - vec2(h.x, 0.0));
+            vec4 py = texture(uTexture, vUv + vec2(0.0, h.y));
+            vec4 ny = texture(uTexture, vUv - vec2(0.0, h.y));
+            
+            float fxx = (px.x - nx.x) * uDerivativeScale;
+            float fyy = (py.y - ny.y) * uDerivativeScale;
+            float fxy = (py.x - ny.x) * uDerivativeScale;
+            
+            FragColor = vec4(fxx, fxy, fyy, 1.0);
+        }
+    )");
+    
+    // Eigenvalues shader
+    m_eigenvaluesShader = m_shaders->createProgram("eigenvalues", R"(
+        #version 330 core
+        in vec2 vUv;
+        out vec4 FragColor;
+        uniform sampler2D uTexture;
+        
+        void main() {
+            vec4 h = texture(uTexture, vUv);
+            float fxx = h.x;
+            float fxy = h.y;
+            float fyy = h.z;
+            
+            float trace = fxx + fyy;
+            float det = fxx * fyy - fxy * fxy;
+            
+            float disc = trace * trace - 4.0 * det;
+            if(disc < 0.0) disc = 0.0;
+            
+            float sqrtDisc = sqrt(disc);
+            float lambda1 = 0.5 * (trace + sqrtDisc);
+            float lambda2 = 0.5 * (trace - sqrtDisc);
+            
+            if(abs(lambda1) > abs(lambda2)) {
+                float tmp = lambda1;
+                lambda1 = lambda2;
+                lambda2 = tmp;
+            }
+            
+            FragColor = vec4(lambda1, lambda2, 0.0, 1.0);
+        }
+    )");
+    
+    // Vesselness shader
+    m_vesselnessShader = m_shaders->createProgram("vesselness", R"(
+        #version 330 core
+        in vec2 vUv;
+        out vec4 FragColor;
+        uniform sampler2D uTexture;
+        uniform float uBeta;
+        uniform float uC;
+        
+        void main() {
+            vec4 eigs = texture(uTexture, vUv);
+            float lambda1 = eigs.x;
+            float lambda2 = eigs.y;
+            
+            float vesselness = 0.0;
+            
+            if(lambda2 < 0.0) {
+                float beta_sq = uBeta * uBeta;
+                float c_sq = uC * uC;
+                
+                float rb = lambda1 / (lambda2 + 1e-6);
+                rb = rb * rb;
+                
+                float s2 = lambda1*lambda1 + lambda2*lambda2;
+                
+                float term1 = exp(-rb / beta_sq);
+                float term2 = 1.0 - exp(-s2 / c_sq);
+                
+                vesselness = term1 * term2;
+            }
+            
+            FragColor = vec4(vec3(vesselness), 1.0);
+        }
+    )");
+    
+    // Fused vesselness shader - gradients, hessian, eigenvalues и vesselness
+    // в одном проходе. Sobel считается в центрах тех texel'ей, которые выбрал бы
+    // GL_NEAREST в шейдере hessian, поэтому результат совпадает с цепочкой passes 4-7
+    m_fusedVesselnessShader = m_shaders->createProgram("fused vesselness", R"(
+        #version 330 core
+        in vec2 vUv;
+        out vec4 FragColor;
+        uniform sampler2D uTexture;
+        uniform float uBeta;
+        uniform float uC;
+        // Шаги Sobel и Hessian в текстурных координатах и множитель
+        // центральной разности (в single-scale режиме как в шейдерах
+        // gradients/hessian: 1/W и 2/W по обеим осям, W/4)
+        uniform vec2 uSobelStep;
+        uniform vec2 uHessianStep;
+        uniform float uDerivativeScale;
+        
+        vec2 texSize;
+        
+        // Центр texel'я, который выберет GL_NEAREST с GL_CLAMP_TO_EDGE
+        vec2 snapToTexel(vec2 uv) {
+            vec2 texel = clamp(floor(uv * texSize), vec2(0.0), texSize - 1.0);
+            return (texel + 0.5) / texSize;
+        }
+        
+        // Sobel как в шейдере gradients
+        vec2 sobel(vec2 uv) {
+            vec2 c = snapToTexel(uv);
+            vec2 h = uSobelStep;
+            
+            float lb = texture(uTexture, c + vec2(-h.x, -h.y)).x;
+            float l  = texture(uTexture, c + vec2(-h.x, 0.0)).x;
+            float lt = texture(uTexture, c + vec2(-h.x, h.y)).x;
+            float rb = texture(uTexture, c + vec2(h.x, -h.y)).x;
+            float r  = texture(uTexture, c + vec2(h.x, 0.0)).x;
+            float rt = texture(uTexture, c + vec2(h.x, h.y)).x;
+            float b  = texture(uTexture, c + vec2(0.0, -h.y)).x;
+            float t  = texture(uTexture, c + vec2(0.0, h.y)).x;
+            
+            float gx = (-lb - 2.0 * l - lt + rb + 2.0 * r + rt) / 8.0;
+            float gy = (-lb - 2.0 * b - rb + lt + 2.0 * t + rt) / 8.0;
+            return vec2(gx, gy);
+        }
+        
+        void main() {
+            texSize = vec2(textureSize(uTexture, 0));
+            vec2 h = uHessianStep;
+            
+            // Hessian
+            vec2 px = sobel(vUv + vec2(h.x, 0.0));
+            vec2 nx = sobel(vUv - vec2(h.x, 0.0));
+            vec2 py = sobel(vUv + vec2(0.0, h.y));
+            vec2 ny = sobel(vUv - vec2(0.0, h.y));
+            
+            float fxx = (px.x - nx.x) * uDerivativeScale;
+            float fyy = (py.y - ny.y) * uDerivativeScale;
+            float fxy = (py.x - ny.x) * uDerivativeScale;
+            
+            // Eigenvalues
+            float trace = fxx + fyy;
+            float det = fxx * fyy - fxy * fxy;
+            
+            float disc = trace * trace - 4.0 * det;
+            if(disc < 0.0) disc = 0.0;
+            
+            float sqrtDisc = sqrt(disc);
+            float lambda1 = 0.5 * (trace + sqrtDisc);
+            float lambda2 = 0.5 * (trace - sqrtDisc);
+            
+            if(abs(lambda1) > abs(lambda2)) {
+                float tmp = lambda1;
+                lambda1 = lambda2;
+                lambda2 = tmp;
+            }
+            
+            // Vesselness
+            float vesselness = 0.0;
+            
+            if(lambda2 < 0.0) {
+                float beta_sq = uBeta * uBeta;
+                float c_sq = uC * uC;
+                
+                float rb = lambda1 / (lambda2 + 1e-6);
+                rb = rb * rb;
+                
+                float s2 = lambda1*lambda1 + lambda2*lambda2;
+                
+                float term1 = exp(-rb / beta_sq);
+                float term2 = 1.0 - exp(-s2 / c_sq);
+                
+                vesselness = term1 * term2;
+            }
+            
+            FragColor = vec4(vesselness, 0.0, 0.0, 1.0);
+        }
+    )");
+    
+    // Downsample shader - уровень пирамиды multi-scale режима, среднее 2x2
+    m_downsampleShader = m_shaders->createProgram("downsample", R"(
+        #version 330 core
+        out vec4 FragColor;
+        uniform sampler2D uTexture;
+        
+        void main() {
+            // Нечетный размер: последний texel повторяется (как GL_CLAMP_TO_EDGE)
+            ivec2 last = textureSize(uTexture, 0) - 1;
+            ivec2 p = ivec2(gl_FragCoord.xy) * 2;
+            float sum = texelFetch(uTexture, min(p, last), 0).x
+                      + texelFetch(uTexture, min(p + ivec2(1, 0), last), 0).x
+                      + texelFetch(uTexture, min(p + ivec2(0, 1), last), 0).x
+                      + texelFetch(uTexture, min(p + ivec2(1, 1), last), 0).x;
+            FragColor = vec4(sum * 0.25, 0.0, 0.0, 1.0);
+        }
+    )");
+    
+    // Scale max shader - максимум vesselness по масштабам и sigma максимума.
+    // Vesselness уровня пирамиды растягивается билинейной выборкой
+    m_scaleMaxShader = m_shaders->createProgram("scale max", R"(
+        #version 330 core
+        in vec2 vUv;
+        out vec4 FragColor;
+        uniform sampler2D uScale;
+        uniform sampler2D uAccum;
+        uniform float uSigma;
+        uniform int uFirst;
+        
+        void main() {
+            float vesselness = texture(uScale, vUv).x;
+            vec2 accum = uFirst != 0 ? vec2(-1.0, 0.0) : texture(uAccum, vUv).xy;
+            if(vesselness > accum.x) {
+                accum = vec2(vesselness, uSigma);
+            }
+            FragColor = vec4(accum, 0.0, 1.0);
+        }
+    )");
+    
+    // Overlay shader - накладывает vesselness на исходное изображение
+    m_overlayShader = m_shaders->createProgram("overlay", R"(
+        #version 330 core
+        in vec2 vUv;
+        out vec4 FragColor;
+        uniform sampler2D uOriginal;
+        uniform sampler2D uVesselness;
+        
+        void main() {
+            vec4 original = texture(uOriginal, vUv);
+            float vessel = texture(uVesselness, vUv).x;
+            
+            // Просто добавляем vesselness к исходному, без усиления и clamp
+            // В белых местах получится пересвет
+            vessel = vessel * 100.0; // Усиление x100!
+            vessel = clamp(vessel, 0.0, 1.0);
+            vessel = vessel * vessel; // Мягкий контраст для лучшей видимости
+
+            vec3 overlay = original.rgb + vec3(vessel);
+            
+            FragColor = vec4(overlay, 1.0);
+        }
+    )");
+    
+    // Centerline NMS shader - vesselness не меньше соседей поперек сосуда.
+    // Направление - собственный вектор Hessian'а самой vesselness с наибольшей
+    // по модулю кривизной, соседи - билинейной выборкой на расстоянии texel'я.
+    // Выход: 0.5 - слабый кандидат (>= uLow), 1.0 - сильный (>= uHigh).
+    // CPU версия - frangiCenterlineNmsRows()
+    m_centerlineNmsShader = m_shaders->createProgram("centerline nms", R"(
+        #version 330 core
+        out vec4 FragColor;
+        uniform sampler2D uTexture;
+        uniform float uLow;
+        uniform float uHigh;
+        
+        ivec2 last;
+        
+        float fetch(ivec2 p) {
+            return texelFetch(uTexture, clamp(p, ivec2(0), last), 0).x;
+        }
+        
+        // Текстура vesselness - GL_NEAREST, интерполяция вручную
+        float bilinear(vec2 p) {
+            vec2 f = floor(p);
+            vec2 t = p - f;
+            ivec2 i = ivec2(f);
+            float a = fetch(i);
+            float b = fetch(i + ivec2(0, 1));
+            float low = a + (fetch(i + ivec2(1, 0)) - a) * t.x;
+            float high = b + (fetch(i + ivec2(1, 1)) - b) * t.x;
+            return low + (high - low) * t.y;
+        }
+        
+        void main() {
+            last = textureSize(uTexture, 0) - 1;
+            ivec2 p = ivec2(gl_FragCoord.xy);
+            float v = fetch(p);
+            float result = 0.0;
+            
+            if(v >= uLow) {
+                float dxx = fetch(p + ivec2(1, 0)) + fetch(p - ivec2(1, 0)) - 2.0 * v;
+                float dyy = fetch(p + ivec2(0, 1)) + fetch(p - ivec2(0, 1)) - 2.0 * v;
+                float dxy = (fetch(p + ivec2(1, 1)) - fetch(p + ivec2(1, -1))
+                           - fetch(p + ivec2(-1, 1)) + fetch(p + ivec2(-1, -1))) * 0.25;
+                float halfDiff = 0.5 * (dxx - dyy);
+                float lambda = 0.5 * (dxx + dyy) - sqrt(halfDiff * halfDiff + dxy * dxy);
+                
+                vec2 n = vec2(dxy, lambda - dxx);
+                vec2 other = vec2(lambda - dyy, dxy);
+                if(dot(n, n) < dot(other, other)) n = other;
+                float len = length(n);
+                n = len > 1e-12 ? n / len : vec2(1.0, 0.0);
+                // Вправо или вниз кадра (ось y здесь вверх), как на CPU
+                if(n.x < 0.0 || (n.x == 0.0 && n.y > 0.0)) n = -n;
+                
+                float ahead = bilinear(vec2(p) + n);
+                float behind = bilinear(vec2(p) - n);
+                if(v > ahead && v >= behind) {
+                    result = v >= uHigh ? 1.0 : 0.5;
+                }
+            }
+            
+            FragColor = vec4(result, 0.0, 0.0, 1.0);
+        }
+    )");
+    
+    // Hysteresis shader - один pass распространения: слабый кандидат
+    // с сильным 8-соседом становится сильным
+    m_hysteresisShader = m_shaders->createProgram("hysteresis", R"(
+        #version 330 core
+        out vec4 FragColor;
+        uniform sampler2D uTexture;
+        
+        void main() {
+            ivec2 size = textureSize(uTexture, 0);
+            ivec2 p = ivec2(gl_FragCoord.xy);
+            float value = texelFetch(uTexture, p, 0).x;
+            
+            if(value > 0.25 && value < 0.75) {
+                for(int dy = -1; dy <= 1; dy++) {
+                    for(int dx = -1; dx <= 1; dx++) {
+                        ivec2 q = p + ivec2(dx, dy);
+                        if(all(greaterThanEqual(q, ivec2(0))) && all(lessThan(q, size)) &&
+                           texelFetch(uTexture, q, 0).x > 0.75) {
+                            value = 1.0;
+                        }
+                    }
+                }
+            }
+            
+            FragColor = vec4(value, 0.0, 0.0, 1.0);
+        }
+    )");
+    
+    // Thinning shader - подпроход Zhang-Suen. Передний план - только сильные
+    // пиксели, поэтому первый подпроход отбрасывает слабые. CPU версия -
+    // frangiThinningRows() (там север - предыдущая строка, здесь +y)
+    m_thinningShader = m_shaders->createProgram("thinning", R"(
+        #version 330 core
+        out vec4 FragColor;
+        uniform sampler2D uTexture;
+        uniform int uSubiteration;
+        
+        ivec2 size;
+        
+        bool foreground(ivec2 q) {
+            return all(greaterThanEqual(q, ivec2(0))) && all(lessThan(q, size)) &&
+                   texelFetch(uTexture, q, 0).x > 0.75;
+        }
+        
+        void main() {
+            size = textureSize(uTexture, 0);
+            ivec2 p = ivec2(gl_FragCoord.xy);
+            if(!foreground(p)) {
+                FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+                return;
+            }
+            
+            // Соседи P2..P9 по часовой стрелке, начиная с севера
+            bool n[8] = bool[8](foreground(p + ivec2(0, 1)), foreground(p + ivec2(1, 1)),
+                                foreground(p + ivec2(1, 0)), foreground(p + ivec2(1, -1)),
+                                foreground(p + ivec2(0, -1)), foreground(p + ivec2(-1, -1)),
+                                foreground(p + ivec2(-1, 0)), foreground(p + ivec2(-1, 1)));
+            int neighbours = 0;
+            int transitions = 0;
+            for(int i = 0; i < 8; i++) {
+                neighbours += n[i] ? 1 : 0;
+                transitions += (!n[i] && n[(i + 1) % 8]) ? 1 : 0;
+            }
+            
+            bool side = uSubiteration == 0 ? !(n[0] && n[2] && n[4]) && !(n[2] && n[4] && n[6])
+                                           : !(n[0] && n[2] && n[6]) && !(n[0] && n[4] && n[6]);
+            bool remove = neighbours >= 2 && neighbours <= 6 && transitions == 1 && side;
+            FragColor = vec4(remove ? 0.0 : 1.0, 0.0, 0.0, 1.0);
+        }
+    )");
+    
+    // Temporal luma shader - яркость кадра (CPU версия - frangiTemporalLumaRows())
+    m_temporalLumaShader = m_shaders->createProgram("temporal luma", R"(
+        #version 330 core
+        out vec4 FragColor;
+        uniform sampler2D uTexture;
+        
+        void main() {
+            vec3 color = texelFetch(uTexture, ivec2(gl_FragCoord.xy), 0).rgb;
+            FragColor = vec4(dot(color, vec3(0.299, 0.587, 0.114)), 0.0, 0.0, 1.0);
+        }
+    )");
+    
+    // Temporal downsample shader - средняя яркость блока kFrangiTemporalScale^2
+    // texel'ей (CPU версия - frangiTemporalDownsampleRows())
+    m_temporalDownsampleShader = m_shaders->createProgram("temporal downsample", QString(R"(
+        #version 330 core
+        out vec4 FragColor;
+        uniform sampler2D uTexture;
+        
+        const int SCALE = %1;
+        
+        void main() {
+            ivec2 last = textureSize(uTexture, 0) - 1;
+            ivec2 origin = ivec2(gl_FragCoord.xy) * SCALE;
+            float sum = 0.0;
+            for(int y = 0; y < SCALE; y++) {
+                for(int x = 0; x < SCALE; x++) {
+                    sum += texelFetch(uTexture, min(origin + ivec2(x, y), last), 0).x;
+                }
+            }
+            FragColor = vec4(sum / float(SCALE * SCALE), 0.0, 0.0, 1.0);
+        }
+    )").arg(kFrangiTemporalScale));
+    
+    // Temporal motion shader - полный перебор сдвигов блока по SAD уменьшенной
+    // яркости с прошлым кадром и уточнение на полном разрешении. Выход: сдвиг
+    // истории в texel'ях кадра и его SAD (CPU версия - frangiTemporalMotionRows())
+    m_temporalMotionShader = m_shaders->createProgram("temporal motion", QString(R"(
+        #version 330 core
+        out vec4 FragColor;
+        uniform sampler2D uTexture;        // уменьшенная яркость текущего кадра
+        uniform sampler2D uPrevious;       // уменьшенная яркость прошлого кадра
+        uniform sampler2D uLuma;           // яркость текущего кадра
+        uniform sampler2D uPreviousLuma;   // яркость прошлого кадра
+        uniform int uRadius;
+        
+        const int SCALE = %1;
+        const int BLOCK = %2;
+        const int REFINE_RADIUS = %3;
+        const float PENALTY = %4;
+        const int REFINE_STEP = 2;
+        const int REFINE_COUNT = BLOCK * SCALE / REFINE_STEP;
+        
+        float coarseSad(ivec2 origin, ivec2 offset, ivec2 last) {
+            float sum = 0.0;
+            for(int y = 0; y < BLOCK; y++) {
+                for(int x = 0; x < BLOCK; x++) {
+                    ivec2 q = min(origin + ivec2(x, y), last);
+                    sum += abs(texelFetch(uTexture, q, 0).x -
+                               texelFetch(uPrevious, clamp(q + offset, ivec2(0), last), 0).x);
+                }
+            }
+            return sum / float(BLOCK * BLOCK);
+        }
+        
+        float fineSad(ivec2 origin, ivec2 offset, ivec2 last) {
+            float sum = 0.0;
+            for(int y = 0; y < REFINE_COUNT; y++) {
+                for(int x = 0; x < REFINE_COUNT; x++) {
+                    ivec2 q = min(origin + ivec2(x, y) * REFINE_STEP, last);
+                    sum += abs(texelFetch(uLuma, q, 0).x -
+                               texelFetch(uPreviousLuma, clamp(q + offset, ivec2(0), last), 0).x);
+                }
+            }
+            return sum / float(REFINE_COUNT * REFINE_COUNT);
+        }
+        
+        void main() {
+            // Уменьшенный уровень: нулевой сдвиг без штрафа, остальные по строкам, как на CPU
+            ivec2 last = textureSize(uTexture, 0) - 1;
+            ivec2 origin = ivec2(gl_FragCoord.xy) * BLOCK;
+            ivec2 coarse = ivec2(0);
+            float bestCost = coarseSad(origin, coarse, last);
+            for(int dy = -uRadius; dy <= uRadius; dy++) {
+                for(int dx = -uRadius; dx <= uRadius; dx++) {
+                    if(dx == 0 && dy == 0) continue;
+                    float cost = coarseSad(origin, ivec2(dx, dy), last) + PENALTY * float(abs(dx) + abs(dy));
+                    if(cost < bestCost) {
+                        bestCost = cost;
+                        coarse = ivec2(dx, dy);
+                    }
+                }
+            }
+            
+            // Полное разрешение вокруг найденного сдвига
+            last = textureSize(uLuma, 0) - 1;
+            origin = ivec2(gl_FragCoord.xy) * BLOCK * SCALE;
+            ivec2 center = coarse * SCALE;
+            ivec2 best = center;
+            float bestSad = fineSad(origin, center, last);
+            bestCost = bestSad;
+            for(int dy = -REFINE_RADIUS; dy <= REFINE_RADIUS; dy++) {
+                for(int dx = -REFINE_RADIUS; dx <= REFINE_RADIUS; dx++) {
+                    if(dx == 0 && dy == 0) continue;
+                    float sad = fineSad(origin, center + ivec2(dx, dy), last);
+                    float cost = sad + PENALTY * float(abs(dx) + abs(dy));
+                    if(cost < bestCost) {
+                        bestCost = cost;
+                        bestSad = sad;
+                        best = center + ivec2(dx, dy);
+                    }
+                }
+            }
+            
+            FragColor = vec4(vec2(best), bestSad, 1.0);
+        }
+    )").arg(kFrangiTemporalScale).arg(kFrangiTemporalBlock).arg(kFrangiTemporalRefineRadius)
+       .arg(kFrangiTemporalMotionPenalty, 0, 'f', 6));
+    
+    // Temporal blend shader - EMA с историей, сдвинутой по движению блока.
+    // История зажимается в диапазон 3x3 соседей текущего vesselness; блок
+    // без найденного сдвига и история вне кадра - текущее значение
+    // (CPU версия - frangiTemporalBlendRows())
+    m_temporalBlendShader = m_shaders->createProgram("temporal blend", QString(R"(
+        #version 330 core
+        out vec4 FragColor;
+        uniform sampler2D uTexture;   // vesselness кадра (G - sigma в multi-scale)
+        uniform sampler2D uHistory;
+        uniform sampler2D uMotion;
+        uniform float uAlpha;
+        uniform float uReject;
+        uniform bool uReset;
+        
+        const int BLOCK_PIXELS = %1;
+        
+        void main() {
+            ivec2 size = textureSize(uTexture, 0);
+            ivec2 p = ivec2(gl_FragCoord.xy);
+            vec4 current = texelFetch(uTexture, p, 0);
+            float value = current.x;
+            
+            if(!uReset) {
+                vec3 motion = texelFetch(uMotion, p / BLOCK_PIXELS, 0).xyz;
+                ivec2 source = p + ivec2(motion.xy);
+                if(motion.z <= uReject && all(greaterThanEqual(source, ivec2(0))) && all(lessThan(source, size))) {
+                    float low = value;
+                    float high = value;
+                    for(int dy = -1; dy <= 1; dy++) {
+                        for(int dx = -1; dx <= 1; dx++) {
+                            float neighbour = texelFetch(uTexture, clamp(p + ivec2(dx, dy), ivec2(0), size - 1), 0).x;
+                            low = min(low, neighbour);
+                            high = max(high, neighbour);
+                        }
+                    }
+                    float previous = clamp(texelFetch(uHistory, source, 0).x, low, high);
+                    value = previous + (value - previous) * uAlpha;
+                }
+            }
+            
+            FragColor = vec4(value, current.y, 0.0, 1.0);
+        }
+    )").arg(kFrangiTemporalBlockPixels));
+    
+    // Visualize shader
+    m_visualizeShader = m_shaders->createProgram("visualize", R"(
+        #version 330 core
+        in vec2 vUv;
+        out vec4 FragColor;
+        uniform sampler2D uTexture;
+        uniform int uStage;
+        // Сетка потоков атласа: ячейка экрана показывает кадр своего тайла без полей.
+        // Размеры ячейки, поля и кадра - в UV атласа
+        uniform vec2 uGrid;
+        uniform vec2 uCellSize;
+        uniform vec2 uFrameOffset;
+        uniform vec2 uFrameScale;
+        uniform int uStreamCount;
+        
+        void main() {
+            vec2 cell = min(floor(vUv * uGrid), uGrid - 1.0);
+            vec2 local = vUv * uGrid - cell;
+            int stream = int(uGrid.y - 1.0 - cell.y) * int(uGrid.x) + int(cell.x);
+            if(stream >= uStreamCount) {
+                FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+                return;
+            }
+            vec4 texel = texture(uTexture, cell * uCellSize + uFrameOffset + local * uFrameScale);
+            vec3 color;
+            
+            if(uStage == 3) {
+                // Gradients: показываем magnitude градиентов с ОЧЕНЬ сильным усилением
+                float gx = texel.x;
+                float gy = texel.y;
+                float magnitude = sqrt(gx*gx + gy*gy);
+                magnitude = magnitude * 50.0; // Усиление x50!
+                magnitude = clamp(magnitude, 0.0, 1.0);
+                // Визуализируем gx как красный, gy как зеленый для отладки
+                color = vec3(abs(gx)*50.0, abs(gy)*50.0, magnitude);
+                color = clamp(color, 0.0, 1.0);
+            } else if(uStage == 4 || uStage == 5) {
+                // Hessian/Eigenvalues: могут быть отрицательными, показываем abs
+                float v = abs(texel.x);
+                v = v * 10.0; // Усиление
+                v = clamp(v, 0.0, 1.0);
+                color = vec3(v);
+            } else if(uStage == 6) {
+                // Vesselness: нужно сильное усиление т.к. значения очень маленькие
+                float v = texel.x;
+                v = v * 100.0; // Усиление x100!
+                v = clamp(v, 0.0, 1.0);
+                v = v * v; // Мягкий контраст для лучшей видимости
+                color = vec3(v);
+            } else if(uStage == 7) {
+                // Overlay: уже цветное, просто показываем как есть
+                color = texel.rgb;
+            } else {
+                // Grayscale, Invert, Blur, Centerline: обычная визуализация
+                float v = texel.x;
+                v = clamp(v, 0.0, 1.0);
+                color = vec3(v);
+            }
+            
+            FragColor = vec4(color, 1.0);
+        }
+    )");
+    
+    // Compute шейдеры blur (GL 4.3+), иначе остается fragment путь
+    m_computeAvailable = QOpenGLShader::hasOpenGLShaders(QOpenGLShader::Compute);
+    if (m_computeAvailable) {
+        createComputeShaders();
+    }
+    
+    qDebug() << "FrangiPipeline:" << m_shaders->programCount() << "shader programs in"
+             << m_shaders->buildTime() << "ms, program binary cache"
+             << (m_shaders->binaryCacheEnabled() ? "enabled" : "unavailable");
+    qDebug() << "FrangiPipeline: compute blur" << (m_computeAvailable ? "available" : "unavailable");
+}
+
+void FrangiPipeline::createComputeShaders()
+{
+    // Веса Gaussian ядра - uniform buffer, обновляется только при смене sigma
+    if (!m_weightsUbo) {
+        glGenBuffers(1, &m_weightsUbo);
+        glBindBuffer(GL_UNIFORM_BUFFER, m_weightsUbo);
+        glBufferData(GL_UNIFORM_BUFFER, kBlurWeightVec4Count * 4 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, kBlurWeightsBinding, m_weightsUbo);
+    }
+    
+    // Qualifier формата image2D должен совпадать с форматом FBO blur'а,
+    // поэтому шейдеры пересобираются при смене точности
+    m_shaders->destroyProgram(m_blurXComputeShader);
+    m_shaders->destroyProgram(m_blurYComputeShader);
+    m_computeImageFormat = targetFormat(StageBlur);
+    const QString imageFormat = m_computeImageFormat == GL_R16F ? "r16f" : "r32f";
+    
+    // Blur X: строка тайла + apron в shared memory, grayscale/invert при загрузке
+    m_blurXComputeShader = m_shaders->createComputeProgram("blur x compute", QString(R"(
+        #version 430 core
+        #define GROUP_SIZE %1
+        #define MAX_RADIUS %2
+        layout(local_size_x = GROUP_SIZE) in;
+        
+        uniform sampler2D uInput;
+        layout(%5, binding = 0) writeonly uniform image2D uOutput;
+        layout(std140, binding = %3) uniform GaussianWeights {
+            vec4 uWeights[%4];
+        };
+        uniform int uRadius;
+        uniform int uInvert;
+        
+        shared float tile[GROUP_SIZE + 2 * MAX_RADIUS];
+        
+        float loadGray(ivec2 p, ivec2 size) {
+            vec3 color = texelFetch(uInput, clamp(p, ivec2(0), size - 1), 0).rgb;
+            float gray = dot(color, vec3(0.299, 0.587, 0.114));
+            return uInvert != 0 ? 1.0 - gray : gray;
+        }
+        
+        void main() {
+            ivec2 size = textureSize(uInput, 0);
+            int row = int(gl_WorkGroupID.y);
+            int tileStart = int(gl_WorkGroupID.x) * GROUP_SIZE;
+            int local = int(gl_LocalInvocationID.x);
+            
+            for (int i = local; i < GROUP_SIZE + 2 * uRadius; i += GROUP_SIZE) {
+                tile[i] = loadGray(ivec2(tileStart - uRadius + i, row), size);
+            }
+            barrier();
+            
+            int x = tileStart + local;
+            if (x >= size.x) return;
+            
+            float sum = 0.0;
+            for (int k = 0; k <= 2 * uRadius; ++k) {
+                sum += tile[local + k] * uWeights[k >> 2][k & 3];
+            }
+            imageStore(uOutput, ivec2(x, row), vec4(sum, sum, sum, 1.0));
+        }
+    )").arg(kBlurXGroupSize).arg(kFrangiMaxBlurRadius).arg(kBlurWeightsBinding).arg(kBlurWeightVec4Count)
+       .arg(imageFormat));
+    if (!m_blurXComputeShader->isLinked()) {
+        m_computeAvailable = false;
+    }
+    
+    // Blur Y: тайл GROUP_SIZE x GROUP_SIZE + apron сверху и снизу
+    m_blurYComputeShader = m_shaders->createComputeProgram("blur y compute", QString(R"(
+        #version 430 core
+        #define GROUP_SIZE %1
+        #define MAX_RADIUS %2
+        layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+        
+        uniform sampler2D uInput;
+        layout(%5, binding = 0) writeonly uniform image2D uOutput;
+        layout(std140, binding = %3) uniform GaussianWeights {
+            vec4 uWeights[%4];
+        };
+        uniform int uRadius;
+        
+        shared float tile[GROUP_SIZE + 2 * MAX_RADIUS][GROUP_SIZE];
+        
+        void main() {
+            ivec2 size = textureSize(uInput, 0);
+            ivec2 groupStart = ivec2(gl_WorkGroupID.xy) * GROUP_SIZE;
+            ivec2 local = ivec2(gl_LocalInvocationID.xy);
+            int x = min(groupStart.x + local.x, size.x - 1);
+            
+            for (int i = local.y; i < GROUP_SIZE + 2 * uRadius; i += GROUP_SIZE) {
+                int y = clamp(groupStart.y - uRadius + i, 0, size.y - 1);
+                tile[i][local.x] = texelFetch(uInput, ivec2(x, y), 0).x;
+            }
+            barrier();
+            
+            ivec2 p = groupStart + local;
+            if (p.x >= size.x || p.y >= size.y) return;
+            
+            float sum = 0.0;
+            for (int k = 0; k <= 2 * uRadius; ++k) {
+                sum += tile[local.y + k][local.x] * uWeights[k >> 2][k & 3];
+            }
+            imageStore(uOutput, p, vec4(sum, sum, sum, 1.0));
+        }
+    )").arg(kBlurYGroupSize).arg(kFrangiMaxBlurRadius).arg(kBlurWeightsBinding).arg(kBlurWeightVec4Count)
+       .arg(imageFormat));
+    if (!m_blurYComputeShader->isLinked()) {
+        m_computeAvailable = false;
+    }
+}
+
+void FrangiPipeline::recreateFramebuffers(int width, int height)
+{
+    // Удаляем старые framebuffer'ы: в пуле остались бы FBO прежнего
+    // размера или формата, которые уже никогда не подойдут
+    delete m_fboFrame;
+    releaseStageTargets();
+    m_targetPool->clear();
+    releaseScaleLevels();
+    releaseTemporalTargets();
+    
+    QOpenGLFramebufferObjectFormat frameFormat;
+    frameFormat.setInternalTextureFormat(GL_RGBA8);
+    frameFormat.setTextureTarget(GL_TEXTURE_2D);
+    m_fboFrame = new QOpenGLFramebufferObject(width, height, frameFormat);
+    glBindTexture(GL_TEXTURE_2D, m_fboFrame->texture());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    // Тайлы потоков без кадра остаются черными
+    m_fboFrame->bind();
+    glClear(GL_COLOR_BUFFER_BIT);
+    m_fboFrame->release();
+    m_hasFrame = false;
+    // Промежуточные FBO и compute шейдеры под их формат - при первом process()
+    m_framebuffersDirty = false;
+}
+
+void FrangiPipeline::setPrecision(FrangiPrecision precision)
+{
+    if (precision == m_precision) return;
+    m_precision = precision;
+    m_framebuffersDirty = true;
+    invalidate(StageGrayscale);
+}
+
+GLenum FrangiPipeline::targetFormat(int stage) const
+{
+    // Ошибки цепочки до blur'а умножаются в производных на W/4,
+    // поэтому 16F для нее - только в Half (см. FrangiPrecision)
+    switch (stage) {
+        case StageGrayscale:
+        case StageInvert:
+        case StageBlur:
+        case StageVesselness:
+            return m_precision == FrangiPrecisionHalf ? GL_R16F : GL_R32F;
+        case StageGradients:
+        case StageEigenvalues:
+            return m_precision == FrangiPrecisionFull ? GL_RG32F : GL_RG16F;
+        case StageHessian:
+            return m_precision == FrangiPrecisionFull ? GL_RGBA32F : GL_RGBA16F;
+        case StageCenterline:
+            // Маски кандидатов и скелета: 0, 0.5 и 1
+            return GL_R8;
+        case StageOverlay:
+        default:
+            // Overlay только отображается, на экране все равно 8 бит
+            return GL_RGBA8;
+    }
+}
+QOpenGLFramebufferObject *FrangiPipeline::acquireStageTarget(int stage)
+{
+    // Blur fragment шейдеры берут пары texel'ей одной билинейной выборкой,
+    // поэтому их входы фильтруются линейно (остальные остаются GL_NEAREST)
+    const bool blurInput = stage == StageGrayscale || stage == StageInvert;
+    m_targetPool->release(m_stageTargets[stage]);
+    m_stageTargets[stage] = m_targetPool->acquire(width(), height(), targetFormat(stage), blurInput);
+    return m_stageTargets[stage];
+}
+
+void FrangiPipeline::releaseStageTarget(int stage)
+{
+    // Отображаемый stage нужен drawStage() после process(),
+    // в still режиме все stage'и ждут следующего изменения параметров
+    if (isStageDisplayed(stage) || m_stillMode) return;
+    
+    m_targetPool->release(m_stageTargets[stage]);
+    m_stageTargets[stage] = nullptr;
+}
+
+void FrangiPipeline::releaseStageTargets(int firstStage)
+{
+    for (int stage = firstStage; stage < kStageCount; ++stage) {
+        m_targetPool->release(m_stageTargets[stage]);
+        m_stageTargets[stage] = nullptr;
+    }
+}
+
+bool FrangiPipeline::isStageDisplayed(int stage) const
+{
+    // Без инверсии на месте stage'а invert показывается grayscale
+    if (stage == StageGrayscale && m_displayStage == StageInvert && !m_invertEnabled) {
+        return true;
+    }
+    return stage == m_displayStage;
+}
+
+void FrangiPipeline::renderPass(QOpenGLShaderProgram *program, 
+                                 QOpenGLFramebufferObject *target,
+                                 GLuint inputTexture)
+{
+    target->bind();
+    glViewport(0, 0, target->width(), target->height());
+    glClear(GL_COLOR_BUFFER_BIT);
+    
+    program->bind();
+    m_vao->bind();
+    
+    if (inputTexture) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, inputTexture);
+        program->setUniformValue(uniform(program, "uTexture"), 0);
+    }
+    
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    
+    m_vao->release();
+    program->release();
+    target->release();
+}
+
+void FrangiPipeline::process(int displayStage)
+{
+    if (!m_fboFrame || !m_hasFrame) return;
+    
+    int w = width();
+    int h = height();
+    
+    // Забираем готовые результаты прошлых кадров до новой работы GPU
+    if (m_asyncReadbackEnabled) {
+        m_asyncReadback->poll();
+    }
+    
+    // Multi-scale режим нужен только для vesselness и overlay.
+    // Пирамида уровней не учитывает тайлы атласа, поэтому только для одного потока
+    const bool multiScale = m_multiScaleEnabled && !m_scales.isEmpty() &&
+                            displayStage >= StageVesselness && m_streamCount == 1;
+    if (multiScale != m_multiScaleActive) {
+        invalidate(StageVesselness);
+    }
+    m_multiScaleActive = multiScale;
+    
+    // Temporal stage, как и multi-scale, только для одного потока
+    const bool temporal = m_temporalEnabled && m_streamCount == 1;
+    if (temporal != m_temporalActive) {
+        invalidate(StageVesselness);
+        m_temporalHistoryValid = false;
+    }
+    m_temporalActive = temporal;
+    
+    // Результаты после первого устаревшего stage'а больше не нужны
+    if (m_dirtyStage <= StageInvert) {
+        m_validPyramidLevels = 0;
+    }
+    if (m_dirtyStage <= StageVesselness) {
+        m_multiScaleValid = false;
+    }
+    releaseStageTargets(m_dirtyStage);
+    m_dirtyStage = kStageCount;
+    m_displayStage = displayStage;
+    
+    // Все нужное уже посчитано (перерисовка, смена stage'а на сохраненный)
+    const bool vesselnessReady = m_multiScaleActive ? m_multiScaleValid
+                                                    : m_stageTargets[StageVesselness] != nullptr;
+    if (vesselnessReady && stageTexture(displayStage)) return;
+    
+    // Пересчет без нового кадра (still режим) - отдельный кадр профайлера
+    if (m_frameProcessed) {
+        m_profiler->beginFrame();
+    }
+    m_frameProcessed = true;
+    m_targetPool->beginFrame();
+    
+    // Точность могла смениться без нового кадра: image2D compute шейдеров
+    // должен совпадать с форматом FBO blur'а
+    if (m_computeAvailable && m_computeImageFormat != targetFormat(StageBlur)) {
+        createComputeShaders();
+    }
+    
+    if (m_multiScaleActive) {
+        if (!m_multiScaleValid) {
+            processMultiScale(w, h);
+        }
+    } else {
+        uploadBlurWeights();
+        
+        // Passes 4-7 нужны, если нет отображаемого промежуточного stage'а или
+        // vesselness. Промежуточные stage'и нужны только для их отображения.
+        // Цепочка продолжается с последнего сохраненного stage'а перед недостающим
+        const bool needIntermediates = displayStage == StageGradients ||
+                                       displayStage == StageHessian ||
+                                       displayStage == StageEigenvalues;
+        int missingStage = kStageCount;
+        if (!m_stageTargets[StageVesselness]) {
+            missingStage = StageVesselness;
+        }
+        if (needIntermediates && !m_stageTargets[displayStage]) {
+            missingStage = displayStage;
+        }
+        int firstStage = kStageCount;
+        if (missingStage < kStageCount) {
+            firstStage = StageGradients;
+            for (int stage = missingStage - 1; stage >= StageGradients; --stage) {
+                if (m_stageTargets[stage]) {
+                    firstStage = stage + 1;
+                    break;
+                }
+            }
+        }
+        
+        // Passes 0-3: grayscale, invert и separable blur. Compute путь не
+        // сохраняет grayscale/invert, они нужны только для отображения
+        const bool needGrayscale = displayStage == StageGrayscale || displayStage == StageInvert;
+        if (needGrayscale && !stageTexture(displayStage)) {
+            processGrayscale(w, h);
+        }
+        const bool needBlur = firstStage == StageGradients || displayStage == StageBlur;
+        if (needBlur && !m_stageTargets[StageBlur]) {
+            if (m_computeEnabled && m_computeAvailable && !needGrayscale) {
+                processBlurCompute(w, h);
+            } else {
+                processBlurFragment(w, h);
+            }
+        }
+        
+        // Vesselness из сохраненных eigenvalues - один pass цепочки
+        if (firstStage == StageGradients && m_fusedEnabled && !needIntermediates) {
+            processFused(w, h);
+        } else if (firstStage < kStageCount) {
+            processDerivativeChain(w, h, firstStage);
+        }
+    }
+    
+    // Новый vesselness смешивается с историей прошлых кадров
+    if (m_temporalActive && !vesselnessReady) {
+        processTemporal(w, h);
+    }
+    
+    // Pass 8: Overlay - накладываем результат на оригинал.
+    // Нужен только на экране, headless чтение берет vesselness
+    if (displayStage == StageOverlay && !m_stageTargets[StageOverlay]) {
+        QOpenGLFramebufferObject *overlay = acquireStageTarget(StageOverlay);
+        m_profiler->beginGpu(FrangiProfiler::SectionOverlay);
+        overlay->bind();
+        glViewport(0, 0, w, h);
+        glClear(GL_COLOR_BUFFER_BIT);
+        m_overlayShader->bind();
+        m_vao->bind();
+        
+        // Привязываем оригинальное изображение к текстуре 0
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_fboFrame->texture());
+        m_overlayShader->setUniformValue(uniform(m_overlayShader, "uOriginal"), 0);
+        
+        // Привязываем vesselness к текстуре 1
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, vesselnessFbo()->texture());
+        m_overlayShader->setUniformValue(uniform(m_overlayShader, "uVesselness"), 1);
+        
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glActiveTexture(GL_TEXTURE0);
+        m_vao->release();
+        m_overlayShader->release();
+        overlay->release();
+        m_profiler->endGpu();
+    }
+    
+    // Скелет по vesselness, как и overlay, только для отображения и чтения
+    if (displayStage == StageCenterline && !m_stageTargets[StageCenterline]) {
+        processCenterline(w, h);
+    }
+    
+    // Асинхронное чтение отдает кадр целиком, для атласа - readVesselness(stream).
+    // Vesselness, взятая из прошлого process(), уже в очереди
+    if (m_asyncReadbackEnabled && m_streamCount == 1 && !vesselnessReady) {
+        m_profiler->beginGpu(FrangiProfiler::SectionReadback);
+        m_asyncReadback->enqueue(vesselnessFbo()->handle(), w, h, m_frameTimestamp);
+        m_profiler->endGpu();
+    }
+}
+
+void FrangiPipeline::processBlurFragment(int w, int h)
+{
+    const int inputStage = processGrayscale(w, h);
+    m_stageTargets[StageBlur] = processBlurPasses(m_stageTargets[inputStage]->texture(), w, h, inputStage);
+}
+
+int FrangiPipeline::processGrayscale(int w, int h)
+{
+    // Сохраненные stage'и (still режим, отображаемый stage) не пересчитываются
+    const int resultStage = m_invertEnabled ? StageInvert : StageGrayscale;
+    if (m_stageTargets[resultStage]) return resultStage;
+    
+    // Кадр пирамиды multi-scale режима строится заново
+    m_validPyramidLevels = 0;
+    
+    // Pass 0: Grayscale
+    QOpenGLFramebufferObject *gray = m_stageTargets[StageGrayscale];
+    if (!gray) {
+        gray = acquireStageTarget(StageGrayscale);
+        m_profiler->beginGpu(FrangiProfiler::SectionGrayscale);
+        gray->bind();
+        glViewport(0, 0, w, h);
+        glClear(GL_COLOR_BUFFER_BIT);
+        m_grayscaleShader->bind();
+        m_vao->bind();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_fboFrame->texture());
+        m_grayscaleShader->setUniformValue(uniform(m_grayscaleShader, "uTexture"), 0);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        m_vao->release();
+        m_grayscaleShader->release();
+        gray->release();
+        m_profiler->endGpu();
+    }
+    
+    // Без инверсии blur берет grayscale напрямую
+    if (!m_invertEnabled) return StageGrayscale;
+    
+    // Pass 1: Invert (опционально)
+    QOpenGLFramebufferObject *invert = acquireStageTarget(StageInvert);
+    m_profiler->beginGpu(FrangiProfiler::SectionInvert);
+    invert->bind();
+    glViewport(0, 0, w, h);
+    glClear(GL_COLOR_BUFFER_BIT);
+    m_invertShader->bind();
+    m_vao->bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, gray->texture());
+    m_invertShader->setUniformValue(uniform(m_invertShader, "uTexture"), 0);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    m_vao->release();
+    m_invertShader->release();
+    invert->release();
+    m_profiler->endGpu();
+    releaseStageTarget(StageGrayscale);
+    
+    return StageInvert;
+}
+
+QOpenGLFramebufferObject *FrangiPipeline::processBlurPasses(GLuint inputTexture, int width, int height,
+                                                            int inputStage)
+{
+    // Pass 2: Blur X. Выход - вход blur Y, поэтому с линейной фильтрацией
+    const GLenum format = targetFormat(StageBlur);
+    QOpenGLFramebufferObject *blurX = m_targetPool->acquire(width, height, format, true);
+    m_profiler->beginGpu(FrangiProfiler::SectionBlurX);
+    blurX->bind();
+    glViewport(0, 0, width, height);
+    glClear(GL_COLOR_BUFFER_BIT);
+    m_blurXShader->bind();
+    m_vao->bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, inputTexture);
+    m_blurXShader->setUniformValue(uniform(m_blurXShader, "uTexture"), 0);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    m_vao->release();
+    m_blurXShader->release();
+    blurX->release();
+    m_profiler->endGpu();
+    
+    // Вход больше не читается: blur Y может занять его FBO
+    if (inputStage >= 0) {
+        releaseStageTarget(inputStage);
+    }
+    
+    // Pass 3: Blur Y
+    QOpenGLFramebufferObject *blurY = m_targetPool->acquire(width, height, format);
+    m_profiler->beginGpu(FrangiProfiler::SectionBlurY);
+    blurY->bind();
+    glViewport(0, 0, width, height);
+    glClear(GL_COLOR_BUFFER_BIT);
+    m_blurYShader->bind();
+    m_vao->bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, blurX->texture());
+    m_blurYShader->setUniformValue(uniform(m_blurYShader, "uTexture"), 0);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    m_vao->release();
+    m_blurYShader->release();
+    blurY->release();
+    m_profiler->endGpu();
+    m_targetPool->release(blurX);
+    
+    return blurY;
+}
+
+void FrangiPipeline::processBlurCompute(int w, int h)
+{
+    // Blur X: grayscale + invert при загрузке строки в shared memory
+    QOpenGLFramebufferObject *blurX = m_targetPool->acquire(w, h, targetFormat(StageBlur), true);
+    m_profiler->beginGpu(FrangiProfiler::SectionBlurX);
+    m_blurXComputeShader->bind();
+    m_blurXComputeShader->setUniformValue(uniform(m_blurXComputeShader, "uRadius"), m_blurRadius);
+    m_blurXComputeShader->setUniformValue(uniform(m_blurXComputeShader, "uInvert"), GLint(m_invertEnabled));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_fboFrame->texture());
+    m_blurXComputeShader->setUniformValue(uniform(m_blurXComputeShader, "uInput"), 0);
+    glBindImageTexture(0, blurX->texture(), 0, GL_FALSE, 0, GL_WRITE_ONLY, m_computeImageFormat);
+    glDispatchCompute((w + kBlurXGroupSize - 1) / kBlurXGroupSize, h, 1);
+    m_blurXComputeShader->release();
+    
+    // Результат blur X читается как текстура в следующем dispatch'е
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    m_profiler->endGpu();
+    
+    // Blur Y: тайл 16x16 плюс apron по вертикали
+    QOpenGLFramebufferObject *blurY = acquireStageTarget(StageBlur);
+    m_profiler->beginGpu(FrangiProfiler::SectionBlurY);
+    m_blurYComputeShader->bind();
+    m_blurYComputeShader->setUniformValue(uniform(m_blurYComputeShader, "uRadius"), m_blurRadius);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, blurX->texture());
+    m_blurYComputeShader->setUniformValue(uniform(m_blurYComputeShader, "uInput"), 0);
+    glBindImageTexture(0, blurY->texture(), 0, GL_FALSE, 0, GL_WRITE_ONLY, m_computeImageFormat);
+    glDispatchCompute((w + kBlurYGroupSize - 1) / kBlurYGroupSize,
+                      (h + kBlurYGroupSize - 1) / kBlurYGroupSize, 1);
+    m_blurYComputeShader->release();
+    
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, m_computeImageFormat);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+    m_profiler->endGpu();
+    m_targetPool->release(blurX);
+}
+
+void FrangiPipeline::uploadBlurWeights()
+{
+    if (!m_blurWeightsDirty) return;
+    
+    // Fragment путь: объединенные пары texel'ей
+    setBlurKernel(m_linearWeights, m_linearOffsets);
+    
+    // Compute путь: все веса из shared memory.
+    // std140: элементы массива float выравниваются по vec4, поэтому
+    // веса упакованы по 4 в vec4 (uWeights[i / 4][i % 4])
+    if (m_weightsUbo) {
+        QVector<float> packed(kBlurWeightVec4Count * 4, 0.0f);
+        std::copy(m_blurWeights.constBegin(), m_blurWeights.constEnd(), packed.begin());
+        
+        glBindBuffer(GL_UNIFORM_BUFFER, m_weightsUbo);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, packed.size() * sizeof(float), packed.constData());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    
+    m_blurWeightsDirty = false;
+}
+
+void FrangiPipeline::setBlurKernel(const QVector<float> &weights, const QVector<float> &offsets)
+{
+    m_blurXShader->bind();
+    m_blurXShader->setUniformValueArray(uniform(m_blurXShader, "uWeights"), weights.constData(), weights.size(), 1);
+    m_blurXShader->setUniformValueArray(uniform(m_blurXShader, "uOffsets"), offsets.constData(), offsets.size(), 1);
+    m_blurXShader->setUniformValue(uniform(m_blurXShader, "uTapCount"), GLint(weights.size()));
+    m_blurXShader->release();
+    
+    m_blurYShader->bind();
+    m_blurYShader->setUniformValueArray(uniform(m_blurYShader, "uWeights"), weights.constData(), weights.size(), 1);
+    m_blurYShader->setUniformValueArray(uniform(m_blurYShader, "uOffsets"), offsets.constData(), offsets.size(), 1);
+    m_blurYShader->setUniformValue(uniform(m_blurYShader, "uTapCount"), GLint(weights.size()));
+    m_blurYShader->release();
+}
+
+void FrangiPipeline::setSigma(float sigma)
+{
+    if (sigma == m_sigma) return;
+    m_sigma = sigma;
+    updateBlurKernel();
+}
+
+void FrangiPipeline::updateBlurKernel()
+{
+    invalidate(StageBlur);
+    
+    // Ядро ~3 sigma считается один раз здесь, шейдеры получают готовые веса
+    m_blurWeights = frangiGaussianWeights(m_sigma / m_processingDownscale);
+    m_blurRadius = (m_blurWeights.size() - 1) / 2;
+    frangiLinearSampledKernel(m_blurWeights, m_linearWeights, m_linearOffsets);
+    m_blurWeightsDirty = true;
+}
+
+void FrangiPipeline::setScaleRange(float minSigma, float maxSigma, int count)
+{
+    setScales(frangiScaleRange(minSigma, maxSigma, count));
+}
+
+void FrangiPipeline::setInvertEnabled(bool enabled)
+{
+    if (enabled == m_invertEnabled) return;
+    m_invertEnabled = enabled;
+    invalidate(StageInvert);
+}
+
+void FrangiPipeline::setFusedEnabled(bool enabled)
+{
+    // Fused и отдельные passes расходятся только в округлении, но переключение
+    // должно показывать результат выбранного пути
+    if (enabled == m_fusedEnabled) return;
+    m_fusedEnabled = enabled;
+    invalidate(StageGradients);
+}
+
+void FrangiPipeline::setComputeEnabled(bool enabled)
+{
+    if (enabled == m_computeEnabled) return;
+    m_computeEnabled = enabled;
+    invalidate(StageBlur);
+}
+
+void FrangiPipeline::setMultiScaleEnabled(bool enabled)
+{
+    if (enabled == m_multiScaleEnabled) return;
+    m_multiScaleEnabled = enabled;
+    invalidate(StageVesselness);
+}
+
+void FrangiPipeline::setCenterlineParams(const FrangiCenterlineParams &params)
+{
+    if (params == m_centerlineParams) return;
+    m_centerlineParams = params;
+    invalidate(StageCenterline);
+}
+
+void FrangiPipeline::processDerivativeChain(int w, int h, int firstStage)
+{
+    // Каждый stage возвращает вход в пул сразу после своего pass'а:
+    // eigenvalues занимают FBO gradients, vesselness - FBO blur.
+    // Stage'и до firstStage уже посчитаны (сохранены с прошлого process())
+    // Pass 4: Gradients
+    if (firstStage <= StageGradients) {
+        QOpenGLFramebufferObject *gradients = acquireStageTarget(StageGradients);
+        m_profiler->beginGpu(FrangiProfiler::SectionGradients);
+        gradients->bind();
+        glViewport(0, 0, w, h);
+        glClear(GL_COLOR_BUFFER_BIT);
+        m_gradientsShader->bind();
+        m_gradientsShader->setUniformValue(uniform(m_gradientsShader, "uStep"), sobelStep());
+        m_vao->bind();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_stageTargets[StageBlur]->texture());
+        m_gradientsShader->setUniformValue(uniform(m_gradientsShader, "uTexture"), 0);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        m_vao->release();
+        m_gradientsShader->release();
+        gradients->release();
+        m_profiler->endGpu();
+        releaseStageTarget(StageBlur);
+    }
+    
+    // Pass 5: Hessian
+    if (firstStage <= StageHessian) {
+        QOpenGLFramebufferObject *hessian = acquireStageTarget(StageHessian);
+        m_profiler->beginGpu(FrangiProfiler::SectionHessian);
+        hessian->bind();
+        glViewport(0, 0, w, h);
+        glClear(GL_COLOR_BUFFER_BIT);
+        m_hessianShader->bind();
+        m_hessianShader->setUniformValue(uniform(m_hessianShader, "uStep"), 2.0f * sobelStep());
+        m_hessianShader->setUniformValue(uniform(m_hessianShader, "uDerivativeScale"), derivativeFrameSize().width() / 4.0f);
+        m_vao->bind();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_stageTargets[StageGradients]->texture());
+        m_hessianShader->setUniformValue(uniform(m_hessianShader, "uTexture"), 0);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        m_vao->release();
+        m_hessianShader->release();
+        hessian->release();
+        m_profiler->endGpu();
+        releaseStageTarget(StageGradients);
+    }
+    
+    // Pass 6: Eigenvalues
+    if (firstStage <= StageEigenvalues) {
+        QOpenGLFramebufferObject *eigenvalues = acquireStageTarget(StageEigenvalues);
+        m_profiler->beginGpu(FrangiProfiler::SectionEigenvalues);
+        eigenvalues->bind();
+        glViewport(0, 0, w, h);
+        glClear(GL_COLOR_BUFFER_BIT);
+        m_eigenvaluesShader->bind();
+        m_vao->bind();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_stageTargets[StageHessian]->texture());
+        m_eigenvaluesShader->setUniformValue(uniform(m_eigenvaluesShader, "uTexture"), 0);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        m_vao->release();
+        m_eigenvaluesShader->release();
+        eigenvalues->release();
+        m_profiler->endGpu();
+        releaseStageTarget(StageHessian);
+    }
+    
+    // Pass 7: Vesselness
+    if (firstStage <= StageVesselness) {
+        QOpenGLFramebufferObject *vesselness = acquireStageTarget(StageVesselness);
+        m_profiler->beginGpu(FrangiProfiler::SectionVesselness);
+        vesselness->bind();
+        glViewport(0, 0, w, h);
+        glClear(GL_COLOR_BUFFER_BIT);
+        m_vesselnessShader->bind();
+        m_vesselnessShader->setUniformValue(uniform(m_vesselnessShader, "uBeta"), m_beta);
+        m_vesselnessShader->setUniformValue(uniform(m_vesselnessShader, "uC"), m_c);
+        m_vao->bind();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_stageTargets[StageEigenvalues]->texture());
+        m_vesselnessShader->setUniformValue(uniform(m_vesselnessShader, "uTexture"), 0);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        m_vao->release();
+        m_vesselnessShader->release();
+        vesselness->release();
+        m_profiler->endGpu();
+        releaseStageTarget(StageEigenvalues);
+    }
+}
+
+void FrangiPipeline::processFused(int w, int h)
+{
+    Q_UNUSED(w);
+    Q_UNUSED(h);
+    
+    // Pass 4-7 за один проход: blur -> vesselness без промежуточных FBO.
+    // Шаги как в шейдерах gradients (h = 1/W) и hessian (h = 2/W, 1 / (2h) = W/4)
+    const QVector2D step = sobelStep();
+    runFusedVesselness(m_stageTargets[StageBlur]->texture(), acquireStageTarget(StageVesselness),
+                       step, 2.0f * step, derivativeFrameSize().width() / 4.0f);
+    releaseStageTarget(StageBlur);
+}
+
+void FrangiPipeline::runFusedVesselness(GLuint inputTexture, QOpenGLFramebufferObject *target,
+                                        const QVector2D &sobelStep, const QVector2D &hessianStep,
+                                        float derivativeScale)
+{
+    m_profiler->beginGpu(FrangiProfiler::SectionVesselness);
+    target->bind();
+    glViewport(0, 0, target->width(), target->height());
+    glClear(GL_COLOR_BUFFER_BIT);
+    m_fusedVesselnessShader->bind();
+    m_fusedVesselnessShader->setUniformValue(uniform(m_fusedVesselnessShader, "uBeta"), m_beta);
+    m_fusedVesselnessShader->setUniformValue(uniform(m_fusedVesselnessShader, "uC"), m_c);
+    m_fusedVesselnessShader->setUniformValue(uniform(m_fusedVesselnessShader, "uSobelStep"), sobelStep);
+    m_fusedVesselnessShader->setUniformValue(uniform(m_fusedVesselnessShader, "uHessianStep"), hessianStep);
+    m_fusedVesselnessShader->setUniformValue(uniform(m_fusedVesselnessShader, "uDerivativeScale"), derivativeScale);
+    m_vao->bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, inputTexture);
+    m_fusedVesselnessShader->setUniformValue(uniform(m_fusedVesselnessShader, "uTexture"), 0);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    m_vao->release();
+    m_fusedVesselnessShader->release();
+    target->release();
+    m_profiler->endGpu();
+}
+
+void FrangiPipeline::processMultiScale(int w, int h)
+{
+    // Результат invert (или grayscale) - уровень 0 пирамиды, нужен до последнего масштаба
+    const int baseStage = processGrayscale(w, h);
+    const GLuint baseTexture = m_stageTargets[baseStage]->texture();
+    
+    // Масштабы - в пикселях исходного кадра
+    int levelCount = 0;
+    for (float sigma : m_scales) {
+        levelCount = qMax(levelCount, frangiPyramidLevel(sigma / m_processingDownscale));
+    }
+    ensureScaleLevels(levelCount);
+    
+    // Пирамида: каждый уровень - среднее 2x2 предыдущего. Уровни, построенные
+    // из того же кадра (пересчет после смены beta, c или масштабов), остаются
+    for (int level = m_validPyramidLevels + 1; level <= levelCount; ++level) {
+        const GLuint levelInput = level == 1 ? baseTexture : m_scaleLevels[level - 2]->texture();
+        QOpenGLFramebufferObject *target = m_scaleLevels[level - 1];
+        m_profiler->beginGpu(FrangiProfiler::SectionDownsample);
+        target->bind();
+        glViewport(0, 0, target->width(), target->height());
+        glClear(GL_COLOR_BUFFER_BIT);
+        m_downsampleShader->bind();
+        m_vao->bind();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, levelInput);
+        m_downsampleShader->setUniformValue(uniform(m_downsampleShader, "uTexture"), 0);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        m_vao->release();
+        m_downsampleShader->release();
+        target->release();
+        m_profiler->endGpu();
+    }
+    m_validPyramidLevels = qMax(m_validPyramidLevels, levelCount);
+    
+    QVector<float> weights;
+    QVector<float> mergedWeights;
+    QVector<float> offsets;
+    for (int i = 0; i < m_scales.size(); ++i) {
+        const float sigma = m_scales[i] / m_processingDownscale;
+        const int level = frangiPyramidLevel(sigma);
+        
+        GLuint input = baseTexture;
+        int levelWidth = w;
+        int levelHeight = h;
+        if (level > 0) {
+            input = m_scaleLevels[level - 1]->texture();
+            levelWidth = m_scaleLevels[level - 1]->width();
+            levelHeight = m_scaleLevels[level - 1]->height();
+        }
+        
+        // Остаток sigma после усреднений пирамиды - обычно 1-2 пикселя уровня
+        weights = frangiGaussianWeights(frangiLevelSigma(sigma, level));
+        frangiLinearSampledKernel(weights, mergedWeights, offsets);
+        setBlurKernel(mergedWeights, offsets);
+        QOpenGLFramebufferObject *blurY = processBlurPasses(input, levelWidth, levelHeight, -1);
+        
+        // Vesselness уровня растягивается до полного разрешения - линейная фильтрация.
+        // Шаги в один и два texel'я уровня по каждой оси
+        QOpenGLFramebufferObject *vesselness =
+            m_targetPool->acquire(levelWidth, levelHeight, targetFormat(StageVesselness), level > 0);
+        runFusedVesselness(blurY->texture(), vesselness,
+                           QVector2D(1.0f / levelWidth, 1.0f / levelHeight),
+                           QVector2D(2.0f / levelWidth, 2.0f / levelHeight),
+                           frangiScaleNormalization(sigma, m_gamma, level));
+        m_targetPool->release(blurY);
+        
+        // Максимум и sigma максимума на полном разрешении
+        const int next = 1 - m_scaleAccumIndex;
+        m_profiler->beginGpu(FrangiProfiler::SectionScaleMax);
+        m_fboScaleAccum[next]->bind();
+        glViewport(0, 0, w, h);
+        glClear(GL_COLOR_BUFFER_BIT);
+        m_scaleMaxShader->bind();
+        m_scaleMaxShader->setUniformValue(uniform(m_scaleMaxShader, "uSigma"), sigma);
+        m_scaleMaxShader->setUniformValue(uniform(m_scaleMaxShader, "uFirst"), GLint(i == 0));
+        m_vao->bind();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, vesselness->texture());
+        m_scaleMaxShader->setUniformValue(uniform(m_scaleMaxShader, "uScale"), 0);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, m_fboScaleAccum[m_scaleAccumIndex]->texture());
+        m_scaleMaxShader->setUniformValue(uniform(m_scaleMaxShader, "uAccum"), 1);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glActiveTexture(GL_TEXTURE0);
+        m_vao->release();
+        m_scaleMaxShader->release();
+        m_fboScaleAccum[next]->release();
+        m_profiler->endGpu();
+        m_scaleAccumIndex = next;
+        m_targetPool->release(vesselness);
+    }
+    releaseStageTarget(StageInvert);
+    releaseStageTarget(StageGrayscale);
+    m_multiScaleValid = true;
+    
+    // Uniform'ы blur шейдеров перезаписаны ядрами масштабов
+    m_blurWeightsDirty = true;
+}
+
+void FrangiPipeline::setTemporalEnabled(bool enabled)
+{
+    if (enabled == m_temporalEnabled) return;
+    m_temporalEnabled = enabled;
+    m_temporalHistoryValid = false;
+    invalidate(StageVesselness);
+}
+
+void FrangiPipeline::processTemporal(int w, int h)
+{
+    FrangiGpuProfileScope scope(m_profiler, FrangiProfiler::SectionTemporal);
+    if (!m_temporalHistory[0]) {
+        QOpenGLFramebufferObjectFormat historyFormat;
+        historyFormat.setInternalTextureFormat(GL_RG32F);
+        historyFormat.setTextureTarget(GL_TEXTURE_2D);
+        QOpenGLFramebufferObjectFormat lumaFormat;
+        lumaFormat.setInternalTextureFormat(GL_R32F);
+        lumaFormat.setTextureTarget(GL_TEXTURE_2D);
+        for (int i = 0; i < 2; ++i) {
+            m_temporalHistory[i] = new QOpenGLFramebufferObject(w, h, historyFormat);
+            m_temporalLuma[i] = new QOpenGLFramebufferObject(w, h, lumaFormat);
+            m_temporalCoarse[i] = new QOpenGLFramebufferObject(frangiTemporalLumaSize(w), frangiTemporalLumaSize(h),
+                                                                lumaFormat);
+        }
+        m_temporalHistoryValid = false;
+    }
+    
+    // С историей смешивается только новый кадр, пересчет того же кадра ее сбрасывает
+    const bool blend = m_temporalHistoryValid && m_temporalNewFrame;
+    const int previous = m_temporalIndex;
+    const int next = 1 - m_temporalIndex;
+    m_temporalNewFrame = false;
+    
+    // Яркость нужна и следующему кадру, поэтому считается всегда
+    renderPass(m_temporalLumaShader, m_temporalLuma[next], m_fboFrame->texture());
+    renderPass(m_temporalDownsampleShader, m_temporalCoarse[next], m_temporalLuma[next]->texture());
+    
+    QOpenGLFramebufferObject *motion = nullptr;
+    if (blend) {
+        motion = m_targetPool->acquire(frangiTemporalBlockCount(w), frangiTemporalBlockCount(h), GL_RGBA32F);
+        m_temporalMotionShader->bind();
+        m_temporalMotionShader->setUniformValue(uniform(m_temporalMotionShader, "uRadius"), m_temporalParams.searchRadius);
+        m_temporalMotionShader->setUniformValue(uniform(m_temporalMotionShader, "uPrevious"), 1);
+        m_temporalMotionShader->setUniformValue(uniform(m_temporalMotionShader, "uLuma"), 2);
+        m_temporalMotionShader->setUniformValue(uniform(m_temporalMotionShader, "uPreviousLuma"), 3);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, m_temporalCoarse[previous]->texture());
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, m_temporalLuma[next]->texture());
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_2D, m_temporalLuma[previous]->texture());
+        glActiveTexture(GL_TEXTURE0);
+        renderPass(m_temporalMotionShader, motion, m_temporalCoarse[next]->texture());
+    }
+    
+    m_temporalBlendShader->bind();
+    m_temporalBlendShader->setUniformValue(uniform(m_temporalBlendShader, "uReset"), GLint(!blend));
+    m_temporalBlendShader->setUniformValue(uniform(m_temporalBlendShader, "uAlpha"), m_temporalParams.alpha);
+    m_temporalBlendShader->setUniformValue(uniform(m_temporalBlendShader, "uReject"), m_temporalParams.rejectThreshold);
+    m_temporalBlendShader->setUniformValue(uniform(m_temporalBlendShader, "uHistory"), 1);
+    m_temporalBlendShader->setUniformValue(uniform(m_temporalBlendShader, "uMotion"), 2);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_temporalHistory[previous]->texture());
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, motion ? motion->texture() : 0);
+    glActiveTexture(GL_TEXTURE0);
+    renderPass(m_temporalBlendShader, m_temporalHistory[next], spatialVesselnessFbo()->texture());
+    
+    if (motion) {
+        m_targetPool->release(motion);
+    }
+    m_temporalIndex = next;
+    m_temporalHistoryValid = true;
+}
+
+void FrangiPipeline::releaseTemporalTargets()
+{
+    for (int i = 0; i < 2; ++i) {
+        delete m_temporalHistory[i];
+        delete m_temporalLuma[i];
+        delete m_temporalCoarse[i];
+        m_temporalHistory[i] = nullptr;
+        m_temporalLuma[i] = nullptr;
+        m_temporalCoarse[i] = nullptr;
+    }
+    m_temporalHistoryValid = false;
+}
+
+void FrangiPipeline::processCenterline(int w, int h)
+{
+    // NMS, гистерезис и утончение ping-pong'ом двух R8 FBO из пула. Число
+    // pass'ов фиксировано: проверка сходимости потребовала бы чтения на CPU
+    FrangiGpuProfileScope scope(m_profiler, FrangiProfiler::SectionCenterline);
+    QOpenGLFramebufferObject *current = m_targetPool->acquire(w, h, targetFormat(StageCenterline));
+    QOpenGLFramebufferObject *next = m_targetPool->acquire(w, h, targetFormat(StageCenterline));
+    
+    m_centerlineNmsShader->bind();
+    m_centerlineNmsShader->setUniformValue(uniform(m_centerlineNmsShader, "uLow"), m_centerlineParams.lowThreshold);
+    m_centerlineNmsShader->setUniformValue(uniform(m_centerlineNmsShader, "uHigh"), m_centerlineParams.highThreshold);
+    renderPass(m_centerlineNmsShader, current, vesselnessFbo()->texture());
+    
+    for (int i = 0; i < m_centerlineParams.hysteresisIterations; ++i) {
+        renderPass(m_hysteresisShader, next, current->texture());
+        std::swap(current, next);
+    }
+    
+    // Первый подпроход утончения заодно отбрасывает оставшиеся слабые пиксели
+    for (int i = 0; i < qMax(1, m_centerlineParams.thinningIterations); ++i) {
+        for (int subiteration = 0; subiteration < 2; ++subiteration) {
+            m_thinningShader->bind();
+            m_thinningShader->setUniformValue(uniform(m_thinningShader, "uSubiteration"), subiteration);
+            renderPass(m_thinningShader, next, current->texture());
+            std::swap(current, next);
+        }
+    }
+    
+    m_targetPool->release(next);
+    m_stageTargets[StageCenterline] = current;
+}
+
+void FrangiPipeline::ensureScaleLevels(int levelCount)
+{
+    if (!m_fboScaleAccum[0]) {
+        QOpenGLFramebufferObjectFormat accumFormat;
+        accumFormat.setInternalTextureFormat(GL_RG32F);
+        accumFormat.setTextureTarget(GL_TEXTURE_2D);
+        m_fboScaleAccum[0] = new QOpenGLFramebufferObject(width(), height(), accumFormat);
+        m_fboScaleAccum[1] = new QOpenGLFramebufferObject(width(), height(), accumFormat);
+    }
+    
+    QOpenGLFramebufferObjectFormat format;
+    format.setInternalTextureFormat(targetFormat(StageBlur));
+    format.setTextureTarget(GL_TEXTURE_2D);
+    
+    int levelWidth = width();
+    int levelHeight = height();
+    for (int level = 1; level <= levelCount; ++level) {
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+        if (level <= m_scaleLevels.size()) continue;
+        
+        // Линейная фильтрация: уровень - вход blur'а (пары texel'ей)
+        QOpenGLFramebufferObject *base = new QOpenGLFramebufferObject(levelWidth, levelHeight, format);
+        glBindTexture(GL_TEXTURE_2D, base->texture());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        
+        m_scaleLevels.append(base);
+    }
+}
+
+void FrangiPipeline::releaseScaleLevels()
+{
+    qDeleteAll(m_scaleLevels);
+    m_scaleLevels.clear();
+    
+    delete m_fboScaleAccum[0];
+    delete m_fboScaleAccum[1];
+    m_fboScaleAccum[0] = nullptr;
+    m_fboScaleAccum[1] = nullptr;
+    m_multiScaleActive = false;
+    m_multiScaleValid = false;
+    m_validPyramidLevels = 0;
+}
+
+QOpenGLFramebufferObject *FrangiPipeline::vesselnessFbo() const
+{
+    if (m_temporalActive && m_temporalHistoryValid) {
+        return m_temporalHistory[m_temporalIndex];
+    }
+    return spatialVesselnessFbo();
+}
+
+QOpenGLFramebufferObject *FrangiPipeline::spatialVesselnessFbo() const
+{
+    if (m_multiScaleActive && m_fboScaleAccum[m_scaleAccumIndex]) {
+        return m_fboScaleAccum[m_scaleAccumIndex];
+    }
+    return m_stageTargets[StageVesselness];
+}
+
+void FrangiPipeline::drawStage(int stage, GLuint targetFramebuffer,
+                               int viewportWidth, int viewportHeight)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+    glViewport(0, 0, viewportWidth, viewportHeight);
+    glClear(GL_COLOR_BUFFER_BIT);
+    
+    drawStage(stage, targetFramebuffer, QRect(0, 0, viewportWidth, viewportHeight));
+}
+
+void FrangiPipeline::drawStage(int stage, GLuint targetFramebuffer, const QRect &viewport)
+{
+    drawTexture(stageTexture(stage), stage, targetFramebuffer, viewport);
+}
+
+void FrangiPipeline::drawFrame(GLuint targetFramebuffer, const QRect &viewport)
+{
+    // Текстура кадра - RGBA, как overlay: шейдер показывает ее как есть
+    if (!m_fboFrame || !m_hasFrame) return;
+    drawTexture(m_fboFrame->texture(), StageOverlay, targetFramebuffer, viewport);
+}
+
+void FrangiPipeline::drawTexture(GLuint texture, int stage, GLuint targetFramebuffer, const QRect &viewport)
+{
+    // Pass 9: Final visualization
+    if (!texture) return;
+    
+    FrangiGpuProfileScope displayScope(m_profiler, FrangiProfiler::SectionDisplay);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+    glViewport(viewport.x(), viewport.y(), viewport.width(), viewport.height());
+    
+    m_visualizeShader->bind();
+    m_visualizeShader->setUniformValue(uniform(m_visualizeShader, "uStage"), stage);
+    
+    // Сетка потоков: ячейка атласа - тайл с полями, показывается только тайл
+    const QVector2D atlasSize(width(), height());
+    const float cellWidth = m_tileWidth + 2 * m_tileGutter;
+    const float cellHeight = m_tileHeight + 2 * m_tileGutter;
+    m_visualizeShader->setUniformValue(uniform(m_visualizeShader, "uGrid"), QVector2D(m_atlasColumns, m_atlasRows));
+    m_visualizeShader->setUniformValue(uniform(m_visualizeShader, "uCellSize"), QVector2D(cellWidth, cellHeight) / atlasSize);
+    m_visualizeShader->setUniformValue(uniform(m_visualizeShader, "uFrameOffset"), QVector2D(m_tileGutter, m_tileGutter) / atlasSize);
+    m_visualizeShader->setUniformValue(uniform(m_visualizeShader, "uFrameScale"), QVector2D(m_tileWidth, m_tileHeight) / atlasSize);
+    m_visualizeShader->setUniformValue(uniform(m_visualizeShader, "uStreamCount"), m_streamCount);
+    m_vao->bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    m_visualizeShader->setUniformValue(uniform(m_visualizeShader, "uTexture"), 0);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    m_vao->release();
+    m_visualizeShader->release();
+}
+
+GLuint FrangiPipeline::stageTexture(int stage) const
+{
+    // Выбираем какую текстуру показывать в зависимости от stage
+    QOpenGLFramebufferObject *target;
+    switch(stage) {
+        case StageGrayscale:
+        case StageBlur:
+        case StageGradients:
+        case StageHessian:
+        case StageEigenvalues:
+            target = m_stageTargets[stage];
+            break;
+        case StageInvert:
+            // Без инверсии показываем grayscale
+            target = m_invertEnabled ? m_stageTargets[StageInvert] : m_stageTargets[StageGrayscale];
+            break;
+        case StageVesselness:
+            target = vesselnessFbo();
+            break;
+        case StageCenterline:
+            target = m_stageTargets[StageCenterline];
+            break;
+        case StageOverlay:
+        default:
+            target = m_stageTargets[StageOverlay];
+            break;
+    }
+    return target ? target->texture() : 0;
+}
+
+QVector<float> FrangiPipeline::readVesselness()
+{
+    QOpenGLFramebufferObject *vesselness = vesselnessFbo();
+    if (!vesselness) return QVector<float>();
+    return readChannel(vesselness, GL_RED, QRect(0, 0, vesselness->width(), vesselness->height()));
+}
+
+QVector<float> FrangiPipeline::readVesselness(int stream)
+{
+    QOpenGLFramebufferObject *vesselness = vesselnessFbo();
+    const QRect rect = streamRect(stream);
+    if (!vesselness || rect.isEmpty()) return QVector<float>();
+    return readChannel(vesselness, GL_RED, rect);
+}
+
+QVector<float> FrangiPipeline::readScaleMap()
+{
+    if (!m_multiScaleActive || !m_fboScaleAccum[m_scaleAccumIndex]) return QVector<float>();
+    QOpenGLFramebufferObject *accum = m_fboScaleAccum[m_scaleAccumIndex];
+    return readChannel(accum, GL_GREEN, QRect(0, 0, accum->width(), accum->height()));
+}
+
+QVector<uchar> FrangiPipeline::readCenterline(int stream)
+{
+    QOpenGLFramebufferObject *centerline = m_stageTargets[StageCenterline];
+    const QRect rect = streamRect(stream);
+    if (!centerline || rect.isEmpty()) return QVector<uchar>();
+    
+    const int w = rect.width();
+    const int h = rect.height();
+    QVector<uchar> flipped(w * h);
+    centerline->bind();
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(rect.x(), rect.y(), w, h, GL_RED, GL_UNSIGNED_BYTE, flipped.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    centerline->release();
+    
+    // Строки FBO снизу вверх
+    QVector<uchar> result(w * h);
+    for (int y = 0; y < h; ++y) {
+        memcpy(result.data() + y * w, flipped.constData() + (h - 1 - y) * w, w);
+    }
+    return result;
+}
+
+QVector<float> FrangiPipeline::readChannel(QOpenGLFramebufferObject *fbo, GLenum channel,
+                                           const QRect &rect)
+{
+    QVector<float> result;
+    const int w = rect.width();
+    const int h = rect.height();
+    result.resize(w * h);
+    
+    // В FBO строки идут снизу вверх (входная текстура зеркалирована),
+    // поэтому читаем во временный буфер и переворачиваем
+    QVector<float> flipped(w * h);
+    fbo->bind();
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(rect.x(), rect.y(), w, h, channel, GL_FLOAT, flipped.data());
+    fbo->release();
+    
+    for (int y = 0; y < h; ++y) {
+        memcpy(result.data() + y * w, flipped.constData() + (h - 1 - y) * w, w * sizeof(float));
+    }
+    
+    return result;
+}
\ No newline at end of file
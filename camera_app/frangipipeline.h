@@ -0,0 +1,409 @@
+#ifndef FRANGIPIPELINE_H
+#define FRANGIPIPELINE_H
+
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLVertexArrayObject>
+#include <QVector2D>
+#include <QImage>
+#include <QRect>
+#include <QSize>
+#include <QVector>
+#include "frangigaussian.h"
+#include "frangiframe.h"
+#include "frangireadback.h"
+#include "frangiprofiler.h"
+#include "frangiprecision.h"
+#include "frangishadermanager.h"
+#include "frangitargetpool.h"
+#include "frangicenterline.h"
+#include "frangitemporal.h"
+
+// GPU-конвейер Frangi фильтра без привязки к виджету.
+// Работает в том контексте, который текущий в момент вызова:
+// FrangiGLWidget использует его внутри paintGL(), FrangiEngine - в своем
+// offscreen контексте. Все методы кроме setter'ов параметров требуют
+// текущего контекста.
+class FrangiPipeline : protected QOpenGLExtraFunctions
+{
+public:
+    // Номера stage'ей совпадают с индексами в комбобоксе MainWindow
+    enum Stage {
+        StageGrayscale = 0,
+        StageInvert = 1,
+        StageBlur = 2,
+        StageGradients = 3,
+        StageHessian = 4,
+        StageEigenvalues = 5,
+        StageVesselness = 6,
+        StageOverlay = 7,
+        StageCenterline = 8
+    };
+    static const int kStageCount = StageCenterline + 1;
+
+    FrangiPipeline();
+    ~FrangiPipeline();
+
+    // Компилирует шейдеры и создает quad. Вызывать один раз с текущим контекстом
+    void initialize();
+    bool isInitialized() const { return m_initialized; }
+
+    // Загружает кадр во входную текстуру, пересоздает FBO при смене размера.
+    // Плоскости копируются в кольцо PBO и обновляют постоянные текстуры
+    // через glTexSubImage2D; переворот и YUV -> RGB делает шейдер распаковки
+    void setFrame(const FrangiFrameView &frame) { setFrame(0, frame); }
+    // QImage в форматах из FrangiFrameView::fromImage() загружается без конвертации
+    void setFrame(const QImage &frame);
+
+    // Несколько потоков в одном атласе: кадры раскладываются сеткой тайлов
+    // с полями из повторенных краевых пикселей, и каждый pass считает все
+    // потоки одним draw call'ом теми же шейдерами и quad'ом. Поля шире
+    // носителя blur'а и производных, поэтому тайл совпадает с обработкой
+    // кадра отдельно (при разных размерах кадров шаги производных берутся
+    // по наибольшему). Multi-scale режим и асинхронное чтение - только для
+    // одного потока. Кадр профайлера начинается с загрузки потока 0
+    void setStreamCount(int count);
+    int streamCount() const { return m_streamCount; }
+    // Загружает кадр потока в его тайл, атлас пересоздается при смене раскладки
+    void setFrame(int stream, const FrangiFrameView &frame);
+    // Кадр потока в атласе (строки снизу вверх, как в GL)
+    QRect streamRect(int stream) const;
+    // Шаги gradients/hessian зависят от ширины кадра (h = 1/W и 2/W по обеим
+    // осям). Для тайла или ROI большого кадра задается размер всего кадра, чтобы
+    // результат совпадал с его обработкой целиком; пустой - размер тайла
+    void setDerivativeFrameSize(const QSize &size);
+    // Уменьшение кадра в factor раз (среднее factor x factor пикселей) при
+    // распаковке, со следующего setFrame(). Sigma (и масштабы multi-scale)
+    // задаются в пикселях исходного кадра и делятся на factor, поэтому
+    // vesselness выделяет те же сосуды; результат, скелет и граф - в пикселях
+    // уменьшенного кадра
+    void setProcessingDownscale(int factor) { m_requestedDownscale = qMax(1, factor); }
+    int processingDownscale() const { return m_processingDownscale; }
+    bool hasFrame() const { return m_hasFrame; }
+    qint64 frameTimestamp() const { return m_frameTimestamp; }
+    // Приход текущего кадра в приложение (FrangiFrameView::arrivalTime)
+    qint64 frameArrival() const { return m_frameArrival; }
+
+    // Параметры Frangi фильтра. Изменение помечает устаревшими только
+    // stage'и, которые от него зависят (beta и c - vesselness, sigma - blur и далее)
+    // Пересчитывает Gaussian ядро (~3 sigma) на CPU, шейдеры получают готовые веса
+    void setSigma(float sigma);
+    void setBeta(float beta) { if (beta != m_beta) { m_beta = beta; invalidate(StageVesselness); } }
+    void setC(float c) { if (c != m_c) { m_c = c; invalidate(StageVesselness); } }
+    void setInvertEnabled(bool enabled);
+    // Fused режим: passes 4-7 одним шейдером с одноканальным выходом
+    void setFusedEnabled(bool enabled);
+    // Точность промежуточных FBO (см. FrangiPrecision, по умолчанию Balanced).
+    // FBO пересоздаются при следующем setFrame()
+    void setPrecision(FrangiPrecision precision);
+    FrangiPrecision precision() const { return m_precision; }
+    // Compute путь для grayscale/invert/blur (GL 4.3+, иначе fragment шейдеры).
+    // По умолчанию выключен: выигрыш против fragment пути зависит от драйвера,
+    // сравнение - frangi_bench --benchmark_filter='gl/blur/.*'
+    void setComputeEnabled(bool enabled);
+    bool isComputeAvailable() const { return m_computeAvailable; }
+    float sigma() const { return m_sigma; }
+    float beta() const { return m_beta; }
+    float c() const { return m_c; }
+    bool invertEnabled() const { return m_invertEnabled; }
+    bool fusedEnabled() const { return m_fusedEnabled; }
+
+    // Multi-scale режим: vesselness = максимум по списку sigma с Hessian'ом,
+    // нормированным на sigma^gamma. Крупные sigma считаются на уровнях
+    // пирамиды (усреднение 2x2), а не большими ядрами на полном разрешении.
+    // В этом режиме Hessian в пикселях, поэтому c заметно меньше (~0.1-1)
+    void setMultiScaleEnabled(bool enabled);
+    void setScales(const QVector<float> &scales) { if (scales != m_scales) { m_scales = scales; invalidate(StageVesselness); } }
+    void setScaleRange(float minSigma, float maxSigma, int count);
+    void setGamma(float gamma) { if (gamma != m_gamma) { m_gamma = gamma; invalidate(StageVesselness); } }
+    bool multiScaleEnabled() const { return m_multiScaleEnabled; }
+    const QVector<float> &scales() const { return m_scales; }
+    float gamma() const { return m_gamma; }
+
+    // Осевые линии (stage Centerline): NMS по vesselness, гистерезис и
+    // утончение до скелета в шейдерах, см. FrangiCenterlineParams.
+    // Считаются только для отображения этого stage'а
+    void setCenterlineParams(const FrangiCenterlineParams &params);
+    const FrangiCenterlineParams &centerlineParams() const { return m_centerlineParams; }
+
+    // Temporal stage (см. frangitemporal.h): vesselness каждого нового кадра
+    // смешивается с историей прошлых кадров, сдвинутой по найденному
+    // движению блоков. Результат берут overlay, centerline и чтение
+    // vesselness. Только для одного потока; пересчет без нового кадра (still
+    // режим) сбрасывает историю. Параметры действуют со следующего кадра
+    void setTemporalEnabled(bool enabled);
+    void setTemporalParams(const FrangiTemporalParams &params) { m_temporalParams = params; }
+    bool temporalEnabled() const { return m_temporalEnabled; }
+    const FrangiTemporalParams &temporalParams() const { return m_temporalParams; }
+
+    // Размер обрабатываемого изображения (атласа, если потоков несколько)
+    int width() const { return m_fboFrame ? m_fboFrame->width() : 0; }
+    int height() const { return m_fboFrame ? m_fboFrame->height() : 0; }
+    // GL_MAX_TEXTURE_SIZE контекста (после initialize()): предел стороны кадра
+    // или атласа, большие изображения обрабатываются тайлами
+    int maxTextureSize() const { return m_maxTextureSize; }
+
+    // Passes 0-8: от grayscale до overlay (с temporal stage'ем после vesselness),
+    // затем centerline. displayStage - какой stage будет показан:
+    // для gradients/hessian/eigenvalues fused режим не используется,
+    // т.к. он не сохраняет промежуточные результаты. Multi-scale режим
+    // применяется только для vesselness/overlay, stage'и 0-5 показываются для sigma.
+    // Промежуточные результаты возвращаются в пул после последнего читателя,
+    // до следующего process() живут только displayStage и vesselness.
+    // Overlay и centerline считаются только для их отображения.
+    // Выполняются только passes после первого устаревшего stage'а, начиная
+    // с последнего сохраненного результата; без изменений process() ничего не делает
+    void process(int displayStage = StageOverlay);
+
+    // Still режим (пауза, неподвижное изображение): промежуточные результаты
+    // не возвращаются в пул, поэтому после изменения параметра пересчитываются
+    // только зависящие от него passes. Новый кадр сбрасывает все stage'и
+    void setStillMode(bool enabled) { m_stillMode = enabled; }
+    bool stillMode() const { return m_stillMode; }
+
+    // Pass 9: визуализация выбранного stage в указанный framebuffer
+    void drawStage(int stage, GLuint targetFramebuffer, int viewportWidth, int viewportHeight);
+    // То же в часть framebuffer'а (viewport в пикселях, снизу вверх), без очистки
+    void drawStage(int stage, GLuint targetFramebuffer, const QRect &viewport);
+    // Исходный кадр из уже загруженной текстуры кадра (после распаковки YUV):
+    // превью без работы CPU
+    void drawFrame(GLuint targetFramebuffer, const QRect &viewport);
+
+    // Текстура с результатом stage (0 если stage не сохранен последним process())
+    GLuint stageTexture(int stage) const;
+
+    // Синхронное чтение vesselness карты (строки сверху вниз, как в QImage)
+    QVector<float> readVesselness();
+    // То же для кадра одного потока
+    QVector<float> readVesselness(int stream);
+
+    // Синхронное чтение sigma, на которой достигнут максимум vesselness
+    // (пусто, если последний кадр считался без multi-scale режима)
+    QVector<float> readScaleMap();
+
+    // Синхронное чтение скелета stage'а Centerline потока (width*height,
+    // строки сверху вниз, 255 - осевая линия). Пусто, если stage не считался
+    QVector<uchar> readCenterline(int stream = 0);
+
+    // Асинхронное чтение vesselness после каждого process(): результат кадра N
+    // приходит в callback FrangiAsyncReadback во время process() кадра N+2
+    void setAsyncReadbackEnabled(bool enabled) { m_asyncReadbackEnabled = enabled; }
+    bool asyncReadbackEnabled() const { return m_asyncReadbackEnabled; }
+    FrangiAsyncReadback *asyncReadback() { return m_asyncReadback; }
+
+    // Время passes (GL_TIME_ELAPSED) и загрузки кадра, по умолчанию выключено.
+    // Кадр профайлера начинается в setFrame() или в process(), который
+    // пересчитывает stage'и без нового кадра
+    FrangiProfiler *profiler() { return m_profiler; }
+
+    // Пул промежуточных render target'ов (число FBO и занятая память)
+    const FrangiTargetPool *targetPool() const { return m_targetPool; }
+
+private:
+    void createShaders();
+    void createComputeShaders();
+    GLenum targetFormat(int stage) const;
+    struct StreamUpload;
+    void uploadPlane(StreamUpload &upload, int plane, const uchar *data, int stride, int width, int height,
+                     GLenum internalFormat, GLenum format, int bytesPerPixel);
+    void unpackFrame(int stream, int unpackFormat);
+    void updateAtlasLayout();
+    // Gaussian ядро для sigma в пикселях обрабатываемого (уменьшенного) кадра
+    void updateBlurKernel();
+    QSize scaledFrameSize(const QSize &size) const;
+    QSize derivativeFrameSize() const;
+    QVector2D sobelStep() const;
+    void uploadBlurWeights();
+    void setBlurKernel(const QVector<float> &weights, const QVector<float> &offsets);
+    QOpenGLFramebufferObject *acquireStageTarget(int stage);
+    void releaseStageTarget(int stage);
+    void releaseStageTargets(int firstStage = 0);
+    bool isStageDisplayed(int stage) const;
+    void invalidate(int stage) { m_dirtyStage = qMin(m_dirtyStage, stage); }
+    int processGrayscale(int w, int h);
+    QOpenGLFramebufferObject *processBlurPasses(GLuint inputTexture, int width, int height,
+                                                int inputStage);
+    void processBlurFragment(int w, int h);
+    void processBlurCompute(int w, int h);
+    void processDerivativeChain(int w, int h, int firstStage);
+    void processFused(int w, int h);
+    void runFusedVesselness(GLuint inputTexture, QOpenGLFramebufferObject *target,
+                            const QVector2D &sobelStep, const QVector2D &hessianStep,
+                            float derivativeScale);
+    void processMultiScale(int w, int h);
+    void processCenterline(int w, int h);
+    void processTemporal(int w, int h);
+    void releaseTemporalTargets();
+    void ensureScaleLevels(int levelCount);
+    void releaseScaleLevels();
+    QOpenGLFramebufferObject *vesselnessFbo() const;
+    QOpenGLFramebufferObject *spatialVesselnessFbo() const;
+    QVector<float> readChannel(QOpenGLFramebufferObject *fbo, GLenum channel, const QRect &rect);
+    void recreateFramebuffers(int width, int height);
+    void renderPass(QOpenGLShaderProgram *program, QOpenGLFramebufferObject *target,
+                    GLuint inputTexture);
+    // Место uniform'а из кэша m_shaders: в кадре нет glGetUniformLocation
+    int uniform(QOpenGLShaderProgram *program, const char *name) { return m_shaders->uniformLocation(program, name); }
+    void drawTexture(GLuint texture, int stage, GLuint targetFramebuffer, const QRect &viewport);
+
+    bool m_initialized;
+    GLint m_maxTextureSize;
+
+    // Шейдерные программы (владеет m_shaders)
+    FrangiShaderManager *m_shaders;
+    QOpenGLShaderProgram *m_unpackShader;
+    QOpenGLShaderProgram *m_grayscaleShader;
+    QOpenGLShaderProgram *m_invertShader;
+    QOpenGLShaderProgram *m_blurXShader;
+    QOpenGLShaderProgram *m_blurYShader;
+    QOpenGLShaderProgram *m_gradientsShader;
+    QOpenGLShaderProgram *m_hessianShader;
+    QOpenGLShaderProgram *m_eigenvaluesShader;
+    QOpenGLShaderProgram *m_vesselnessShader;
+    QOpenGLShaderProgram *m_fusedVesselnessShader;
+    QOpenGLShaderProgram *m_overlayShader;
+    QOpenGLShaderProgram *m_visualizeShader;
+    QOpenGLShaderProgram *m_downsampleShader;
+    QOpenGLShaderProgram *m_scaleMaxShader;
+    QOpenGLShaderProgram *m_centerlineNmsShader;
+    QOpenGLShaderProgram *m_hysteresisShader;
+    QOpenGLShaderProgram *m_thinningShader;
+    QOpenGLShaderProgram *m_temporalLumaShader;
+    QOpenGLShaderProgram *m_temporalDownsampleShader;
+    QOpenGLShaderProgram *m_temporalMotionShader;
+    QOpenGLShaderProgram *m_temporalBlendShader;
+
+    // Compute шейдеры blur с тайлами в shared memory
+    QOpenGLShaderProgram *m_blurXComputeShader;
+    QOpenGLShaderProgram *m_blurYComputeShader;
+
+    // Распакованный кадр RGBA8 (строки снизу вверх, как в GL), живет все время
+    QOpenGLFramebufferObject *m_fboFrame;
+
+    // Результаты stage'ей текущего кадра, FBO из пула по формату и размеру.
+    // nullptr - stage не считался или его FBO уже отдан следующему stage'у
+    FrangiTargetPool *m_targetPool;
+    QOpenGLFramebufferObject *m_stageTargets[kStageCount];
+    int m_displayStage;
+
+    // Уровни пирамиды multi-scale режима (1..N, уровень 0 - результат invert).
+    // Blur и vesselness каждого масштаба берутся из пула
+    QVector<QOpenGLFramebufferObject *> m_scaleLevels;
+
+    // Ping-pong аккумуляторы RG32F: R - максимум vesselness, G - его sigma
+    QOpenGLFramebufferObject *m_fboScaleAccum[2];
+    int m_scaleAccumIndex;
+
+    // Загрузка кадров потока: текстуры плоскостей (пересоздаются только при
+    // смене размера или формата) и кольцо PBO на каждую плоскость
+    static const int kUploadRingSize = 3;
+    struct StreamUpload {
+        GLuint planeTextures[2] = { 0, 0 };
+        int planeWidths[2] = { 0, 0 };
+        int planeHeights[2] = { 0, 0 };
+        GLenum planeFormats[2] = { 0, 0 };
+        GLuint uploadPbos[2 * kUploadRingSize] = {};
+        int uploadPboSizes[2 * kUploadRingSize] = {};
+        int uploadIndex = 0;
+        QSize sourceSize;  // размер загруженного кадра
+        QSize frameSize;   // размер после уменьшения
+    };
+    // Не уменьшается при setStreamCount(): GL объекты удаляются в деструкторе
+    QVector<StreamUpload> m_uploads;
+
+    // Раскладка атласа: тайл - наибольший кадр потоков, поля с каждой стороны
+    // тайла, сетка columns x rows (поток 0 - левый верхний)
+    int m_streamCount;
+    int m_tileWidth;
+    int m_tileHeight;
+    int m_tileGutter;
+    int m_atlasColumns;
+    int m_atlasRows;
+    QSize m_derivativeFrameSize;
+    int m_processingDownscale;
+    int m_requestedDownscale;
+    bool m_hasFrame;
+    qint64 m_frameTimestamp;
+    qint64 m_frameArrival;
+
+    // Первый устаревший stage (kStageCount - сохраненные результаты актуальны)
+    // и результаты, которые живут вне m_stageTargets
+    int m_dirtyStage;
+    bool m_stillMode;
+    int m_validPyramidLevels;
+    bool m_multiScaleValid;
+    // process() уже выполнялся для текущего кадра: следующий вызов начинает
+    // новый кадр профайлера
+    bool m_frameProcessed;
+
+    // Кольцо PBO для асинхронного чтения результата
+    FrangiAsyncReadback *m_asyncReadback;
+    bool m_asyncReadbackEnabled;
+
+    FrangiProfiler *m_profiler;
+
+    // Параметры фильтра
+    float m_sigma;
+    float m_beta;
+    float m_c;
+
+    // Включена ли инверсия
+    bool m_invertEnabled;
+
+    // Multi-scale режим и результат последнего кадра
+    bool m_multiScaleEnabled;
+    bool m_multiScaleActive;
+    QVector<float> m_scales;
+    float m_gamma;
+
+    // Считать passes 4-7 одним шейдером
+    bool m_fusedEnabled;
+
+    // Пороги и число pass'ов stage'а Centerline
+    FrangiCenterlineParams m_centerlineParams;
+
+    // Temporal stage: ping-pong истории vesselness (RG32F, G - sigma кадра)
+    // и яркости (полной и уменьшенной), индекс - результат последнего кадра
+    bool m_temporalEnabled;
+    bool m_temporalActive;
+    FrangiTemporalParams m_temporalParams;
+    QOpenGLFramebufferObject *m_temporalHistory[2];
+    QOpenGLFramebufferObject *m_temporalLuma[2];
+    QOpenGLFramebufferObject *m_temporalCoarse[2];
+    int m_temporalIndex;
+    bool m_temporalHistoryValid;
+    // Кадр загружен после прошлого смешивания
+    bool m_temporalNewFrame;
+
+    // Compute путь blur и его ресурсы
+    bool m_computeEnabled;
+    bool m_computeAvailable;
+    GLuint m_weightsUbo;
+    // Формат image2D выхода compute шейдеров (совпадает с FBO blur'а)
+    GLenum m_computeImageFormat;
+
+    // Точность FBO и нужно ли их пересоздать
+    FrangiPrecision m_precision;
+    bool m_framebuffersDirty;
+
+    // Gaussian ядро текущего sigma: полные веса (compute путь) и
+    // объединенные пары texel'ей для линейной выборки (fragment путь)
+    QVector<float> m_blurWeights;
+    QVector<float> m_linearWeights;
+    QVector<float> m_linearOffsets;
+    int m_blurRadius;
+    bool m_blurWeightsDirty;
+
+    // Размеры рабочих групп и UBO весов
+    static const int kBlurXGroupSize = 128;
+    static const int kBlurYGroupSize = 16;
+    static const int kBlurWeightsBinding = 0;
+    static const int kBlurWeightVec4Count = (2 * kFrangiMaxBlurRadius + 1 + 3) / 4;
+
+    // Quad для рендеринга
+    QOpenGLVertexArrayObject *m_vao;
+    GLuint m_vbo;
+};
+
+#endif // FRANGIPIPELINE_H
\ No newline at end of file
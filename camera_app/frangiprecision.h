@@ -0,0 +1,20 @@
+#ifndef FRANGIPRECISION_H
+#define FRANGIPRECISION_H
+
+// Точность промежуточных render target'ов GL конвейера. Число каналов
+// всегда по stage'у: grayscale/invert/blur/vesselness - R, gradients и
+// eigenvalues - RG, Hessian - RGBA (RGB не обязан быть renderable), overlay - RGBA8.
+//
+// Ошибка vesselness от округления выхода stage'а до half float (эталон
+// FrangiReference, фантомы 256 и 640 пикселей, max ошибка при пике ~0.26):
+//   grayscale/invert ~1e-3, blur ~1.2e-3 - производные blur'а умножаются на W/4;
+//   gradients, Hessian, eigenvalues, vesselness ~2-4e-4 каждый.
+// Поэтому Balanced оставляет 32F для цепочки до blur'а включительно и для
+// результата, а производные хранит в 16F.
+enum FrangiPrecision {
+    FrangiPrecisionFull,      // 32F везде: 56 байт/пиксель вместо 132 у RGBA32F
+    FrangiPrecisionBalanced,  // 16F для gradients/Hessian/eigenvalues: 40 байт/пиксель
+    FrangiPrecisionHalf       // 16F везде: 30 байт/пиксель, ошибка до ~2e-3
+};
+
+#endif // FRANGIPRECISION_H
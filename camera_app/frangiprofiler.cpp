@@ -0,0 +1,269 @@
+#include "frangiprofiler.h"
+#include <QDebug>
+#include <QOpenGLContext>
+#if !QT_CONFIG(opengles2)
+#include <QOpenGLTimerQuery>
+#endif
+#include <algorithm>
+#include <cmath>
+
+FrangiProfiler::FrangiProfiler()
+    : m_enabled(false)
+    , m_gpuChecked(false)
+    , m_gpuAvailable(false)
+    , m_gpuActive(false)
+    , m_current(-1)
+    , m_frameCounter(0)
+{
+    for (int i = 0; i < SectionCount; ++i) {
+        m_samples[i].reserve(kWindowSize);
+        m_sampleIndex[i] = 0;
+        m_lastTimes[i] = -1.0;
+    }
+}
+
+FrangiProfiler::~FrangiProfiler()
+{
+    stopCsv();
+#if !QT_CONFIG(opengles2)
+    for (Frame &frame : m_frames) {
+        qDeleteAll(frame.queries);
+    }
+#endif
+}
+
+void FrangiProfiler::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled) return;
+    
+    // Незавершенные кадры при выключении не попадают в статистику
+    m_enabled = enabled;
+    m_gpuActive = false;
+    for (Frame &frame : m_frames) {
+        frame.active = false;
+    }
+    m_current = -1;
+}
+
+void FrangiProfiler::initializeGpu()
+{
+    m_gpuChecked = true;
+#if !QT_CONFIG(opengles2)
+    // GL_TIME_ELAPSED: GL 3.3 или ARB_timer_query
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    if (!context || context->isOpenGLES()) return;
+    m_gpuAvailable = context->format().version() >= qMakePair(3, 3) ||
+                     context->hasExtension("GL_ARB_timer_query");
+#endif
+    if (!m_gpuAvailable) {
+        qDebug() << "FrangiProfiler: GPU timer queries are not available, CPU timings only";
+    }
+}
+
+void FrangiProfiler::beginFrame()
+{
+    if (!m_enabled) return;
+    
+    if (m_gpuActive) {
+        endGpu();
+    }
+    
+    // Набор запросов переиспользуется через kFrameLatency кадров: к этому
+    // времени GPU обычно уже закончил кадр
+    m_current = (m_current + 1) % kFrameLatency;
+    Frame &frame = m_frames[m_current];
+    if (frame.active) {
+        resolve(frame, false);
+    }
+    
+    frame.active = true;
+    frame.index = m_frameCounter++;
+    frame.used = 0;
+    std::fill(frame.times, frame.times + SectionCount, -1.0);
+}
+
+void FrangiProfiler::beginGpu(Section section)
+{
+    if (!m_enabled || m_current < 0 || m_gpuActive) return;
+    
+    if (!m_gpuChecked) {
+        initializeGpu();
+    }
+    if (!m_gpuAvailable) return;
+    
+#if !QT_CONFIG(opengles2)
+    Frame &frame = m_frames[m_current];
+    if (frame.used == frame.queries.size()) {
+        QOpenGLTimerQuery *query = new QOpenGLTimerQuery();
+        if (!query->create()) {
+            qDebug() << "FrangiProfiler: failed to create timer query";
+            delete query;
+            m_gpuAvailable = false;
+            return;
+        }
+        frame.queries.append(query);
+        frame.sections.append(section);
+    }
+    frame.sections[frame.used] = section;
+    frame.queries[frame.used]->begin();
+    ++frame.used;
+    m_gpuActive = true;
+#else
+    Q_UNUSED(section);
+#endif
+}
+
+void FrangiProfiler::endGpu()
+{
+    if (!m_gpuActive) return;
+    
+#if !QT_CONFIG(opengles2)
+    const Frame &frame = m_frames[m_current];
+    frame.queries[frame.used - 1]->end();
+#endif
+    m_gpuActive = false;
+}
+
+void FrangiProfiler::addCpuTime(Section section, double milliseconds)
+{
+    if (!m_enabled || m_current < 0) return;
+    
+    double &time = m_frames[m_current].times[section];
+    time = time < 0.0 ? milliseconds : time + milliseconds;
+}
+
+void FrangiProfiler::flush()
+{
+    if (!m_enabled || m_current < 0) return;
+    
+    if (m_gpuActive) {
+        endGpu();
+    }
+    
+    // Сначала более старый кадр, чтобы строки CSV шли по порядку
+    for (int i = 1; i <= kFrameLatency; ++i) {
+        Frame &frame = m_frames[(m_current + i) % kFrameLatency];
+        if (frame.active) {
+            resolve(frame, true);
+        }
+    }
+    m_current = -1;
+    if (m_csvFile.isOpen()) {
+        m_csv.flush();
+    }
+}
+
+void FrangiProfiler::resolve(Frame &frame, bool wait)
+{
+#if !QT_CONFIG(opengles2)
+    for (int i = 0; i < frame.used; ++i) {
+        // Без wait не дожидаемся GPU: неготовый результат просто пропускается
+        if (!wait && !frame.queries[i]->isResultAvailable()) continue;
+        
+        double &time = frame.times[frame.sections[i]];
+        const double milliseconds = frame.queries[i]->waitForResult() / 1e6;
+        time = time < 0.0 ? milliseconds : time + milliseconds;
+    }
+#endif
+    
+    std::copy(frame.times, frame.times + SectionCount, m_lastTimes);
+    for (int section = 0; section < SectionCount; ++section) {
+        const double time = frame.times[section];
+        if (time < 0.0) continue;
+        
+        QVector<double> &samples = m_samples[section];
+        if (samples.size() < kWindowSize) {
+            samples.append(time);
+        } else {
+            samples[m_sampleIndex[section]] = time;
+        }
+        m_sampleIndex[section] = (m_sampleIndex[section] + 1) % kWindowSize;
+    }
+    
+    if (m_csvFile.isOpen()) {
+        m_csv << frame.index;
+        for (int section = 0; section < SectionCount; ++section) {
+            m_csv << ',';
+            if (frame.times[section] >= 0.0) {
+                m_csv << QString::number(frame.times[section], 'f', 4);
+            }
+        }
+        m_csv << '\n';
+    }
+    frame.active = false;
+}
+
+FrangiProfiler::Stats FrangiProfiler::stats(Section section) const
+{
+    Stats result;
+    QVector<double> sorted = m_samples[section];
+    if (sorted.isEmpty()) return result;
+    
+    std::sort(sorted.begin(), sorted.end());
+    // Nearest-rank: наименьшее значение, не меньшее p доли выборки
+    auto percentile = [&sorted](double p) {
+        const int rank = qBound(1, int(std::ceil(p * sorted.size())), int(sorted.size()));
+        return sorted[rank - 1];
+    };
+    result.p50 = percentile(0.50);
+    result.p95 = percentile(0.95);
+    result.p99 = percentile(0.99);
+    result.count = int(sorted.size());
+    return result;
+}
+
+const char *FrangiProfiler::sectionName(Section section)
+{
+    switch (section) {
+        case SectionCapture: return "capture";
+        case SectionConvert: return "convert";
+        case SectionUpload: return "upload";
+        case SectionUnpack: return "unpack";
+        case SectionGrayscale: return "grayscale";
+        case SectionInvert: return "invert";
+        case SectionBlurX: return "blur_x";
+        case SectionBlurY: return "blur_y";
+        case SectionGradients: return "gradients";
+        case SectionHessian: return "hessian";
+        case SectionEigenvalues: return "eigenvalues";
+        case SectionVesselness: return "vesselness";
+        case SectionDownsample: return "downsample";
+        case SectionScaleMax: return "scale_max";
+        case SectionTemporal: return "temporal";
+        case SectionOverlay: return "overlay";
+        case SectionCenterline: return "centerline";
+        case SectionGraph: return "graph";
+        case SectionDisplay: return "display";
+        case SectionReadback: return "readback";
+        case SectionCount: break;
+    }
+    return "";
+}
+
+bool FrangiProfiler::startCsv(const QString &path)
+{
+    stopCsv();
+    
+    m_csvFile.setFileName(path);
+    if (!m_csvFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qDebug() << "FrangiProfiler: cannot open" << path << m_csvFile.errorString();
+        return false;
+    }
+    m_csv.setDevice(&m_csvFile);
+    
+    m_csv << "frame";
+    for (int section = 0; section < SectionCount; ++section) {
+        m_csv << ',' << sectionName(Section(section)) << "_ms";
+    }
+    m_csv << '\n';
+    return true;
+}
+
+void FrangiProfiler::stopCsv()
+{
+    if (!m_csvFile.isOpen()) return;
+    
+    m_csv.flush();
+    m_csv.setDevice(nullptr);
+    m_csvFile.close();
+}
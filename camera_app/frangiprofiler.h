@@ -0,0 +1,162 @@
+#ifndef FRANGIPROFILER_H
+#define FRANGIPROFILER_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include <QTextStream>
+#include <QVector>
+
+class QOpenGLTimerQuery;
+
+// Время stage'ей конвейера по кадрам: GPU passes через GL_TIME_ELAPSED
+// запросы (QOpenGLTimerQuery), CPU участки - QElapsedTimer'ом.
+// Запросы кадра N читаются в начале кадра N+2 (два набора запросов),
+// поэтому профилирование не останавливает конвейер; результат, который
+// к этому времени не готов, пропускается. По каждому stage'у хранится
+// скользящее окно последних кадров для p50/p95/p99, кадры можно писать в CSV.
+// GPU методы требуют текущего контекста.
+class FrangiProfiler
+{
+public:
+    enum Section {
+        SectionCapture,      // CPU: отображение и копирование кадра камеры
+        SectionConvert,      // CPU: конвертация формата кадра в RGBX
+        SectionUpload,       // CPU: копирование плоскостей в PBO
+        SectionUnpack,       // GPU: загрузка текстур и распаковка кадра
+        SectionGrayscale,
+        SectionInvert,
+        SectionBlurX,
+        SectionBlurY,
+        SectionGradients,
+        SectionHessian,
+        SectionEigenvalues,
+        SectionVesselness,   // pass 7 или fused passes 4-7
+        SectionDownsample,   // multi-scale: уровни пирамиды
+        SectionScaleMax,     // multi-scale: максимум по масштабам
+        SectionTemporal,     // поиск движения и смешивание с историей
+        SectionOverlay,
+        SectionCenterline,   // NMS, гистерезис и утончение до скелета
+        SectionGraph,        // CPU: инкрементальный граф сосудов
+        SectionDisplay,      // pass 9
+        SectionReadback,     // GPU: копирование результата в PBO
+        SectionCount
+    };
+
+    struct Stats {
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        int count = 0;       // кадров в окне
+    };
+
+    FrangiProfiler();
+    // GPU запросы удаляются в текущем контексте
+    ~FrangiProfiler();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+
+    // Начало нового кадра: результаты кадра двумя кадрами раньше уходят
+    // в статистику и CSV
+    void beginFrame();
+    // Дожидается результатов последних кадров (конец обработки, перед stopCsv())
+    void flush();
+
+    // GPU участок (не вкладываются друг в друга)
+    void beginGpu(Section section);
+    void endGpu();
+    bool gpuTimingAvailable() const { return m_gpuAvailable; }
+
+    // CPU участок текущего кадра, суммируется при повторе
+    void addCpuTime(Section section, double milliseconds);
+
+    // Скользящая статистика по последним kWindowSize кадрам, в мс
+    Stats stats(Section section) const;
+    // Время stage'а в последнем обработанном кадре (после flush() - в последнем
+    // кадре), мс; -1 - stage в этом кадре не выполнялся или результата GPU нет
+    double lastTime(Section section) const { return m_lastTimes[section]; }
+    static const char *sectionName(Section section);
+
+    // CSV: кадр на строку, пустая ячейка - stage не выполнялся
+    bool startCsv(const QString &path);
+    void stopCsv();
+
+    static const int kWindowSize = 240;
+
+private:
+    struct Frame {
+        bool active = false;
+        quint64 index = 0;
+        double times[SectionCount];
+        QVector<QOpenGLTimerQuery *> queries;
+        QVector<int> sections;
+        int used = 0;
+    };
+
+    void resolve(Frame &frame, bool wait);
+    void initializeGpu();
+
+    static const int kFrameLatency = 2;
+
+    bool m_enabled;
+    bool m_gpuChecked;
+    bool m_gpuAvailable;
+    bool m_gpuActive;
+
+    Frame m_frames[kFrameLatency];
+    int m_current;  // -1, пока не было beginFrame()
+    quint64 m_frameCounter;
+
+    // Окна значений по stage'ам (кольцо)
+    QVector<double> m_samples[SectionCount];
+    int m_sampleIndex[SectionCount];
+    // Времена последнего обработанного кадра
+    double m_lastTimes[SectionCount];
+
+    QFile m_csvFile;
+    QTextStream m_csv;
+};
+
+// CPU участок в пределах области видимости
+class FrangiCpuProfileScope
+{
+public:
+    FrangiCpuProfileScope(FrangiProfiler *profiler, FrangiProfiler::Section section)
+        : m_profiler(profiler && profiler->isEnabled() ? profiler : nullptr)
+        , m_section(section)
+    {
+        if (m_profiler) m_timer.start();
+    }
+
+    ~FrangiCpuProfileScope()
+    {
+        if (m_profiler) m_profiler->addCpuTime(m_section, m_timer.nsecsElapsed() / 1e6);
+    }
+
+private:
+    FrangiProfiler *m_profiler;
+    FrangiProfiler::Section m_section;
+    QElapsedTimer m_timer;
+};
+
+// GPU участок в пределах области видимости
+class FrangiGpuProfileScope
+{
+public:
+    FrangiGpuProfileScope(FrangiProfiler *profiler, FrangiProfiler::Section section)
+        : m_profiler(profiler && profiler->isEnabled() ? profiler : nullptr)
+    {
+        if (m_profiler) m_profiler->beginGpu(section);
+    }
+
+    ~FrangiGpuProfileScope()
+    {
+        if (m_profiler) m_profiler->endGpu();
+    }
+
+private:
+    FrangiProfiler *m_profiler;
+};
+
+#endif // FRANGIPROFILER_H
@@ -0,0 +1,242 @@
+#include "frangireadback.h"
+#include <QDebug>
+#include <QFloat16>
+#include <cstring>
+
+int FrangiReadbackFrame::bytesPerPixel(FrangiReadbackFormat format)
+{
+    switch (format) {
+        case FrangiReadbackR8: return 1;
+        case FrangiReadbackR16F: return 2;
+        case FrangiReadbackR32F:
+        default: return 4;
+    }
+}
+
+float FrangiReadbackFrame::valueAt(int x, int y) const
+{
+    const int index = y * roi.width() + x;
+    switch (format) {
+        case FrangiReadbackR8:
+            return uchar(data.constData()[index]) / 255.0f;
+        case FrangiReadbackR16F:
+            return float(reinterpret_cast<const qfloat16 *>(data.constData())[index]);
+        case FrangiReadbackR32F:
+        default:
+            return reinterpret_cast<const float *>(data.constData())[index];
+    }
+}
+
+QVector<float> FrangiReadbackFrame::toFloat() const
+{
+    QVector<float> result(roi.width() * roi.height());
+    if (isNull()) return result;
+    
+    switch (format) {
+        case FrangiReadbackR8:
+            for (int i = 0; i < result.size(); ++i) {
+                result[i] = uchar(data.constData()[i]) / 255.0f;
+            }
+            break;
+        case FrangiReadbackR16F:
+            qFloatFromFloat16(result.data(), reinterpret_cast<const qfloat16 *>(data.constData()), result.size());
+            break;
+        case FrangiReadbackR32F:
+            memcpy(result.data(), data.constData(), result.size() * sizeof(float));
+            break;
+    }
+    return result;
+}
+
+FrangiReadbackFrame FrangiReadbackFrame::fromFloat(const QVector<float> &vesselness, int width, int height,
+                                                   FrangiReadbackFormat format, const QRect &roi)
+{
+    FrangiReadbackFrame frame;
+    frame.format = format;
+    frame.roi = roi.isEmpty() ? QRect(0, 0, width, height) : roi.intersected(QRect(0, 0, width, height));
+    if (frame.roi.isEmpty() || vesselness.size() < width * height) return frame;
+    
+    const int roiWidth = frame.roi.width();
+    frame.data.resize(roiWidth * frame.roi.height() * bytesPerPixel(format));
+    for (int y = 0; y < frame.roi.height(); ++y) {
+        const float *src = vesselness.constData() + (frame.roi.y() + y) * width + frame.roi.x();
+        switch (format) {
+            case FrangiReadbackR8: {
+                // Как при записи в R8 текстуру: clamp и округление
+                uchar *dst = reinterpret_cast<uchar *>(frame.data.data()) + y * roiWidth;
+                for (int x = 0; x < roiWidth; ++x) {
+                    dst[x] = uchar(qBound(0.0f, src[x], 1.0f) * 255.0f + 0.5f);
+                }
+                break;
+            }
+            case FrangiReadbackR16F:
+                qFloatToFloat16(reinterpret_cast<qfloat16 *>(frame.data.data()) + y * roiWidth, src, roiWidth);
+                break;
+            case FrangiReadbackR32F:
+                memcpy(reinterpret_cast<float *>(frame.data.data()) + y * roiWidth, src, roiWidth * sizeof(float));
+                break;
+        }
+    }
+    return frame;
+}
+
+FrangiAsyncReadback::FrangiAsyncReadback()
+    : m_initialized(false)
+    , m_format(FrangiReadbackR32F)
+    , m_writeIndex(0)
+    , m_readIndex(0)
+    , m_pending(0)
+    , m_frameCounter(0)
+    , m_staging(nullptr)
+    , m_stagingFormat(FrangiReadbackR32F)
+{
+    for (Slot &slot : m_slots) {
+        slot.pbo = 0;
+        slot.capacity = 0;
+        slot.fence = nullptr;
+    }
+}
+
+FrangiAsyncReadback::~FrangiAsyncReadback()
+{
+    // Контекст, в котором создавались ресурсы, должен быть текущим
+    if (!m_initialized) return;
+    
+    for (Slot &slot : m_slots) {
+        if (slot.fence) {
+            glDeleteSync(slot.fence);
+        }
+        if (slot.pbo) {
+            glDeleteBuffers(1, &slot.pbo);
+        }
+    }
+    delete m_staging;
+}
+
+void FrangiAsyncReadback::initialize()
+{
+    if (m_initialized) return;
+    
+    initializeOpenGLFunctions();
+    for (Slot &slot : m_slots) {
+        glGenBuffers(1, &slot.pbo);
+    }
+    m_initialized = true;
+}
+
+void FrangiAsyncReadback::enqueue(GLuint sourceFramebuffer, int width, int height, qint64 timestamp)
+{
+    if (!m_initialized) return;
+    
+    const QRect roi = m_roi.isEmpty() ? QRect(0, 0, width, height)
+                                      : m_roi.intersected(QRect(0, 0, width, height));
+    if (roi.isEmpty()) return;
+    
+    // Кольцо заполнено: самый старый кадр нужно забрать до перезаписи PBO
+    if (m_pending == kRingSize) {
+        deliver(m_slots[m_readIndex], true);
+    }
+    
+    // Staging FBO формата результата: драйвер конвертирует float при blit'е,
+    // а glReadPixels читает родной формат без конвертации на CPU
+    if (!m_staging || m_staging->size() != roi.size() || m_stagingFormat != m_format) {
+        delete m_staging;
+        QOpenGLFramebufferObjectFormat format;
+        switch (m_format) {
+            case FrangiReadbackR8: format.setInternalTextureFormat(GL_R8); break;
+            case FrangiReadbackR16F: format.setInternalTextureFormat(GL_R16F); break;
+            case FrangiReadbackR32F: format.setInternalTextureFormat(GL_R32F); break;
+        }
+        format.setTextureTarget(GL_TEXTURE_2D);
+        m_staging = new QOpenGLFramebufferObject(roi.size(), format);
+        m_stagingFormat = m_format;
+    }
+    
+    // ROI задан сверху вниз, в FBO строки идут снизу вверх: blit переворачивает
+    const int sourceY0 = height - roi.y() - roi.height();
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, sourceFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_staging->handle());
+    glBlitFramebuffer(roi.x(), sourceY0, roi.x() + roi.width(), sourceY0 + roi.height(),
+                      0, roi.height(), roi.width(), 0, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    
+    Slot &slot = m_slots[m_writeIndex];
+    const int bytesPerPixel = FrangiReadbackFrame::bytesPerPixel(m_format);
+    const int size = roi.width() * roi.height() * bytesPerPixel;
+    
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_staging->handle());
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if (slot.capacity < size) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slot.capacity = size;
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    GLenum type = GL_FLOAT;
+    if (m_format == FrangiReadbackR8) type = GL_UNSIGNED_BYTE;
+    if (m_format == FrangiReadbackR16F) type = GL_HALF_FLOAT;
+    glReadPixels(0, 0, roi.width(), roi.height(), GL_RED, type, nullptr);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = FrangiReadbackFrame();
+    slot.frame.format = m_format;
+    slot.frame.roi = roi;
+    slot.frame.timestamp = timestamp;
+    slot.frame.frameIndex = m_frameCounter++;
+    
+    m_writeIndex = (m_writeIndex + 1) % kRingSize;
+    ++m_pending;
+    
+    // Отправляем команды драйверу, чтобы fence сработал без явного ожидания
+    glFlush();
+}
+
+void FrangiAsyncReadback::poll()
+{
+    // Кадры отдаются строго по порядку: первый неготовый останавливает опрос
+    while (m_pending > 0 && deliver(m_slots[m_readIndex], false)) {
+    }
+}
+
+void FrangiAsyncReadback::flush()
+{
+    while (m_pending > 0) {
+        deliver(m_slots[m_readIndex], true);
+    }
+}
+
+bool FrangiAsyncReadback::deliver(Slot &slot, bool wait)
+{
+    const GLuint64 timeout = wait ? GLuint64(1000000000) : 0;  // 1 с
+    const GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+    if (status == GL_TIMEOUT_EXPIRED && !wait) return false;
+    if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+        // Map все равно дождется GPU, просто отмечаем проблему
+        qDebug() << "FrangiAsyncReadback: fence wait failed, frame" << slot.frame.frameIndex;
+    }
+    
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    
+    const int size = slot.frame.roi.width() * slot.frame.roi.height() *
+                     FrangiReadbackFrame::bytesPerPixel(slot.frame.format);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    const void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (mapped) {
+        slot.frame.data = QByteArray(static_cast<const char *>(mapped), size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        qDebug() << "FrangiAsyncReadback: failed to map PBO";
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    
+    m_readIndex = (m_readIndex + 1) % kRingSize;
+    --m_pending;
+    
+    if (m_callback && !slot.frame.isNull()) {
+        m_callback(slot.frame);
+    }
+    slot.frame = FrangiReadbackFrame();
+    return true;
+}
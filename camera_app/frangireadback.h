@@ -0,0 +1,98 @@
+#ifndef FRANGIREADBACK_H
+#define FRANGIREADBACK_H
+
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFramebufferObject>
+#include <QByteArray>
+#include <QRect>
+#include <QVector>
+#include <functional>
+
+// Формат результата асинхронного чтения vesselness
+enum FrangiReadbackFormat {
+    FrangiReadbackR8,    // [0, 1] -> 0..255
+    FrangiReadbackR16F,  // half float
+    FrangiReadbackR32F   // float как в FBO
+};
+
+// Прочитанный регион vesselness одного кадра.
+// Строки сверху вниз (как в QImage), без padding'а
+struct FrangiReadbackFrame
+{
+    FrangiReadbackFormat format = FrangiReadbackR32F;
+    QRect roi;               // регион в координатах кадра
+    QByteArray data;
+    qint64 timestamp = 0;    // FrangiFrameView::timestamp кадра
+    quint64 frameIndex = 0;  // порядковый номер кадра в FrangiAsyncReadback
+
+    bool isNull() const { return data.isEmpty(); }
+    static int bytesPerPixel(FrangiReadbackFormat format);
+    float valueAt(int x, int y) const;  // x, y относительно roi
+    QVector<float> toFloat() const;
+
+    // Результат CPU backend'а в том же виде, что и у GL чтения
+    static FrangiReadbackFrame fromFloat(const QVector<float> &vesselness, int width, int height,
+                                         FrangiReadbackFormat format, const QRect &roi);
+};
+
+// Асинхронное чтение текстуры результата через кольцо PBO с fence'ами.
+// enqueue() копирует регион в staging FBO нужного формата (blit с
+// переворотом строк), запускает glReadPixels в PBO и ставит fence;
+// poll() без ожидания отдает callback'у готовые кадры по порядку.
+// При кольце из 3 PBO кадр N доставляется, пока считается кадр N+2.
+// Все методы требуют текущего контекста.
+class FrangiAsyncReadback : protected QOpenGLExtraFunctions
+{
+public:
+    using Callback = std::function<void(const FrangiReadbackFrame &)>;
+
+    FrangiAsyncReadback();
+    ~FrangiAsyncReadback();
+
+    void initialize();
+
+    void setFormat(FrangiReadbackFormat format) { m_format = format; }
+    FrangiReadbackFormat format() const { return m_format; }
+    // Регион в координатах кадра (строки сверху вниз), пустой - весь кадр
+    void setRoi(const QRect &roi) { m_roi = roi; }
+    QRect roi() const { return m_roi; }
+    void setCallback(Callback callback) { m_callback = std::move(callback); }
+
+    // Ставит чтение color attachment'а framebuffer'а в очередь.
+    // Если кольцо заполнено, сначала дожидается самого старого кадра
+    void enqueue(GLuint sourceFramebuffer, int width, int height, qint64 timestamp);
+    // Отдает готовые кадры без ожидания
+    void poll();
+    // Дожидается и отдает все кадры в очереди
+    void flush();
+    int pendingCount() const { return m_pending; }
+
+private:
+    struct Slot {
+        GLuint pbo;
+        int capacity;
+        GLsync fence;
+        FrangiReadbackFrame frame;
+    };
+
+    bool deliver(Slot &slot, bool wait);
+
+    static const int kRingSize = 3;
+
+    bool m_initialized;
+    FrangiReadbackFormat m_format;
+    QRect m_roi;
+    Callback m_callback;
+
+    Slot m_slots[kRingSize];
+    int m_writeIndex;  // следующий слот для enqueue
+    int m_readIndex;   // самый старый слот в очереди
+    int m_pending;
+    quint64 m_frameCounter;
+
+    // Staging FBO формата m_format размером с регион
+    QOpenGLFramebufferObject *m_staging;
+    FrangiReadbackFormat m_stagingFormat;
+};
+
+#endif // FRANGIREADBACK_H
@@ -0,0 +1,345 @@
+#include "frangirecording.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <QThread>
+#include <cstring>
+
+namespace {
+
+// Чанк файла - не меньше одной записи и ~64 МБ
+const qint64 kChunkBytes = 64 * 1024 * 1024;
+
+// Первая запись начинается со страницы, чтобы чанки отображались без сдвига
+const quint32 kRecordingHeaderSize = 4096;
+
+qint64 alignTo64(qint64 value)
+{
+    return (value + 63) & ~qint64(63);
+}
+
+// Плоскости кадра в записи: строки без padding'а источника
+bool planeLayout(FrangiFrameView::Format format, int width, int height, qint32 strides[2], qint32 rows[2])
+{
+    strides[1] = 0;
+    rows[0] = height;
+    rows[1] = 0;
+    switch (format) {
+        case FrangiFrameView::FormatRgb24: strides[0] = width * 3; break;
+        case FrangiFrameView::FormatRgbx:
+        case FrangiFrameView::FormatBgrx: strides[0] = width * 4; break;
+        case FrangiFrameView::FormatYuyv:
+        case FrangiFrameView::FormatUyvy: strides[0] = (width + 1) / 2 * 4; break;
+        case FrangiFrameView::FormatNv12:
+            strides[0] = width;
+            strides[1] = (width + 1) / 2 * 2;
+            rows[1] = (height + 1) / 2;
+            break;
+        default: return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool FrangiRecordingHeader::isValid() const
+{
+    return std::memcmp(magic, "FRANGREC", 8) == 0 && version == quint32(kVersion) &&
+           headerSize >= sizeof(FrangiRecordingHeader) && width > 0 && height > 0 &&
+           format > FrangiFrameView::FormatInvalid && format <= FrangiFrameView::FormatUyvy &&
+           recordSize >= vesselnessOffset();
+}
+
+qint64 FrangiRecordingHeader::planeOffset(int plane) const
+{
+    return plane == 0 ? qint64(sizeof(FrangiRecordHeader))
+                      : planeOffset(0) + qint64(strides[0]) * rows[0];
+}
+
+qint64 FrangiRecordingHeader::vesselnessOffset() const
+{
+    return planeOffset(1) + qint64(strides[1]) * rows[1];
+}
+
+FrangiRecorder::FrangiRecorder()
+    : m_recordVesselness(false)
+    , m_started(false)
+    , m_frameIndex(0)
+    , m_stopping(false)
+    , m_thread(nullptr)
+    , m_chunk(nullptr)
+    , m_chunkIndex(0)
+    , m_written(0)
+    , m_recorded(0)
+    , m_dropped(0)
+{
+}
+
+FrangiRecorder::~FrangiRecorder()
+{
+    close();
+}
+
+bool FrangiRecorder::open(const QString &path, bool recordVesselness, double frameRate)
+{
+    close();
+    
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        m_error = QString("Cannot create %1: %2").arg(path, m_file.errorString());
+        return false;
+    }
+    
+    m_header = FrangiRecordingHeader();
+    m_header.headerSize = kRecordingHeaderSize;
+    m_header.frameRate = frameRate;
+    m_recordVesselness = recordVesselness;
+    m_started = false;
+    m_frameIndex = 0;
+    m_written = 0;
+    m_recorded.store(0, std::memory_order_relaxed);
+    m_dropped.store(0, std::memory_order_relaxed);
+    m_error.clear();
+    return true;
+}
+
+bool FrangiRecorder::startRecording(const FrangiFrameView &frame)
+{
+    if (!planeLayout(frame.format, frame.width, frame.height, m_header.strides, m_header.rows)) {
+        m_error = "Unsupported frame format for recording";
+        return false;
+    }
+    m_header.format = frame.format;
+    m_header.width = frame.width;
+    m_header.height = frame.height;
+    m_header.flags = m_recordVesselness ? FrangiRecordingHeader::FlagVesselness : 0;
+    const qint64 vesselnessBytes = m_recordVesselness ? qint64(frame.width) * frame.height * sizeof(float) : 0;
+    m_header.recordSize = quint32(alignTo64(m_header.vesselnessOffset() + vesselnessBytes));
+    m_header.chunkRecords = quint32(qMax<qint64>(1, kChunkBytes / m_header.recordSize));
+    
+    // Буферы выделяются один раз: дальше submit() только копирует
+    m_slots.resize(kSlotCount);
+    m_freeSlots.clear();
+    m_pendingSlots.clear();
+    for (int i = 0; i < kSlotCount; ++i) {
+        m_slots[i] = QByteArray(int(m_header.recordSize), '\0');
+        m_freeSlots.append(i);
+    }
+    
+    // Первый чанк и следующий за ним выделяются до первого кадра
+    if (!mapChunk(0)) {
+        qDebug() << "FrangiRecorder:" << m_error;
+        return false;
+    }
+    
+    m_stopping = false;
+    m_thread = QThread::create([this]() { writerLoop(); });
+    m_thread->start();
+    m_started = true;
+    return true;
+}
+
+bool FrangiRecorder::submit(const FrangiFrameView &frame, const FrangiRecordParams &params,
+                            const float *vesselness)
+{
+    if (!m_file.isOpen() || !frame.isValid()) return false;
+    
+    // Номер кадра растет и для отброшенных кадров: пропуски видны при воспроизведении
+    const quint64 frameIndex = m_frameIndex++;
+    if (!m_started && !startRecording(frame)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (frame.format != m_header.format || frame.width != m_header.width || frame.height != m_header.height) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    
+    int slot = -1;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_freeSlots.isEmpty()) {
+            slot = m_freeSlots.takeLast();
+        }
+    }
+    if (slot < 0) {
+        // Поток записи не успевает (медленный диск): вызывающий поток не ждет
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    
+    uchar *record = reinterpret_cast<uchar *>(m_slots[slot].data());
+    FrangiRecordHeader header;
+    header.frameIndex = frameIndex;
+    header.timestamp = frame.timestamp;
+    header.params = params;
+    for (int plane = 0; plane < 2; ++plane) {
+        uchar *dst = record + m_header.planeOffset(plane);
+        for (int y = 0; y < m_header.rows[plane]; ++y) {
+            std::memcpy(dst + y * m_header.strides[plane], frame.planes[plane] + y * frame.strides[plane],
+                        m_header.strides[plane]);
+        }
+    }
+    if (vesselness && m_recordVesselness) {
+        std::memcpy(record + m_header.vesselnessOffset(), vesselness,
+                    size_t(frame.width) * frame.height * sizeof(float));
+        header.flags |= FrangiRecordHeader::RecordHasVesselness;
+    }
+    std::memcpy(record, &header, sizeof(header));
+    
+    QMutexLocker locker(&m_mutex);
+    m_pendingSlots.append(slot);
+    m_condition.wakeOne();
+    return true;
+}
+
+void FrangiRecorder::writerLoop()
+{
+    while (true) {
+        int slot;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_pendingSlots.isEmpty() && !m_stopping) {
+                m_condition.wait(&m_mutex);
+            }
+            // Остановка только после того, как очередь дописана
+            if (m_pendingSlots.isEmpty()) break;
+            slot = m_pendingSlots.takeFirst();
+        }
+        
+        const bool written = writeRecord(m_slots.at(slot));
+        if (written) {
+            m_recorded.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        
+        QMutexLocker locker(&m_mutex);
+        m_freeSlots.append(slot);
+    }
+}
+
+bool FrangiRecorder::writeRecord(const QByteArray &record)
+{
+    const quint64 chunk = m_written / m_header.chunkRecords;
+    if ((!m_chunk || chunk != m_chunkIndex) && !mapChunk(chunk)) {
+        qDebug() << "FrangiRecorder:" << m_error;
+        return false;
+    }
+    
+    std::memcpy(m_chunk + (m_written % m_header.chunkRecords) * m_header.recordSize,
+                record.constData(), m_header.recordSize);
+    ++m_written;
+    return true;
+}
+
+bool FrangiRecorder::mapChunk(quint64 chunk)
+{
+    if (m_chunk) {
+        m_file.unmap(m_chunk);
+        m_chunk = nullptr;
+    }
+    
+    // Файл всегда на чанк длиннее текущего: рост не попадает на горячий путь
+    const qint64 chunkBytes = qint64(m_header.chunkRecords) * m_header.recordSize;
+    const qint64 offset = m_header.headerSize + qint64(chunk) * chunkBytes;
+    if (m_file.size() < offset + 2 * chunkBytes && !m_file.resize(offset + 2 * chunkBytes)) {
+        m_error = QString("Cannot grow recording: %1").arg(m_file.errorString());
+        return false;
+    }
+    m_chunk = m_file.map(offset, chunkBytes);
+    if (!m_chunk) {
+        m_error = QString("Cannot map recording chunk: %1").arg(m_file.errorString());
+        return false;
+    }
+    m_chunkIndex = chunk;
+    return true;
+}
+
+void FrangiRecorder::close()
+{
+    if (!m_file.isOpen()) return;
+    
+    if (m_thread) {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_stopping = true;
+            m_condition.wakeOne();
+        }
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+    if (m_chunk) {
+        m_file.unmap(m_chunk);
+        m_chunk = nullptr;
+    }
+    
+    // Заранее выделенный хвост отрезается, число записей - в заголовок
+    m_header.recordCount = m_written;
+    m_file.resize(m_header.headerSize + qint64(m_written) * m_header.recordSize);
+    m_file.seek(0);
+    m_file.write(reinterpret_cast<const char *>(&m_header), sizeof(m_header));
+    m_file.close();
+    
+    m_slots.clear();
+    m_started = false;
+}
+
+bool FrangiRecordingSource::open(const QString &path)
+{
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        m_error = QString("Cannot open %1: %2").arg(path, m_file.errorString());
+        return false;
+    }
+    
+    const qint64 size = m_file.size();
+    m_data = m_file.map(0, size);
+    if (!m_data || size < qint64(sizeof(FrangiRecordingHeader))) {
+        m_error = QString("Cannot map %1").arg(path);
+        return false;
+    }
+    std::memcpy(&m_header, m_data, sizeof(m_header));
+    if (!m_header.isValid()) {
+        m_error = QString("Not a frame recording: %1").arg(path);
+        return false;
+    }
+    
+    // Незакрытая запись (аварийное завершение): число записей по размеру
+    // файла, read() остановится на первой пустой записи заранее выделенного хвоста
+    const quint64 available = quint64(qMax<qint64>(0, size - m_header.headerSize)) / m_header.recordSize;
+    if (m_header.recordCount == 0 || m_header.recordCount > available) {
+        m_header.recordCount = available;
+    }
+    m_index = 0;
+    m_current = nullptr;
+    return true;
+}
+
+bool FrangiRecordingSource::read(FrangiFrameView *frame)
+{
+    if (!m_data || m_index >= m_header.recordCount) return false;
+    
+    const uchar *record = m_data + m_header.headerSize + m_index * m_header.recordSize;
+    const FrangiRecordHeader *header = reinterpret_cast<const FrangiRecordHeader *>(record);
+    if (m_index > 0 && header->frameIndex == 0) return false;
+    
+    frame->format = FrangiFrameView::Format(m_header.format);
+    frame->width = m_header.width;
+    frame->height = m_header.height;
+    frame->timestamp = header->timestamp;
+    for (int plane = 0; plane < 2; ++plane) {
+        frame->planes[plane] = m_header.rows[plane] ? record + m_header.planeOffset(plane) : nullptr;
+        frame->strides[plane] = m_header.strides[plane];
+    }
+    m_current = record;
+    ++m_index;
+    return true;
+}
+
+const float *FrangiRecordingSource::vesselness() const
+{
+    const FrangiRecordHeader *header = record();
+    if (!header || !(header->flags & FrangiRecordHeader::RecordHasVesselness)) return nullptr;
+    return reinterpret_cast<const float *>(m_current + m_header.vesselnessOffset());
+}
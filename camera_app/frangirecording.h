@@ -0,0 +1,167 @@
+#ifndef FRANGIRECORDING_H
+#define FRANGIRECORDING_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QVector>
+#include <QWaitCondition>
+#include <atomic>
+#include "frangiframe.h"
+#include "frangiframesource.h"
+
+class QThread;
+
+// Контейнер записи кадров (*.frec): заголовок FrangiRecordingHeader и записи
+// одинакового размера - FrangiRecordHeader, плоскости кадра построчно без
+// padding'а и, если в заголовке есть FlagVesselness, карта vesselness
+// (float32, строки сверху вниз). Все поля little-endian. Файл растет
+// чанками по chunkRecords записей; записи выровнены на 64 байта.
+
+// Параметры фильтра на момент кадра, чтобы воспроизведение повторило обработку
+struct FrangiRecordParams
+{
+    float sigma = 1.5f;
+    float beta = 0.5f;
+    float c = 15.0f;
+    float gamma = 2.0f;
+    float minScale = 1.0f;   // multi-scale: диапазон sigma
+    float maxScale = 8.0f;
+    qint32 scaleCount = 5;
+    quint8 invert = 1;
+    quint8 multiScale = 0;
+    quint8 reserved[2] = { 0, 0 };
+};
+
+struct FrangiRecordHeader
+{
+    enum Flags {
+        RecordHasVesselness = 1  // карта vesselness записи заполнена
+    };
+
+    quint64 frameIndex = 0;
+    qint64 timestamp = 0;    // FrangiFrameView::timestamp, мкс
+    quint32 flags = 0;
+    FrangiRecordParams params;
+    quint8 padding[12] = {};
+};
+
+struct FrangiRecordingHeader
+{
+    enum Flags {
+        FlagVesselness = 1  // в записях есть место под карту vesselness
+    };
+
+    static const int kVersion = 1;
+
+    char magic[8] = { 'F', 'R', 'A', 'N', 'G', 'R', 'E', 'C' };
+    quint32 version = kVersion;
+    quint32 headerSize = 0;     // смещение первой записи
+    qint32 format = 0;          // FrangiFrameView::Format
+    qint32 width = 0;
+    qint32 height = 0;
+    qint32 strides[2] = { 0, 0 };  // байт в строке плоскости внутри записи
+    qint32 rows[2] = { 0, 0 };     // строк в плоскости
+    quint32 flags = 0;
+    quint32 recordSize = 0;
+    quint32 chunkRecords = 0;
+    quint64 recordCount = 0;    // записывается при закрытии
+    double frameRate = 0.0;     // 0 - неизвестна
+    quint8 reserved[56] = {};
+
+    bool isValid() const;
+    qint64 planeOffset(int plane) const;
+    qint64 vesselnessOffset() const;
+};
+
+static_assert(sizeof(FrangiRecordParams) == 32, "FrangiRecordParams layout");
+static_assert(sizeof(FrangiRecordHeader) == 64, "FrangiRecordHeader layout");
+static_assert(sizeof(FrangiRecordingHeader) == 128, "FrangiRecordingHeader layout");
+
+// Запись кадров в *.frec без блокировки вызывающего потока. submit() копирует
+// кадр в один из kSlotCount заранее выделенных буферов и сразу возвращается
+// (при нехватке буферов кадр отбрасывается и учитывается в droppedCount()),
+// а поток записи переносит буферы в отображенный в память чанк файла. Следующий
+// чанк выделяется заранее, когда начинается текущий, поэтому запись не ждет
+// роста файла. Формат и размер кадра задает первый кадр.
+class FrangiRecorder
+{
+public:
+    static const int kSlotCount = 8;
+
+    FrangiRecorder();
+    ~FrangiRecorder();
+
+    // recordVesselness - резервировать в записях место под карту vesselness
+    bool open(const QString &path, bool recordVesselness, double frameRate = 0.0);
+    // Дописывает очередь, обрезает файл до записанных кадров и закрывает его
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+
+    // vesselness - карта width*height (строки сверху вниз) или nullptr.
+    // Кадр другого формата или размера, чем первый, отбрасывается
+    bool submit(const FrangiFrameView &frame, const FrangiRecordParams &params,
+                const float *vesselness = nullptr);
+
+    quint64 recordedCount() const { return m_recorded.load(std::memory_order_relaxed); }
+    quint64 droppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+    QString errorString() const { return m_error; }
+
+private:
+    bool startRecording(const FrangiFrameView &frame);
+    void writerLoop();
+    bool writeRecord(const QByteArray &record);
+    bool mapChunk(quint64 chunk);
+
+    QFile m_file;
+    FrangiRecordingHeader m_header;
+    bool m_recordVesselness;
+    bool m_started;
+    quint64 m_frameIndex;
+    QString m_error;
+
+    // Буферы записей: свободные у producer'а, заполненные - у потока записи
+    QVector<QByteArray> m_slots;
+    QMutex m_mutex;
+    QWaitCondition m_condition;
+    QVector<int> m_freeSlots;
+    QVector<int> m_pendingSlots;
+    bool m_stopping;
+    QThread *m_thread;
+
+    // Текущий чанк (только поток записи)
+    uchar *m_chunk;
+    quint64 m_chunkIndex;
+    quint64 m_written;
+
+    std::atomic<quint64> m_recorded;
+    std::atomic<quint64> m_dropped;
+};
+
+// Воспроизведение *.frec: файл отображается в память целиком, read() отдает
+// плоскости записи без копирования. Параметры и vesselness текущей записи
+// доступны через record() и vesselness() до следующего read()/rewind()
+class FrangiRecordingSource : public FrangiFrameSource
+{
+public:
+    bool open(const QString &path);
+
+    bool read(FrangiFrameView *frame) override;
+    bool rewind() override { m_index = 0; m_current = nullptr; return true; }
+    double frameRate() const override { return m_header.frameRate; }
+
+    const FrangiRecordingHeader &header() const { return m_header; }
+    quint64 recordCount() const { return m_header.recordCount; }
+    const FrangiRecordHeader *record() const { return reinterpret_cast<const FrangiRecordHeader *>(m_current); }
+    // Записанная vesselness текущего кадра или nullptr
+    const float *vesselness() const;
+
+private:
+    QFile m_file;
+    const uchar *m_data = nullptr;
+    FrangiRecordingHeader m_header;
+    quint64 m_index = 0;
+    const uchar *m_current = nullptr;
+};
+
+#endif // FRANGIRECORDING_H
@@ -0,0 +1,292 @@
+#include "frangireference.h"
+#include "frangigaussian.h"
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Отступ от краев кадра для сечений: blur, Sobel и Hessian вместе с запасом
+const int kCenterlineMargin = 16;
+
+FrangiPhantom makePhantom(const QString &name, int size, const QVector<FrangiPhantomTube> &tubes,
+                          double noise)
+{
+    FrangiPhantom phantom;
+    phantom.name = name;
+    phantom.tubes = tubes;
+    phantom.image = QImage(size, size, QImage::Format_RGB888);
+    
+    // Профиль усредняется по 4x4 подвыборкам пикселя, симметричным
+    // относительно центра пикселя, чтобы ось через центр пикселя давала
+    // симметричное сечение
+    const int samples = 4;
+    quint32 seed = 2024;
+    for (int y = 0; y < size; ++y) {
+        uchar *line = phantom.image.scanLine(y);
+        for (int x = 0; x < size; ++x) {
+            double value = 0.0;
+            for (int sy = 0; sy < samples; ++sy) {
+                for (int sx = 0; sx < samples; ++sx) {
+                    const double px = x + (sx + 0.5) / samples;
+                    const double py = y + (sy + 0.5) / samples;
+                    double sample = 0.8;
+                    for (const FrangiPhantomTube &tube : tubes) {
+                        const double distance = std::abs(-(px - tube.center.x()) * std::sin(tube.angle) +
+                                                         (py - tube.center.y()) * std::cos(tube.angle));
+                        if (distance < tube.radius) {
+                            const double t = distance / tube.radius;
+                            sample -= tube.contrast * std::sqrt(1.0 - t * t);
+                        }
+                    }
+                    value += sample;
+                }
+            }
+            value /= samples * samples;
+            if (noise > 0.0) {
+                seed = seed * 1664525u + 1013904223u;
+                value += noise * ((seed >> 8) / double(1 << 24) * 2.0 - 1.0);
+            }
+            const uchar gray = uchar(qBound(0, qRound(value * 255.0), 255));
+            line[3 * x + 0] = gray;
+            line[3 * x + 1] = gray;
+            line[3 * x + 2] = gray;
+        }
+    }
+    return phantom;
+}
+
+FrangiPhantomTube tube(double x, double y, double angle, double radius, double contrast)
+{
+    FrangiPhantomTube result;
+    result.center = QPointF(x, y);
+    result.angle = angle;
+    result.radius = radius;
+    result.contrast = contrast;
+    return result;
+}
+
+// Плоскость double с clamp к краю, как GL_CLAMP_TO_EDGE
+struct Plane
+{
+    Plane(int w, int h) : width(w), height(h), data(w * h, 0.0) {}
+    double at(int x, int y) const
+    {
+        return data[qBound(0, y, height - 1) * width + qBound(0, x, width - 1)];
+    }
+    double &operator()(int x, int y) { return data[y * width + x]; }
+    
+    int width;
+    int height;
+    QVector<double> data;
+};
+
+} // namespace
+
+QVector<FrangiPhantom> frangiStandardPhantoms(int size)
+{
+    QVector<FrangiPhantom> phantoms;
+    const double half = size / 2 + 0.5;
+    const double radii[] = { 1.0, 1.5, 2.0, 2.5 };
+    
+    // Оси проходят через центры пикселей
+    QVector<FrangiPhantomTube> horizontal;
+    QVector<FrangiPhantomTube> vertical;
+    for (int i = 0; i < 4; ++i) {
+        const double position = size * (i + 1) / 5 + 0.5;
+        horizontal.append(tube(half, position, 0.0, radii[i], 0.3));
+        vertical.append(tube(position, half, M_PI / 2.0, radii[i], 0.3));
+    }
+    phantoms.append(makePhantom("horizontal", size, horizontal, 0.0));
+    phantoms.append(makePhantom("vertical", size, vertical, 0.0));
+    
+    QVector<FrangiPhantomTube> diagonal;
+    for (int i = -1; i <= 1; ++i) {
+        diagonal.append(tube(half + i * (size / 4), half, M_PI / 4.0, radii[i + 2], 0.3));
+    }
+    phantoms.append(makePhantom("diagonal", size, diagonal, 0.0));
+    
+    QVector<FrangiPhantomTube> lowContrast;
+    lowContrast.append(tube(half, size / 3 + 0.5, 0.0, 1.5, 0.05));
+    lowContrast.append(tube(size / 3 + 0.5, half, M_PI / 2.0, 2.0, 0.05));
+    phantoms.append(makePhantom("low-contrast", size, lowContrast, 0.02));
+    
+    return phantoms;
+}
+
+QVector<double> frangiReferenceVesselness(const QImage &image, const FrangiReferenceParams &params)
+{
+    const QImage rgb = image.convertToFormat(QImage::Format_RGB888);
+    const int width = rgb.width();
+    const int height = rgb.height();
+    if (width == 0 || height == 0) return QVector<double>();
+    
+    // Stage 0-1: Grayscale + Invert
+    Plane gray(width, height);
+    for (int y = 0; y < height; ++y) {
+        const uchar *line = rgb.constScanLine(y);
+        for (int x = 0; x < width; ++x) {
+            const double value = (0.299 * line[3 * x] + 0.587 * line[3 * x + 1] + 0.114 * line[3 * x + 2]) / 255.0;
+            gray(x, y) = params.invert ? 1.0 - value : value;
+        }
+    }
+    
+    // Stage 2: Gaussian, радиус ядра как у конвейеров
+    const int radius = frangiGaussianRadius(float(params.sigma));
+    QVector<double> weights(2 * radius + 1);
+    double totalWeight = 0.0;
+    for (int i = -radius; i <= radius; ++i) {
+        weights[i + radius] = std::exp(-double(i * i) / (2.0 * params.sigma * params.sigma));
+        totalWeight += weights[i + radius];
+    }
+    for (double &weight : weights) {
+        weight /= totalWeight;
+    }
+    
+    Plane blurX(width, height);
+    Plane blurY(width, height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            double sum = 0.0;
+            for (int i = -radius; i <= radius; ++i) {
+                sum += weights[i + radius] * gray.at(x + i, y);
+            }
+            blurX(x, y) = sum;
+        }
+    }
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            double sum = 0.0;
+            for (int i = -radius; i <= radius; ++i) {
+                sum += weights[i + radius] * blurX.at(x, y + i);
+            }
+            blurY(x, y) = sum;
+        }
+    }
+    
+    // Stage 3: Sobel / 8. "Вверх" - предыдущая строка (в GL кадр зеркалирован)
+    Plane gx(width, height);
+    Plane gy(width, height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const double left = blurY.at(x - 1, y - 1) + 2.0 * blurY.at(x - 1, y) + blurY.at(x - 1, y + 1);
+            const double right = blurY.at(x + 1, y - 1) + 2.0 * blurY.at(x + 1, y) + blurY.at(x + 1, y + 1);
+            const double top = blurY.at(x - 1, y - 1) + 2.0 * blurY.at(x, y - 1) + blurY.at(x + 1, y - 1);
+            const double bottom = blurY.at(x - 1, y + 1) + 2.0 * blurY.at(x, y + 1) + blurY.at(x + 1, y + 1);
+            gx(x, y) = (right - left) / 8.0;
+            gy(x, y) = (top - bottom) / 8.0;
+        }
+    }
+    
+    // Stage 4-6: Hessian, собственные значения, vesselness
+    const double scale = width / 4.0;
+    const double eps = 1e-6;
+    QVector<double> result(width * height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const double fxx = (gx.at(x + 2, y) - gx.at(x - 2, y)) * scale;
+            const double fyy = (gy.at(x, y - 2) - gy.at(x, y + 2)) * scale;
+            const double fxy = (gx.at(x, y - 2) - gx.at(x, y + 2)) * scale;
+            
+            const double trace = fxx + fyy;
+            const double det = fxx * fyy - fxy * fxy;
+            const double sqrtDisc = std::sqrt(qMax(trace * trace - 4.0 * det, 0.0));
+            double lambda1 = 0.5 * (trace + sqrtDisc);
+            double lambda2 = 0.5 * (trace - sqrtDisc);
+            if (std::abs(lambda2) < std::abs(lambda1)) {
+                std::swap(lambda1, lambda2);
+            }
+            
+            double vesselness = 0.0;
+            if (lambda2 < 0.0) {
+                const double rb = lambda1 / (lambda2 + eps);
+                const double s2 = lambda1 * lambda1 + lambda2 * lambda2;
+                vesselness = std::exp(-rb * rb / (params.beta * params.beta)) *
+                             (1.0 - std::exp(-s2 / (params.c * params.c)));
+            }
+            result[y * width + x] = vesselness;
+        }
+    }
+    return result;
+}
+
+double frangiCenterlineOffset(const QVector<double> &vesselness, const FrangiPhantom &phantom)
+{
+    const int width = phantom.image.width();
+    const int height = phantom.image.height();
+    if (vesselness.size() != width * height) return std::numeric_limits<double>::infinity();
+    
+    double worst = 0.0;
+    for (const FrangiPhantomTube &tube : phantom.tubes) {
+        const double dx = std::cos(tube.angle);
+        const double dy = std::sin(tube.angle);
+        const double reach = tube.radius + 3.0;
+        
+        double offsetSum = 0.0;
+        int sections = 0;
+        const int length = width + height;
+        for (int s = -length; s <= length; ++s) {
+            const double cx = tube.center.x() + s * dx;
+            const double cy = tube.center.y() + s * dy;
+            if (cx < kCenterlineMargin || cy < kCenterlineMargin ||
+                cx > width - kCenterlineMargin || cy > height - kCenterlineMargin) {
+                continue;
+            }
+            
+            // Сечения рядом с другими трубками не показательны
+            bool crossing = false;
+            for (const FrangiPhantomTube &other : phantom.tubes) {
+                if (&other == &tube) continue;
+                const double distance = std::abs(-(cx - other.center.x()) * std::sin(other.angle) +
+                                                 (cy - other.center.y()) * std::cos(other.angle));
+                crossing = crossing || distance < reach + other.radius + 8.0;
+            }
+            if (crossing) continue;
+            
+            // Пик vesselness по пикселям поперек оси
+            double best = -1.0;
+            double bestOffset = 0.0;
+            for (double o = -reach; o <= reach; o += 0.5) {
+                const int x = int(std::floor(cx - o * dy));
+                const int y = int(std::floor(cy + o * dx));
+                const double value = vesselness[y * width + x];
+                if (value > best) {
+                    best = value;
+                    bestOffset = std::abs(-(x + 0.5 - tube.center.x()) * dy + (y + 0.5 - tube.center.y()) * dx);
+                }
+            }
+            offsetSum += bestOffset;
+            ++sections;
+        }
+        if (sections > 0) {
+            worst = qMax(worst, offsetSum / sections);
+        }
+    }
+    return worst;
+}
+
+FrangiReferenceError frangiCompareVesselness(const QVector<float> &vesselness,
+                                             const QVector<double> &reference,
+                                             const FrangiPhantom &phantom)
+{
+    FrangiReferenceError error;
+    if (vesselness.size() != reference.size() || reference.isEmpty()) {
+        error.maxError = std::numeric_limits<double>::infinity();
+        error.centerlineOffset = std::numeric_limits<double>::infinity();
+        return error;
+    }
+    
+    QVector<double> values(vesselness.size());
+    double squaredSum = 0.0;
+    for (int i = 0; i < vesselness.size(); ++i) {
+        values[i] = vesselness[i];
+        const double difference = std::abs(values[i] - reference[i]);
+        error.maxError = qMax(error.maxError, difference);
+        squaredSum += difference * difference;
+    }
+    const double mse = squaredSum / vesselness.size();
+    error.psnr = mse > 0.0 ? 10.0 * std::log10(1.0 / mse) : std::numeric_limits<double>::infinity();
+    error.centerlineOffset = frangiCenterlineOffset(values, phantom);
+    return error;
+}
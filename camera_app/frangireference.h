@@ -0,0 +1,68 @@
+#ifndef FRANGIREFERENCE_H
+#define FRANGIREFERENCE_H
+
+#include <QImage>
+#include <QPointF>
+#include <QString>
+#include <QVector>
+
+// Эталон для проверки GL и CPU конвейеров: синтетические фантомы сосудов
+// с известными параметрами и реализация single-scale Frangi фильтра в double
+// без оптимизаций (прямая свертка, без SIMD и линейной выборки).
+//
+// Эталон следует спецификации конвейера, а не конкретным шейдерам:
+// grayscale BT.601 -> invert -> Gaussian (радиус ceil(3 sigma), clamp к краю) ->
+// Sobel / 8 -> центральные разности gradient'ов с шагом 2 пикселя по обеим
+// осям (множитель width / 4, как в шейдере hessian) -> собственные значения 2x2 ->
+// vesselness. Для неквадратных кадров шейдеры берут смещение по вертикали
+// в долях ширины, поэтому сравнение с эталоном имеет смысл на квадратных кадрах.
+
+// Прямая трубка: светлый фон, темный профиль цилиндра (contrast * sqrt(1 - d^2 / r^2))
+struct FrangiPhantomTube
+{
+    QPointF center;      // точка на оси в пикселях (центр пикселя - x + 0.5)
+    double angle = 0.0;  // направление оси, радианы (0 - вдоль x)
+    double radius = 1.0;
+    double contrast = 0.3;
+};
+
+struct FrangiPhantom
+{
+    QString name;
+    QImage image;  // RGB888, r = g = b
+    QVector<FrangiPhantomTube> tubes;
+};
+
+struct FrangiReferenceParams
+{
+    double sigma = 1.5;
+    double beta = 0.5;
+    double c = 15.0;
+    bool invert = true;
+};
+
+// Сравнение карты vesselness конвейера с эталоном
+struct FrangiReferenceError
+{
+    double maxError = 0.0;
+    double psnr = 0.0;             // дБ, пик 1.0 (vesselness в [0, 1])
+    double centerlineOffset = 0.0; // максимум по трубкам среднего смещения пика от оси, пиксели
+};
+
+// Набор фантомов size x size: горизонтальные, вертикальные и диагональные
+// трубки радиусом 1-4 пикселя, низкоконтрастные трубки с детерминированным шумом
+QVector<FrangiPhantom> frangiStandardPhantoms(int size = 256);
+
+// Vesselness в double, width*height значений, строки сверху вниз
+QVector<double> frangiReferenceVesselness(const QImage &image, const FrangiReferenceParams &params);
+
+// Ошибка vesselness относительно эталона. Смещение пика считается по сечениям
+// поперек каждой трубки вдали от краев кадра и пересечений с другими трубками
+FrangiReferenceError frangiCompareVesselness(const QVector<float> &vesselness,
+                                             const QVector<double> &reference,
+                                             const FrangiPhantom &phantom);
+
+// Смещение пика vesselness от оси трубок для карты (в том числе для самого эталона)
+double frangiCenterlineOffset(const QVector<double> &vesselness, const FrangiPhantom &phantom);
+
+#endif // FRANGIREFERENCE_H
@@ -0,0 +1,177 @@
+#include "frangischeduler.h"
+#include <QStringList>
+#include <algorithm>
+
+QString FrangiQualityLevel::toString() const
+{
+    QStringList parts;
+    parts << (downscale == 1 ? QString("full res") : QString("1/%1 res").arg(downscale));
+    if (frameInterval > 1) {
+        parts << QString("every %1 frames").arg(frameInterval);
+    }
+    if (scaleCount > 0) {
+        parts << QString("%1 scales").arg(scaleCount);
+    }
+    return parts.join(", ");
+}
+
+FrangiLatencyScheduler::FrangiLatencyScheduler()
+    : m_enabled(false)
+    , m_budget(33.0)
+    , m_scaleCount(0)
+    , m_level(0)
+    , m_levelSamples(0)
+    , m_upgradeWindow(kWindow)
+    , m_probing(false)
+    , m_frameCounter(0)
+    , m_processedFrames(0)
+    , m_skippedFrames(0)
+    , m_downgrades(0)
+    , m_upgrades(0)
+{
+    buildLevels();
+}
+
+void FrangiLatencyScheduler::setEnabled(bool enabled)
+{
+    if (enabled == m_enabled) return;
+    m_enabled = enabled;
+    m_upgradeWindow = kWindow;
+    m_probing = false;
+    setLevel(0);
+}
+
+void FrangiLatencyScheduler::setBudget(double milliseconds)
+{
+    m_budget = qMax(1.0, milliseconds);
+    m_samples.clear();
+}
+
+void FrangiLatencyScheduler::setScaleCount(int count)
+{
+    count = count > 1 ? count : 0;
+    if (count == m_scaleCount) return;
+    m_scaleCount = count;
+    buildLevels();
+    setLevel(0);
+}
+
+void FrangiLatencyScheduler::buildLevels()
+{
+    // Сначала то, что меньше всего заметно: масштабы, затем разрешение, и
+    // только потом частота кадров
+    const int fewerScales = m_scaleCount > 2 ? (m_scaleCount + 1) / 2 : m_scaleCount;
+    m_levels.clear();
+    FrangiQualityLevel level;
+    level.scaleCount = m_scaleCount;
+    m_levels.append(level);
+    level.scaleCount = fewerScales;
+    if (fewerScales != m_scaleCount) {
+        m_levels.append(level);
+    }
+    level.downscale = 2;
+    m_levels.append(level);
+    level.downscale = 3;
+    m_levels.append(level);
+    level.frameInterval = 2;
+    m_levels.append(level);
+    level.frameInterval = 3;
+    m_levels.append(level);
+}
+
+double FrangiLatencyScheduler::cost(int level) const
+{
+    const FrangiQualityLevel &quality = m_levels[level];
+    double value = 1.0 / (quality.downscale * quality.downscale);
+    if (m_scaleCount > 0) {
+        value *= double(quality.scaleCount) / m_scaleCount;
+    }
+    // Пропуск кадров снимает нагрузку, а не работу над самим кадром:
+    // оценка для очереди GPU, которая не успевает за потоком
+    return value / quality.frameInterval;
+}
+
+void FrangiLatencyScheduler::setLevel(int level)
+{
+    m_level = qBound(0, level, int(m_levels.size()) - 1);
+    m_samples.clear();
+    m_levelSamples = 0;
+    m_frameCounter = 0;
+}
+
+bool FrangiLatencyScheduler::acceptFrame()
+{
+    const int interval = m_enabled ? quality().frameInterval : 1;
+    if (m_frameCounter++ % interval != 0) {
+        ++m_skippedFrames;
+        return false;
+    }
+    ++m_processedFrames;
+    return true;
+}
+
+bool FrangiLatencyScheduler::addLatency(double milliseconds)
+{
+    if (m_samples.size() == kWindow) {
+        m_samples.removeFirst();
+    }
+    m_samples.append(milliseconds);
+    ++m_levelSamples;
+    if (!m_enabled || m_samples.size() < kMinSamples) return false;
+    
+    // Понижение: первый уровень, который по оценке укладывается в бюджет
+    const double p90 = percentile(0.9);
+    if (p90 > m_budget && m_level + 1 < m_levels.size()) {
+        int level = m_level + 1;
+        while (level + 1 < m_levels.size() && p90 * cost(level) / cost(m_level) > m_budget) {
+            ++level;
+        }
+        if (m_probing) {
+            m_upgradeWindow = qMin(2 * m_upgradeWindow, kMaxUpgradeWindow);
+            m_probing = false;
+        }
+        setLevel(level);
+        ++m_downgrades;
+        return true;
+    }
+    
+    // Проба продержалась окно: следующая - снова через kWindow кадров
+    if (m_probing && m_levelSamples >= kWindow) {
+        m_probing = false;
+        m_upgradeWindow = kWindow;
+    }
+    
+    // Повышение на один уровень после окна с запасом
+    if (m_level > 0 && !m_probing && m_levelSamples >= m_upgradeWindow && p90 < m_budget * kHeadroom) {
+        setLevel(m_level - 1);
+        m_probing = true;
+        ++m_upgrades;
+        return true;
+    }
+    return false;
+}
+
+double FrangiLatencyScheduler::percentile(double fraction) const
+{
+    if (m_samples.isEmpty()) return 0.0;
+    QVector<double> sorted = m_samples;
+    const int index = qMin(int(sorted.size()) - 1, int(fraction * sorted.size()));
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted[index];
+}
+
+FrangiLatencyScheduler::Metrics FrangiLatencyScheduler::metrics() const
+{
+    Metrics metrics;
+    metrics.enabled = m_enabled;
+    metrics.budget = m_budget;
+    metrics.level = m_level;
+    metrics.quality = quality();
+    metrics.latencyP50 = percentile(0.5);
+    metrics.latencyP90 = percentile(0.9);
+    metrics.processedFrames = m_processedFrames;
+    metrics.skippedFrames = m_skippedFrames;
+    metrics.downgrades = m_downgrades;
+    metrics.upgrades = m_upgrades;
+    return metrics;
+}
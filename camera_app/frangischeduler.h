@@ -0,0 +1,100 @@
+#ifndef FRANGISCHEDULER_H
+#define FRANGISCHEDULER_H
+
+#include <QString>
+#include <QVector>
+
+// Уровень качества обработки живого потока: чем больше номер уровня, тем
+// дешевле кадр
+struct FrangiQualityLevel
+{
+    int downscale = 1;      // уменьшение кадра перед конвейером
+    int frameInterval = 1;  // обрабатывается каждый frameInterval-й кадр
+    int scaleCount = 0;     // число масштабов multi-scale, 0 - все
+
+    // "1/2 res, every 2nd frame, 3 scales"
+    QString toString() const;
+};
+
+// Планировщик под бюджет задержки кадра. По задержке обработанных кадров
+// (от прихода кадра в поток захвата до показа) выбирает уровень из лестницы:
+// меньше масштабов multi-scale, уменьшение кадра в 2 и 3 раза, затем пропуск
+// каждого второго и двух из трех кадров. Уровень понижается, как только p90
+// окна из kMinSamples кадров выходит за бюджет, сразу на уровень, который по
+// оценке стоимости (доля пикселей и масштабов на кадр) в него укладывается;
+// накладные расходы оценка не учитывает, недостаток догоняет следующее окно.
+// Повышение - проба на один уровень, когда p90 окна из kWindow кадров ниже
+// kHeadroom бюджета. Проба, после которой уровень сразу пришлось понизить,
+// удваивает окно до следующей пробы (до kMaxUpgradeWindow), поэтому уровень
+// не качается между двумя соседними.
+class FrangiLatencyScheduler
+{
+public:
+    struct Metrics
+    {
+        bool enabled = false;
+        double budget = 0.0;
+        int level = 0;
+        FrangiQualityLevel quality;
+        // Задержка кадров окна текущего уровня, мс
+        double latencyP50 = 0.0;
+        double latencyP90 = 0.0;
+        quint64 processedFrames = 0;
+        quint64 skippedFrames = 0;
+        quint64 downgrades = 0;
+        quint64 upgrades = 0;
+    };
+
+    FrangiLatencyScheduler();
+
+    // Выключенный планировщик держит уровень 0 и не пропускает кадры
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+    void setBudget(double milliseconds);
+    double budget() const { return m_budget; }
+    // Число масштабов multi-scale (0 или 1 - single-scale): лестница
+    // перестраивается, уровень сбрасывается в 0
+    void setScaleCount(int count);
+
+    // Для каждого нового кадра до загрузки: false - кадр пропускается
+    bool acceptFrame();
+    // Задержка обработанного кадра, мс. true - уровень изменился
+    bool addLatency(double milliseconds);
+
+    int level() const { return m_level; }
+    int levelCount() const { return int(m_levels.size()); }
+    const FrangiQualityLevel &quality() const { return m_levels[m_level]; }
+    Metrics metrics() const;
+
+    static const int kMinSamples = 8;
+    static const int kWindow = 30;
+    static const int kMaxUpgradeWindow = 16 * kWindow;
+
+private:
+    void buildLevels();
+    double cost(int level) const;
+    void setLevel(int level);
+    double percentile(double fraction) const;
+
+    static constexpr double kHeadroom = 0.7;
+
+    bool m_enabled;
+    double m_budget;
+    int m_scaleCount;
+    QVector<FrangiQualityLevel> m_levels;
+    int m_level;
+    // Задержки с последней смены уровня (не больше kWindow последних) и их число
+    QVector<double> m_samples;
+    int m_levelSamples;
+    // Кадров без выхода за бюджет до следующей пробы; m_probing - уровень
+    // повышен пробой, которая еще не продержалась kWindow кадров
+    int m_upgradeWindow;
+    bool m_probing;
+    quint64 m_frameCounter;
+    quint64 m_processedFrames;
+    quint64 m_skippedFrames;
+    quint64 m_downgrades;
+    quint64 m_upgrades;
+};
+
+#endif // FRANGISCHEDULER_H
@@ -0,0 +1,114 @@
+#include "frangishadermanager.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QOpenGLContext>
+
+FrangiShaderManager::FrangiShaderManager()
+    : m_vertexShader(nullptr)
+    , m_binaryCache(false)
+    , m_buildTime(0.0)
+{
+}
+
+FrangiShaderManager::~FrangiShaderManager()
+{
+    // Контекст, в котором создавались программы, должен быть текущим
+    qDeleteAll(m_programs);
+    delete m_vertexShader;
+}
+
+void FrangiShaderManager::initialize(const QString &vertexSource)
+{
+    initializeOpenGLFunctions();
+    m_vertexSource = vertexSource;
+    
+    // Те же условия, при которых Qt использует кэш программ на диске
+    const QOpenGLContext *context = QOpenGLContext::currentContext();
+    const QPair<int, int> version = context->format().version();
+    m_binaryCache = !QCoreApplication::testAttribute(Qt::AA_DisableShaderDiskCache) &&
+                    qEnvironmentVariableIsEmpty("QT_DISABLE_SHADER_DISK_CACHE") &&
+                    (context->isOpenGLES() ? version >= qMakePair(3, 0)
+                                           : version >= qMakePair(4, 1) || context->hasExtension("GL_ARB_get_program_binary"));
+    if (m_binaryCache) {
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        m_binaryCache = formats > 0;
+    }
+    
+    // Без кэша vertex шейдер компилируется один раз на все программы
+    if (!m_binaryCache) {
+        m_vertexShader = new QOpenGLShader(QOpenGLShader::Vertex);
+        if (!m_vertexShader->compileSourceCode(vertexSource)) {
+            qDebug() << "FrangiShaderManager: vertex shader compile error:" << m_vertexShader->log();
+        }
+    }
+}
+
+QOpenGLShaderProgram *FrangiShaderManager::createProgram(const char *name, const QString &fragmentSource)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QOpenGLShaderProgram *program = new QOpenGLShaderProgram();
+    if (m_binaryCache) {
+        // Кэш работает, только если все шейдеры программы добавлены так
+        program->addCacheableShaderFromSourceCode(QOpenGLShader::Vertex, m_vertexSource);
+        program->addCacheableShaderFromSourceCode(QOpenGLShader::Fragment, fragmentSource);
+    } else {
+        program->addShader(m_vertexShader);
+        program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentSource);
+    }
+    link(name, program);
+    m_buildTime += timer.nsecsElapsed() / 1e6;
+    return program;
+}
+
+QOpenGLShaderProgram *FrangiShaderManager::createComputeProgram(const char *name, const QString &computeSource)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QOpenGLShaderProgram *program = new QOpenGLShaderProgram();
+    if (m_binaryCache) {
+        program->addCacheableShaderFromSourceCode(QOpenGLShader::Compute, computeSource);
+    } else {
+        program->addShaderFromSourceCode(QOpenGLShader::Compute, computeSource);
+    }
+    link(name, program);
+    m_buildTime += timer.nsecsElapsed() / 1e6;
+    return program;
+}
+
+void FrangiShaderManager::link(const char *name, QOpenGLShaderProgram *program)
+{
+    if (!program->link()) {
+        qDebug() << "FrangiShaderManager:" << name << "shader link error:" << program->log();
+    }
+    m_programs.append(program);
+}
+
+void FrangiShaderManager::destroyProgram(QOpenGLShaderProgram *program)
+{
+    if (!program) return;
+    
+    // Новая программа может получить тот же адрес
+    for (auto it = m_uniforms.begin(); it != m_uniforms.end(); ) {
+        if (it.key().first == program) {
+            it = m_uniforms.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    m_programs.removeOne(program);
+    delete program;
+}
+
+int FrangiShaderManager::uniformLocation(QOpenGLShaderProgram *program, const char *name)
+{
+    const QPair<const QOpenGLShaderProgram *, const char *> key(program, name);
+    auto it = m_uniforms.constFind(key);
+    if (it != m_uniforms.constEnd()) return it.value();
+    
+    const int location = program->uniformLocation(name);
+    m_uniforms.insert(key, location);
+    return location;
+}
@@ -0,0 +1,55 @@
+#ifndef FRANGISHADERMANAGER_H
+#define FRANGISHADERMANAGER_H
+
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QHash>
+#include <QPair>
+#include <QVector>
+
+// Программы конвейера с общим vertex шейдером.
+// Если драйвер отдает бинарники программ (GL 4.1+ или GL_ARB_get_program_binary,
+// GLES 3), программы собираются через addCacheableShaderFromSourceCode():
+// Qt хранит слинкованные программы на диске (QStandardPaths::CacheLocation)
+// с ключом по хешу исходников и проверкой GL_VENDOR/RENDERER/VERSION, и со
+// второго запуска программы загружаются без компиляции. Иначе общий vertex
+// шейдер компилируется один раз и подключается ко всем программам.
+// Кэш на диске отключается Qt::AA_DisableShaderDiskCache или
+// QT_DISABLE_SHADER_DISK_CACHE. Все методы требуют текущего контекста.
+class FrangiShaderManager : protected QOpenGLExtraFunctions
+{
+public:
+    FrangiShaderManager();
+    // Удаляет все программы
+    ~FrangiShaderManager();
+
+    void initialize(const QString &vertexSource);
+
+    // Программа из общего vertex и fragment шейдера (владеет менеджер).
+    // Ошибка сборки печатается с name, программа остается неслинкованной
+    QOpenGLShaderProgram *createProgram(const char *name, const QString &fragmentSource);
+    QOpenGLShaderProgram *createComputeProgram(const char *name, const QString &computeSource);
+    // Удаляет программу (nullptr игнорируется) и ее uniform'ы из кэша
+    void destroyProgram(QOpenGLShaderProgram *program);
+
+    // Место uniform'а по имени без glGetUniformLocation после первого вызова.
+    // name - строковый литерал: ключ кэша - его адрес
+    int uniformLocation(QOpenGLShaderProgram *program, const char *name);
+
+    bool binaryCacheEnabled() const { return m_binaryCache; }
+    int programCount() const { return m_programs.size(); }
+    // Суммарное время сборки программ, мс
+    double buildTime() const { return m_buildTime; }
+
+private:
+    void link(const char *name, QOpenGLShaderProgram *program);
+
+    QString m_vertexSource;
+    QOpenGLShader *m_vertexShader;
+    bool m_binaryCache;
+    QVector<QOpenGLShaderProgram *> m_programs;
+    QHash<QPair<const QOpenGLShaderProgram *, const char *>, int> m_uniforms;
+    double m_buildTime;
+};
+
+#endif // FRANGISHADERMANAGER_H
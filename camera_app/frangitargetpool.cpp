@@ -0,0 +1,112 @@
+#include "frangitargetpool.h"
+
+FrangiTargetPool::FrangiTargetPool()
+    : m_frame(0)
+    , m_peakTargetCount(0)
+{
+}
+
+FrangiTargetPool::~FrangiTargetPool()
+{
+    // Контекст, в котором создавались FBO, должен быть текущим
+    clear();
+}
+
+void FrangiTargetPool::initialize()
+{
+    initializeOpenGLFunctions();
+}
+
+QOpenGLFramebufferObject *FrangiTargetPool::acquire(int width, int height, GLenum internalFormat,
+                                                    bool linearFilter)
+{
+    QOpenGLFramebufferObject *target = nullptr;
+    for (Entry &entry : m_entries) {
+        if (!entry.inUse && entry.format == internalFormat &&
+            entry.target->width() == width && entry.target->height() == height) {
+            entry.inUse = true;
+            entry.lastUsedFrame = m_frame;
+            target = entry.target;
+            break;
+        }
+    }
+    
+    if (!target) {
+        QOpenGLFramebufferObjectFormat format;
+        format.setInternalTextureFormat(internalFormat);
+        format.setTextureTarget(GL_TEXTURE_2D);
+        target = new QOpenGLFramebufferObject(width, height, format);
+        
+        Entry entry;
+        entry.target = target;
+        entry.format = internalFormat;
+        entry.inUse = true;
+        entry.lastUsedFrame = m_frame;
+        m_entries.append(entry);
+        m_peakTargetCount = qMax(m_peakTargetCount, int(m_entries.size()));
+    }
+    
+    // Фильтрация - свойство текстуры, а не stage'а: прошлый владелец мог выставить другую
+    const GLint filter = linearFilter ? GL_LINEAR : GL_NEAREST;
+    glBindTexture(GL_TEXTURE_2D, target->texture());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return target;
+}
+
+void FrangiTargetPool::release(QOpenGLFramebufferObject *target)
+{
+    if (!target) return;
+    for (Entry &entry : m_entries) {
+        if (entry.target == target) {
+            entry.inUse = false;
+            entry.lastUsedFrame = m_frame;
+            return;
+        }
+    }
+}
+
+void FrangiTargetPool::beginFrame()
+{
+    ++m_frame;
+    for (int i = m_entries.size() - 1; i >= 0; --i) {
+        const Entry &entry = m_entries[i];
+        if (!entry.inUse && m_frame - entry.lastUsedFrame > quint64(kIdleFrames)) {
+            delete entry.target;
+            m_entries.remove(i);
+        }
+    }
+}
+
+void FrangiTargetPool::clear()
+{
+    for (const Entry &entry : m_entries) {
+        delete entry.target;
+    }
+    m_entries.clear();
+}
+
+qint64 FrangiTargetPool::allocatedBytes() const
+{
+    qint64 bytes = 0;
+    for (const Entry &entry : m_entries) {
+        bytes += qint64(entry.target->width()) * entry.target->height() * bytesPerPixel(entry.format);
+    }
+    return bytes;
+}
+
+int FrangiTargetPool::bytesPerPixel(GLenum internalFormat)
+{
+    switch (internalFormat) {
+        case GL_R8: return 1;
+        case GL_R16F: return 2;
+        case GL_R32F: return 4;
+        case GL_RG16F: return 4;
+        case GL_RG32F: return 8;
+        case GL_RGBA16F: return 8;
+        case GL_RGBA32F: return 16;
+        case GL_RGBA8:
+        default: return 4;
+    }
+}
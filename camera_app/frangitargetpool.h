@@ -0,0 +1,54 @@
+#ifndef FRANGITARGETPOOL_H
+#define FRANGITARGETPOOL_H
+
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFramebufferObject>
+#include <QVector>
+
+// Пул render target'ов конвейера по формату и размеру.
+// Stage'и берут FBO на время жизни своего результата и возвращают его после
+// последнего читателя, поэтому stage'и с непересекающимися временами жизни
+// делят одну текстуру (gray -> blur X -> vesselness и т.д.).
+// Свободные FBO, не нужные дольше kIdleFrames кадров (например, после смены
+// отображаемого stage'а), удаляются. Все методы требуют текущего контекста.
+class FrangiTargetPool : protected QOpenGLExtraFunctions
+{
+public:
+    FrangiTargetPool();
+    ~FrangiTargetPool();
+
+    void initialize();
+
+    // Свободный FBO с подходящими форматом и размером или новый.
+    // linearFilter - GL_LINEAR вместо GL_NEAREST для выборки текстуры
+    QOpenGLFramebufferObject *acquire(int width, int height, GLenum internalFormat,
+                                      bool linearFilter = false);
+    void release(QOpenGLFramebufferObject *target);
+
+    // Новый кадр: удаляет FBO, свободные дольше kIdleFrames кадров
+    void beginFrame();
+    // Удаляет все FBO, в том числе выданные (при смене размера или точности)
+    void clear();
+
+    int targetCount() const { return m_entries.size(); }
+    int peakTargetCount() const { return m_peakTargetCount; }
+    qint64 allocatedBytes() const;
+
+private:
+    struct Entry {
+        QOpenGLFramebufferObject *target;
+        GLenum format;
+        bool inUse;
+        quint64 lastUsedFrame;
+    };
+
+    static int bytesPerPixel(GLenum internalFormat);
+
+    static const int kIdleFrames = 30;
+
+    QVector<Entry> m_entries;
+    quint64 m_frame;
+    int m_peakTargetCount;
+};
+
+#endif // FRANGITARGETPOOL_H
@@ -0,0 +1,153 @@
+#include "frangitemporal.h"
+#include <cmath>
+
+namespace {
+
+// SAD блока со сдвигом (dx, dy): count x count пикселей с шагом step от origin,
+// строки снизу вверх, выход за кадр - краевой пиксель
+float blockSad(const float *luma, const float *previous, int width, int height,
+               int originX, int originY, int count, int step, int dx, int dy)
+{
+    float sum = 0.0f;
+    for (int y = 0; y < count; ++y) {
+        for (int x = 0; x < count; ++x) {
+            const int qx = qMin(originX + x * step, width - 1);
+            const int qy = qMin(originY + y * step, height - 1);
+            const int px = qBound(0, qx + dx, width - 1);
+            const int py = qBound(0, qy + dy, height - 1);
+            sum += std::abs(luma[qy * width + qx] - previous[py * width + px]);
+        }
+    }
+    return sum / float(count * count);
+}
+
+} // namespace
+
+void frangiTemporalLumaRows(const float *gray, int stride, int width, int height, bool inverted,
+                            float *luma, int begin, int end)
+{
+    for (int r = begin; r < end; ++r) {
+        const float *row = gray + (height - 1 - r) * stride;
+        for (int x = 0; x < width; ++x) {
+            luma[r * width + x] = inverted ? 1.0f - row[x] : row[x];
+        }
+    }
+}
+
+void frangiTemporalDownsampleRows(const float *luma, int width, int height, float *coarse, int begin, int end)
+{
+    const int coarseWidth = frangiTemporalLumaSize(width);
+    for (int r = begin; r < end; ++r) {
+        for (int cx = 0; cx < coarseWidth; ++cx) {
+            // Краевой повтор, как texelFetch с clamp
+            float sum = 0.0f;
+            for (int dy = 0; dy < kFrangiTemporalScale; ++dy) {
+                const float *row = luma + qMin(r * kFrangiTemporalScale + dy, height - 1) * width;
+                for (int dx = 0; dx < kFrangiTemporalScale; ++dx) {
+                    sum += row[qMin(cx * kFrangiTemporalScale + dx, width - 1)];
+                }
+            }
+            coarse[r * coarseWidth + cx] = sum / float(kFrangiTemporalScale * kFrangiTemporalScale);
+        }
+    }
+}
+
+void frangiTemporalMotionRows(const float *luma, const float *previousLuma, const float *coarse,
+                              const float *previousCoarse, int width, int height, float *motion,
+                              int begin, int end, const FrangiTemporalParams &params)
+{
+    const int coarseWidth = frangiTemporalLumaSize(width);
+    const int coarseHeight = frangiTemporalLumaSize(height);
+    const int blocksX = frangiTemporalBlockCount(width);
+    const int refineStep = 2;
+    const int refineCount = kFrangiTemporalBlockPixels / refineStep;
+    for (int by = begin; by < end; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            // Уменьшенный уровень: нулевой сдвиг без штрафа, остальные по строкам, как в шейдере
+            int originX = bx * kFrangiTemporalBlock;
+            int originY = by * kFrangiTemporalBlock;
+            int coarseX = 0;
+            int coarseY = 0;
+            float bestCost = blockSad(coarse, previousCoarse, coarseWidth, coarseHeight, originX, originY,
+                                      kFrangiTemporalBlock, 1, 0, 0);
+            for (int dy = -params.searchRadius; dy <= params.searchRadius; ++dy) {
+                for (int dx = -params.searchRadius; dx <= params.searchRadius; ++dx) {
+                    if (dx == 0 && dy == 0) continue;
+                    const float cost = blockSad(coarse, previousCoarse, coarseWidth, coarseHeight, originX, originY,
+                                                kFrangiTemporalBlock, 1, dx, dy) +
+                                       kFrangiTemporalMotionPenalty * float(qAbs(dx) + qAbs(dy));
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        coarseX = dx;
+                        coarseY = dy;
+                    }
+                }
+            }
+            
+            // Полное разрешение вокруг найденного сдвига
+            originX = bx * kFrangiTemporalBlockPixels;
+            originY = by * kFrangiTemporalBlockPixels;
+            const int centerX = coarseX * kFrangiTemporalScale;
+            const int centerY = coarseY * kFrangiTemporalScale;
+            int bestX = centerX;
+            int bestY = centerY;
+            float bestSad = blockSad(luma, previousLuma, width, height, originX, originY, refineCount, refineStep,
+                                     centerX, centerY);
+            bestCost = bestSad;
+            for (int dy = -kFrangiTemporalRefineRadius; dy <= kFrangiTemporalRefineRadius; ++dy) {
+                for (int dx = -kFrangiTemporalRefineRadius; dx <= kFrangiTemporalRefineRadius; ++dx) {
+                    if (dx == 0 && dy == 0) continue;
+                    const float sad = blockSad(luma, previousLuma, width, height, originX, originY, refineCount,
+                                               refineStep, centerX + dx, centerY + dy);
+                    const float cost = sad + kFrangiTemporalMotionPenalty * float(qAbs(dx) + qAbs(dy));
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestSad = sad;
+                        bestX = centerX + dx;
+                        bestY = centerY + dy;
+                    }
+                }
+            }
+            
+            float *block = motion + 3 * (by * blocksX + bx);
+            block[0] = float(bestX);
+            block[1] = float(bestY);
+            block[2] = bestSad;
+        }
+    }
+}
+
+void frangiTemporalBlendRows(const float *current, const float *history, const float *motion,
+                             int width, int height, float *result, int begin, int end,
+                             const FrangiTemporalParams &params)
+{
+    const int blocksX = frangiTemporalBlockCount(width);
+    for (int y = begin; y < end; ++y) {
+        const int r = height - 1 - y;
+        for (int x = 0; x < width; ++x) {
+            float value = current[y * width + x];
+            if (motion) {
+                const float *block = motion + 3 * ((r / kFrangiTemporalBlockPixels) * blocksX + x / kFrangiTemporalBlockPixels);
+                // Сдвиг вверх кадра - к меньшим строкам сверху вниз
+                const int sx = x + int(block[0]);
+                const int sy = y - int(block[1]);
+                if (block[2] <= params.rejectThreshold && sx >= 0 && sy >= 0 && sx < width && sy < height) {
+                    // История зажимается в диапазон соседей текущего кадра
+                    float low = value;
+                    float high = value;
+                    for (int dy = -1; dy <= 1; ++dy) {
+                        for (int dx = -1; dx <= 1; ++dx) {
+                            const float neighbour = current[qBound(0, y + dy, height - 1) * width +
+                                                            qBound(0, x + dx, width - 1)];
+                            low = qMin(low, neighbour);
+                            high = qMax(high, neighbour);
+                        }
+                    }
+                    const float previous = qBound(low, history[sy * width + sx], high);
+                    value = previous + (value - previous) * params.alpha;
+                }
+            }
+            result[y * width + x] = value;
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef FRANGITEMPORAL_H
+#define FRANGITEMPORAL_H
+
+#include <QtGlobal>
+
+// Temporal stage: экспоненциальное скользящее среднее vesselness по кадрам
+// с компенсацией движения. Шум сенсора между кадрами не коррелирован,
+// поэтому усреднение по времени подавляет мерцание vesselness без роста
+// sigma (и числа taps blur'а):
+//  1. яркость кадра и ее уровень, усредненный блоками kFrangiTemporalScale^2;
+//  2. для каждого блока kFrangiTemporalBlockPixels^2 полного разрешения
+//     полным перебором в пределах searchRadius на уменьшенном уровне ищется
+//     сдвиг к прошлому кадру с минимумом средней |разности| яркости (SAD),
+//     затем он уточняется на полном разрешении в пределах
+//     kFrangiTemporalRefineRadius (по каждому второму пикселю блока).
+//     Небольшой штраф за длину сдвига держит неподвижные однородные блоки
+//     на месте;
+//  3. история сдвигается по движению своего блока, зажимается в диапазон
+//     vesselness 3x3 соседей текущего кадра и смешивается с текущим кадром
+//     с весом alpha. Блок, для которого сдвиг не нашелся (SAD выше
+//     rejectThreshold: окклюзия, смена сцены), и пиксели, история которых
+//     вне кадра, берут текущее значение.
+// Сдвиги целые, поэтому история читается без интерполяции.
+//
+// Функции ниже - CPU версии шейдеров FrangiPipeline для полосы строк
+// [begin, end). Яркость, сдвиги и блоки в них считаются в ориентации GL
+// (строки снизу вверх, сдвиг dy > 0 - вверх кадра), чтобы сетка блоков и
+// результат совпадали с GL, кроме равных с точностью округления SAD.
+
+struct FrangiTemporalParams
+{
+    // Вес текущего кадра: 0.25 - шум vesselness падает примерно в 2.6 раза
+    float alpha = 0.25f;
+    // Радиус поиска в пикселях уменьшенной яркости (4 - до 16 пикселей кадра)
+    int searchRadius = 4;
+    // Средняя |разность| яркости блока после сдвига (полное разрешение,
+    // включает шум сенсора), выше - история блока не используется
+    float rejectThreshold = 0.06f;
+
+    bool operator==(const FrangiTemporalParams &other) const
+    {
+        return alpha == other.alpha && searchRadius == other.searchRadius &&
+               rejectThreshold == other.rejectThreshold;
+    }
+    bool operator!=(const FrangiTemporalParams &other) const { return !(*this == other); }
+};
+
+// Уменьшение яркости для поиска движения и блок в пикселях уменьшенной
+// яркости: блок движения - 16x16 пикселей кадра
+const int kFrangiTemporalScale = 4;
+const int kFrangiTemporalBlock = 4;
+const int kFrangiTemporalBlockPixels = kFrangiTemporalScale * kFrangiTemporalBlock;
+// Уточнение сдвига на полном разрешении: ошибка уменьшенного уровня - до
+// его пикселя
+const int kFrangiTemporalRefineRadius = kFrangiTemporalScale - 1;
+// Штраф SAD за пиксель длины сдвига (|dx| + |dy| уровня поиска)
+const float kFrangiTemporalMotionPenalty = 0.001f;
+
+// Размер уменьшенной яркости и сетки блоков для стороны кадра
+inline int frangiTemporalLumaSize(int size) { return (size + kFrangiTemporalScale - 1) / kFrangiTemporalScale; }
+inline int frangiTemporalBlockCount(int size) { return (size + kFrangiTemporalBlockPixels - 1) / kFrangiTemporalBlockPixels; }
+
+// Яркость строк [begin, end) по grayscale кадра (строки сверху вниз с шагом
+// stride; inverted - плоскость после invert)
+void frangiTemporalLumaRows(const float *gray, int stride, int width, int height, bool inverted,
+                            float *luma, int begin, int end);
+
+// Строки [begin, end) уменьшенного уровня яркости (среднее kFrangiTemporalScale^2)
+void frangiTemporalDownsampleRows(const float *luma, int width, int height, float *coarse, int begin, int end);
+
+// Сдвиги строк блоков [begin, end): на блок три float'а - dx, dy в пикселях
+// кадра (история берется в точке p + (dx, dy)) и SAD найденного сдвига
+void frangiTemporalMotionRows(const float *luma, const float *previousLuma, const float *coarse,
+                              const float *previousCoarse, int width, int height, float *motion,
+                              int begin, int end, const FrangiTemporalParams &params);
+
+// Смешивание строк [begin, end) кадра (сверху вниз) с историей, сдвинутой
+// по motion. motion == nullptr - история сбрасывается текущим кадром
+void frangiTemporalBlendRows(const float *current, const float *history, const float *motion,
+                             int width, int height, float *result, int begin, int end,
+                             const FrangiTemporalParams &params);
+
+#endif // FRANGITEMPORAL_H
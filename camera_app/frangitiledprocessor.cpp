@@ -0,0 +1,223 @@
+#include "frangitiledprocessor.h"
+#include <QDebug>
+#include <cctype>
+#include <climits>
+#include <cstring>
+
+namespace {
+
+const int kDefaultTileSize = 2048;
+
+// Следующее число заголовка PNM: пробелы и комментарии '#' до конца строки пропускаются
+bool readHeaderValue(const uchar *data, qint64 size, qint64 &pos, int &value)
+{
+    while (pos < size) {
+        if (data[pos] == '#') {
+            while (pos < size && data[pos] != '\n') ++pos;
+        } else if (std::isspace(data[pos])) {
+            ++pos;
+        } else {
+            break;
+        }
+    }
+    if (pos >= size || !std::isdigit(data[pos])) return false;
+    
+    qint64 number = 0;
+    while (pos < size && std::isdigit(data[pos])) {
+        number = number * 10 + (data[pos] - '0');
+        if (number > INT_MAX) return false;
+        ++pos;
+    }
+    value = int(number);
+    return true;
+}
+
+} // namespace
+
+FrangiTiledProcessor::FrangiTiledProcessor(FrangiEngine *engine)
+    : m_engine(engine)
+    , m_tileSize(kDefaultTileSize)
+    , m_pixels(nullptr)
+    , m_width(0)
+    , m_height(0)
+    , m_channels(0)
+    , m_maxValue(0)
+    , m_bytesPerSample(1)
+    , m_tileCount(0)
+    , m_apron(0)
+{
+}
+
+bool FrangiTiledProcessor::open(const QString &path)
+{
+    close();
+    
+    m_input.setFileName(path);
+    if (!m_input.open(QIODevice::ReadOnly)) {
+        m_error = QString("Cannot open %1: %2").arg(path, m_input.errorString());
+        return false;
+    }
+    
+    // Страницы файла читаются ОС по мере обращения к тайлам
+    const qint64 size = m_input.size();
+    const uchar *data = m_input.map(0, size);
+    if (!data) {
+        m_error = QString("Cannot map %1: %2").arg(path, m_input.errorString());
+        m_input.close();
+        return false;
+    }
+    if (!parseHeader(data, size)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void FrangiTiledProcessor::close()
+{
+    if (m_input.isOpen()) {
+        m_input.close();  // снимает отображение
+    }
+    m_pixels = nullptr;
+    m_width = 0;
+    m_height = 0;
+    m_tileBuffer.clear();
+}
+
+bool FrangiTiledProcessor::parseHeader(const uchar *data, qint64 size)
+{
+    if (size < 2 || data[0] != 'P' || (data[1] != '5' && data[1] != '6')) {
+        m_error = "Tiled mode expects a binary PGM (P5) or PPM (P6) image";
+        return false;
+    }
+    m_channels = data[1] == '5' ? 1 : 3;
+    
+    qint64 pos = 2;
+    if (!readHeaderValue(data, size, pos, m_width) || !readHeaderValue(data, size, pos, m_height) ||
+        !readHeaderValue(data, size, pos, m_maxValue) || pos >= size ||
+        m_width <= 0 || m_height <= 0 || m_maxValue <= 0 || m_maxValue > 65535) {
+        m_error = "Invalid PNM header";
+        return false;
+    }
+    ++pos;  // один пробельный символ перед растром
+    
+    m_bytesPerSample = m_maxValue > 255 ? 2 : 1;
+    const qint64 rasterSize = qint64(m_width) * m_height * m_channels * m_bytesPerSample;
+    if (size - pos < rasterSize) {
+        m_error = QString("Truncated PNM: %1 of %2 raster bytes").arg(size - pos).arg(rasterSize);
+        return false;
+    }
+    m_pixels = data + pos;
+    return true;
+}
+
+FrangiFrameView FrangiTiledProcessor::regionView(const QRect &rect)
+{
+    FrangiFrameView view;
+    view.format = FrangiFrameView::FormatRgb24;
+    view.width = rect.width();
+    view.height = rect.height();
+    
+    const qint64 rowBytes = qint64(m_width) * m_channels * m_bytesPerSample;
+    if (m_channels == 3 && m_bytesPerSample == 1 && m_maxValue == 255) {
+        view.planes[0] = m_pixels + rect.y() * rowBytes + rect.x() * 3;
+        view.strides[0] = int(rowBytes);
+        return view;
+    }
+    
+    // Серый и 16-битный растр (big-endian) приводятся к 8-битному RGB
+    m_tileBuffer.resize(rect.width() * rect.height() * 3);
+    uchar *out = reinterpret_cast<uchar *>(m_tileBuffer.data());
+    for (int y = 0; y < rect.height(); ++y) {
+        const uchar *row = m_pixels + (rect.y() + y) * rowBytes + qint64(rect.x()) * m_channels * m_bytesPerSample;
+        uchar *dst = out + y * rect.width() * 3;
+        for (int x = 0; x < rect.width(); ++x) {
+            for (int c = 0; c < 3; ++c) {
+                const uchar *sample = row + (x * m_channels + (m_channels == 3 ? c : 0)) * m_bytesPerSample;
+                const int value = m_bytesPerSample == 2 ? (sample[0] << 8) | sample[1] : sample[0];
+                dst[x * 3 + c] = uchar((value * 255 + m_maxValue / 2) / m_maxValue);
+            }
+        }
+    }
+    view.planes[0] = out;
+    view.strides[0] = rect.width() * 3;
+    return view;
+}
+
+bool FrangiTiledProcessor::process(const QString &outputPath)
+{
+    if (!m_pixels) {
+        m_error = "No input image";
+        return false;
+    }
+    
+    // Поле кратно выравниванию, чтобы уровни пирамиды multi-scale режима
+    // в тайле совпадали с уровнями всего изображения
+    const QSize size = imageSize();
+    const int alignment = m_engine->tileAlignment();
+    m_apron = (m_engine->supportRadius(size) + alignment - 1) / alignment * alignment;
+    const int maxInterior = m_engine->maxFrameSize() - 2 * m_apron;
+    const int interior = qMin(m_tileSize, maxInterior) / alignment * alignment;
+    if (interior <= 0) {
+        m_error = QString("Apron of %1 pixels does not fit the maximum frame size %2")
+                  .arg(m_apron).arg(m_engine->maxFrameSize());
+        return false;
+    }
+    const int tilesX = (m_width + interior - 1) / interior;
+    const int tilesY = (m_height + interior - 1) / interior;
+    m_tileCount = tilesX * tilesY;
+    
+    // PFM: текстовый заголовок и float'ы, отрицательный масштаб - little-endian
+    const QByteArray header = QString("Pf\n%1 %2\n-1.0\n").arg(m_width).arg(m_height).toLatin1();
+    QFile output(outputPath);
+    if (!output.open(QIODevice::ReadWrite | QIODevice::Truncate) ||
+        !output.resize(header.size() + qint64(m_width) * m_height * sizeof(float))) {
+        m_error = QString("Cannot create %1: %2").arg(outputPath, output.errorString());
+        return false;
+    }
+    uchar *mapped = output.map(0, output.size());
+    if (!mapped) {
+        m_error = QString("Cannot map %1: %2").arg(outputPath, output.errorString());
+        return false;
+    }
+    std::memcpy(mapped, header.constData(), header.size());
+    float *pixels = reinterpret_cast<float *>(mapped + header.size());
+    
+    m_engine->setDerivativeFrameSize(size);
+    
+    bool ok = true;
+    int tile = 0;
+    for (int tileY = 0; tileY < tilesY && ok; ++tileY) {
+        for (int tileX = 0; tileX < tilesX; ++tileX) {
+            const QRect inner(tileX * interior, tileY * interior,
+                              qMin(interior, m_width - tileX * interior),
+                              qMin(interior, m_height - tileY * interior));
+            const QRect outer = inner.adjusted(-m_apron, -m_apron, m_apron, m_apron)
+                                     .intersected(QRect(QPoint(0, 0), size));
+            
+            const FrangiVesselnessMap map = m_engine->process(regionView(outer));
+            if (map.width != outer.width() || map.height != outer.height()) {
+                m_error = QString("Tile %1 was not processed").arg(tile);
+                ok = false;
+                break;
+            }
+            
+            // PFM хранит строки снизу вверх
+            for (int y = inner.top(); y <= inner.bottom(); ++y) {
+                std::memcpy(pixels + qint64(m_height - 1 - y) * m_width + inner.x(),
+                            map.data.constData() + (y - outer.y()) * map.width + (inner.x() - outer.x()),
+                            inner.width() * sizeof(float));
+            }
+            
+            ++tile;
+            if (m_progress) {
+                m_progress(tile, m_tileCount);
+            }
+        }
+    }
+    
+    m_engine->setDerivativeFrameSize(QSize());
+    output.unmap(mapped);
+    output.close();
+    return ok;
+}
@@ -0,0 +1,72 @@
+#ifndef FRANGITILEDPROCESSOR_H
+#define FRANGITILEDPROCESSOR_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QRect>
+#include <QString>
+#include <functional>
+#include "frangiengine.h"
+
+// Обработка изображений больше GL_MAX_TEXTURE_SIZE (мозаики микроскопии).
+// Вход - отображенный в память PGM (P5) или PPM (P6), 8 или 16 бит: в память
+// попадает только текущий тайл. Изображение делится на тайлы с полем
+// FrangiEngine::supportRadius() (~3 sigma + производные) вокруг, каждый тайл
+// обрабатывается FrangiEngine, а его внутренняя часть пишется в отображенный
+// PFM. Производные считаются в масштабе всего изображения
+// (setDerivativeFrameSize()), поэтому швов нет и результат совпадает
+// с обработкой изображения целиком.
+class FrangiTiledProcessor
+{
+public:
+    // Вызывается после каждого тайла
+    using ProgressCallback = std::function<void(int tile, int tileCount)>;
+
+    explicit FrangiTiledProcessor(FrangiEngine *engine);
+
+    // Сторона внутренней части тайла (по умолчанию 2048). Уменьшается так,
+    // чтобы тайл с полем помещался в FrangiEngine::maxFrameSize()
+    void setTileSize(int size) { m_tileSize = size; }
+    int tileSize() const { return m_tileSize; }
+    void setProgressCallback(ProgressCallback callback) { m_progress = std::move(callback); }
+
+    // Отображает вход в память и разбирает заголовок PGM/PPM
+    bool open(const QString &path);
+    void close();
+    QSize imageSize() const { return QSize(m_width, m_height); }
+
+    // Обрабатывает все тайлы текущими параметрами движка и пишет vesselness
+    // в PFM (float32 little-endian, строки снизу вверх)
+    bool process(const QString &outputPath);
+
+    // Раскладка последнего process()
+    int tileCount() const { return m_tileCount; }
+    int apron() const { return m_apron; }
+
+    QString errorString() const { return m_error; }
+
+private:
+    bool parseHeader(const uchar *data, qint64 size);
+    // Кадр региона изображения: 8-битный PPM - без копирования, остальное -
+    // через RGB24 буфер тайла
+    FrangiFrameView regionView(const QRect &rect);
+
+    FrangiEngine *m_engine;
+    int m_tileSize;
+    ProgressCallback m_progress;
+
+    QFile m_input;
+    const uchar *m_pixels;  // растр в отображенном файле
+    int m_width;
+    int m_height;
+    int m_channels;         // 1 (PGM) или 3 (PPM)
+    int m_maxValue;
+    int m_bytesPerSample;   // 2 при maxval > 255, big-endian
+    QByteArray m_tileBuffer;
+
+    int m_tileCount;
+    int m_apron;
+    QString m_error;
+};
+
+#endif // FRANGITILEDPROCESSOR_H
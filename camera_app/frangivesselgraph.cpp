@@ -0,0 +1,387 @@
+#include "frangivesselgraph.h"
+#include <QtMath>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Сначала 4-соседи: трассировка проходит углы "лесенки", не пропуская пиксели
+const int kDx[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+const int kDy[8] = { -1, 0, 1, 0, -1, 1, 1, -1 };
+
+// Соседи по кругу, начиная с севера (P2..P9 Zhang-Suen)
+const int kRingDx[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+const int kRingDy[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+
+// Список блока чистится от удаленных индексов, когда вырастает до этого размера
+const int kBlockListLimit = 32;
+
+float stepLength(const QPoint &a, const QPoint &b)
+{
+    return (a.x() != b.x() && a.y() != b.y()) ? float(M_SQRT2) : 1.0f;
+}
+
+bool isAdjacent(const QPoint &a, const QPoint &b)
+{
+    return qAbs(a.x() - b.x()) <= 1 && qAbs(a.y() - b.y()) <= 1;
+}
+
+// Длина ломаной по пикселям. Угол "лесенки" (следующий пиксель - сосед
+// предыдущего) пропускается: диагональ считается шагом sqrt(2), а не двумя
+float polylineLength(const QVector<QPoint> &points)
+{
+    float length = 0.0f;
+    int previous = 0;
+    for (int i = 1; i < points.size(); ++i) {
+        if (i + 1 < points.size() && isAdjacent(points[previous], points[i + 1])) continue;
+        length += stepLength(points[previous], points[i]);
+        previous = i;
+    }
+    return length;
+}
+
+} // namespace
+
+FrangiVesselGraph::FrangiVesselGraph()
+    : m_width(0)
+    , m_height(0)
+    , m_blocksX(0)
+    , m_blocksY(0)
+    , m_nodeCount(0)
+    , m_branchCount(0)
+    , m_rebuiltBlocks(0)
+{
+}
+
+void FrangiVesselGraph::clear()
+{
+    m_width = 0;
+    m_height = 0;
+    m_blocksX = 0;
+    m_blocksY = 0;
+    m_skeleton.clear();
+    m_labels.clear();
+    m_nodes.clear();
+    m_branches.clear();
+    m_freeNodes.clear();
+    m_freeBranches.clear();
+    m_nodeCount = 0;
+    m_branchCount = 0;
+    m_blockNodes.clear();
+    m_blockBranches.clear();
+    m_rebuiltBlocks = 0;
+}
+
+float FrangiVesselGraph::totalLength() const
+{
+    float length = 0.0f;
+    for (const FrangiVesselBranch &branch : m_branches) {
+        if (branch.valid) length += branch.length;
+    }
+    return length;
+}
+
+int FrangiVesselGraph::neighbour(int index, int direction) const
+{
+    const int x = index % m_width + kDx[direction];
+    const int y = index / m_width + kDy[direction];
+    if (x < 0 || y < 0 || x >= m_width || y >= m_height) return -1;
+    return y * m_width + x;
+}
+
+int FrangiVesselGraph::blockOf(int index) const
+{
+    return (index / m_width) / kBlockSize * m_blocksX + (index % m_width) / kBlockSize;
+}
+
+bool FrangiVesselGraph::isNodePixel(int x, int y) const
+{
+    // Число переходов фон -> скелет по кругу соседей: 2 - середина ветви,
+    // 1 - конец, 0 - точка, 3 и больше - разветвление
+    bool ring[8];
+    for (int i = 0; i < 8; ++i) {
+        const int nx = x + kRingDx[i];
+        const int ny = y + kRingDy[i];
+        ring[i] = nx >= 0 && ny >= 0 && nx < m_width && ny < m_height && isSkeleton(ny * m_width + nx);
+    }
+    int transitions = 0;
+    for (int i = 0; i < 8; ++i) {
+        transitions += !ring[i] && ring[(i + 1) % 8];
+    }
+    return transitions != 2;
+}
+
+void FrangiVesselGraph::registerIn(QVector<QVector<int>> &blocks, int block, int id, bool nodes)
+{
+    QVector<int> &list = blocks[block];
+    if (list.contains(id)) return;
+    if (list.size() >= kBlockListLimit) {
+        auto removed = [this, nodes](int entry) {
+            return nodes ? !m_nodes[entry].valid : !m_branches[entry].valid;
+        };
+        list.erase(std::remove_if(list.begin(), list.end(), removed), list.end());
+    }
+    list.append(id);
+}
+
+void FrangiVesselGraph::update(const uchar *skeleton, int width, int height, const float *scales, float sigma)
+{
+    if (width <= 0 || height <= 0) {
+        clear();
+        return;
+    }
+    
+    // Новый размер - граф строится заново: все блоки считаются измененными
+    const bool resized = width != m_width || height != m_height;
+    if (resized) {
+        clear();
+        m_width = width;
+        m_height = height;
+        m_blocksX = (width + kBlockSize - 1) / kBlockSize;
+        m_blocksY = (height + kBlockSize - 1) / kBlockSize;
+        m_skeleton.fill(0, width * height);
+        m_labels.fill(0, width * height);
+        m_blockNodes.resize(blockCount());
+        m_blockBranches.resize(blockCount());
+    }
+    
+    // Измененные блоки: построчное сравнение с прошлой маской
+    QVector<uchar> changed(blockCount(), resized ? 1 : 0);
+    for (int by = 0; by < m_blocksY; ++by) {
+        for (int bx = 0; bx < m_blocksX; ++bx) {
+            const int x0 = bx * kBlockSize;
+            const int columns = qMin(kBlockSize, width - x0);
+            for (int y = by * kBlockSize; y < qMin((by + 1) * kBlockSize, height); ++y) {
+                uchar *previous = m_skeleton.data() + y * width + x0;
+                const uchar *current = skeleton + y * width + x0;
+                if (std::memcmp(previous, current, columns) != 0) {
+                    std::memcpy(previous, current, columns);
+                    changed[by * m_blocksX + bx] = 1;
+                }
+            }
+        }
+    }
+    
+    // Тип пикселя зависит от 8-соседей, а узлы и ветви выходят за блок,
+    // поэтому перестраивается и кольцо соседних блоков
+    QVector<uchar> dirty(blockCount(), 0);
+    for (int by = 0; by < m_blocksY; ++by) {
+        for (int bx = 0; bx < m_blocksX; ++bx) {
+            if (!changed[by * m_blocksX + bx]) continue;
+            for (int ny = qMax(0, by - 1); ny <= qMin(m_blocksY - 1, by + 1); ++ny) {
+                for (int nx = qMax(0, bx - 1); nx <= qMin(m_blocksX - 1, bx + 1); ++nx) {
+                    dirty[ny * m_blocksX + nx] = 1;
+                }
+            }
+        }
+    }
+    
+    // Освобожденные пиксели: узлы и ветви грязных блоков целиком (вместе
+    // с ветвями удаленных узлов) и новый скелет грязных блоков
+    QVector<int> freed;
+    m_rebuiltBlocks = 0;
+    for (int block = 0; block < blockCount(); ++block) {
+        if (!dirty[block]) continue;
+        ++m_rebuiltBlocks;
+        const QVector<int> nodes = m_blockNodes[block];
+        const QVector<int> branches = m_blockBranches[block];
+        for (int id : nodes) {
+            removeNode(id, freed);
+        }
+        for (int id : branches) {
+            removeBranch(id, freed);
+        }
+        m_blockNodes[block].clear();
+        m_blockBranches[block].clear();
+        
+        const int x0 = block % m_blocksX * kBlockSize;
+        const int y0 = block / m_blocksX * kBlockSize;
+        for (int y = y0; y < qMin(y0 + kBlockSize, height); ++y) {
+            for (int x = x0; x < qMin(x0 + kBlockSize, width); ++x) {
+                if (isSkeleton(y * width + x)) {
+                    freed.append(y * width + x);
+                }
+            }
+        }
+    }
+    
+    // Сначала узлы, затем ветви между ними
+    for (int index : freed) {
+        if (isSkeleton(index) && m_labels[index] == 0 && isNodePixel(index % width, index / width)) {
+            createNode(index);
+        }
+    }
+    for (int index : freed) {
+        if (isSkeleton(index) && m_labels[index] == 0) {
+            traceBranch(index);
+        }
+    }
+    
+    updateRadii(scales, sigma);
+}
+
+void FrangiVesselGraph::removeNode(int id, QVector<int> &freed)
+{
+    if (id >= m_nodes.size() || !m_nodes[id].valid) return;
+    
+    const QVector<int> branches = m_nodes[id].branches;
+    for (int branch : branches) {
+        removeBranch(branch, freed);
+    }
+    
+    FrangiVesselNode &node = m_nodes[id];
+    for (const QPoint &pixel : node.pixels) {
+        const int index = pixel.y() * m_width + pixel.x();
+        m_labels[index] = 0;
+        freed.append(index);
+    }
+    node = FrangiVesselNode();
+    m_freeNodes.append(id);
+    --m_nodeCount;
+}
+
+void FrangiVesselGraph::removeBranch(int id, QVector<int> &freed)
+{
+    if (id >= m_branches.size() || !m_branches[id].valid) return;
+    
+    FrangiVesselBranch &branch = m_branches[id];
+    for (const QPoint &point : branch.points) {
+        const int index = point.y() * m_width + point.x();
+        m_labels[index] = 0;
+        freed.append(index);
+    }
+    if (branch.from >= 0) m_nodes[branch.from].branches.removeAll(id);
+    if (branch.to >= 0) m_nodes[branch.to].branches.removeAll(id);
+    branch = FrangiVesselBranch();
+    m_freeBranches.append(id);
+    --m_branchCount;
+}
+
+void FrangiVesselGraph::createNode(int seed)
+{
+    int id;
+    if (!m_freeNodes.isEmpty()) {
+        id = m_freeNodes.takeLast();
+    } else {
+        id = m_nodes.size();
+        m_nodes.append(FrangiVesselNode());
+    }
+    FrangiVesselNode &node = m_nodes[id];
+    node.valid = true;
+    ++m_nodeCount;
+    
+    // Связная группа пикселей-узлов (8-связность)
+    QVector<int> stack;
+    stack.append(seed);
+    m_labels[seed] = -id - 1;
+    double sumX = 0.0;
+    double sumY = 0.0;
+    while (!stack.isEmpty()) {
+        const int index = stack.takeLast();
+        const QPoint pixel(index % m_width, index / m_width);
+        node.pixels.append(pixel);
+        sumX += pixel.x();
+        sumY += pixel.y();
+        registerIn(m_blockNodes, blockOf(index), id, true);
+        
+        for (int direction = 0; direction < 8; ++direction) {
+            const int next = neighbour(index, direction);
+            if (next < 0 || !isSkeleton(next) || m_labels[next] != 0) continue;
+            if (!isNodePixel(next % m_width, next / m_width)) continue;
+            m_labels[next] = -id - 1;
+            stack.append(next);
+        }
+    }
+    node.position = QPointF(sumX / node.pixels.size(), sumY / node.pixels.size());
+}
+
+int FrangiVesselGraph::walk(int start, int id, QVector<QPoint> &points, int &nodePixel)
+{
+    // По свободным пикселям скелета до узла, обрыва или замыкания контура
+    int current = start;
+    while (true) {
+        int next = -1;
+        for (int direction = 0; direction < 8; ++direction) {
+            const int candidate = neighbour(current, direction);
+            if (candidate >= 0 && isSkeleton(candidate) && m_labels[candidate] == 0) {
+                next = candidate;
+                break;
+            }
+        }
+        if (next < 0) break;
+        m_labels[next] = id + 1;
+        points.append(QPoint(next % m_width, next / m_width));
+        current = next;
+    }
+    
+    nodePixel = -1;
+    for (int direction = 0; direction < 8; ++direction) {
+        const int candidate = neighbour(current, direction);
+        if (candidate >= 0 && m_labels[candidate] < 0) {
+            nodePixel = candidate;
+            return -m_labels[candidate] - 1;
+        }
+    }
+    return -1;
+}
+
+void FrangiVesselGraph::traceBranch(int seed)
+{
+    int id;
+    if (!m_freeBranches.isEmpty()) {
+        id = m_freeBranches.takeLast();
+    } else {
+        id = m_branches.size();
+        m_branches.append(FrangiVesselBranch());
+    }
+    m_labels[seed] = id + 1;
+    ++m_branchCount;
+    
+    // Из затравки в обе стороны
+    QVector<QPoint> forward;
+    QVector<QPoint> backward;
+    int toPixel;
+    int fromPixel;
+    const int to = walk(seed, id, forward, toPixel);
+    const int from = walk(seed, id, backward, fromPixel);
+    
+    FrangiVesselBranch &branch = m_branches[id];
+    branch.valid = true;
+    branch.from = from;
+    branch.to = to;
+    branch.points.reserve(backward.size() + 1 + forward.size());
+    for (int i = backward.size() - 1; i >= 0; --i) {
+        branch.points.append(backward[i]);
+    }
+    branch.points.append(QPoint(seed % m_width, seed / m_width));
+    branch.points += forward;
+    
+    // Длина - вместе с шагами до пикселей узлов
+    QVector<QPoint> path;
+    if (fromPixel >= 0) path.append(QPoint(fromPixel % m_width, fromPixel / m_width));
+    path += branch.points;
+    if (toPixel >= 0) path.append(QPoint(toPixel % m_width, toPixel / m_width));
+    branch.length = polylineLength(path);
+    
+    for (const QPoint &point : branch.points) {
+        registerIn(m_blockBranches, blockOf(point.y() * m_width + point.x()), id, false);
+    }
+    if (from >= 0) m_nodes[from].branches.append(id);
+    if (to >= 0) m_nodes[to].branches.append(id);
+}
+
+void FrangiVesselGraph::updateRadii(const float *scales, float sigma)
+{
+    for (FrangiVesselBranch &branch : m_branches) {
+        if (!branch.valid) continue;
+        if (!scales) {
+            branch.radius = float(M_SQRT2) * sigma;
+            continue;
+        }
+        double sum = 0.0;
+        for (const QPoint &point : branch.points) {
+            sum += scales[point.y() * m_width + point.x()];
+        }
+        branch.radius = float(M_SQRT2 * sum / branch.points.size());
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef FRANGIVESSELGRAPH_H
+#define FRANGIVESSELGRAPH_H
+
+#include <QPoint>
+#include <QPointF>
+#include <QVector>
+
+// Узел графа сосудов: конец (одна ветвь), разветвление (три и больше)
+// или изолированная точка. Соседние пиксели разветвления - один узел
+struct FrangiVesselNode
+{
+    QPointF position;        // центр пикселей узла
+    QVector<QPoint> pixels;
+    QVector<int> branches;   // индексы ветвей (петля на узле - дважды)
+    bool valid = false;      // слот занят
+};
+
+// Ветвь между двумя узлами
+struct FrangiVesselBranch
+{
+    int from = -1;           // индексы узлов, -1 - замкнутый контур без узлов
+    int to = -1;
+    QVector<QPoint> points;  // пиксели скелета от from к to без пикселей узлов
+    float length = 0.0f;     // шаги 1 и sqrt(2) в пикселях, включая шаги до узлов
+    float radius = 0.0f;     // средний радиус по точкам, пиксели
+    bool valid = false;
+};
+
+// Граф сосудов по маске скелета (stage Centerline, строки сверху вниз).
+// Обновляется инкрементально: маска сравнивается с предыдущей блоками
+// kBlockSize x kBlockSize, и заново трассируются только узлы и ветви,
+// задевающие измененные блоки и их соседей, поэтому на живом видео время
+// update() определяется объемом изменений, а не размером кадра.
+// Индексы узлов и ветвей стабильны, пока они не перестроены; слоты
+// с valid == false пропускаются.
+//
+// Радиус - sqrt(2) * sigma максимума vesselness (у трубки с гауссовым
+// профилем отклик максимален при sigma = r / sqrt(2)). Карта sigma меняется
+// каждый кадр, поэтому радиусы пересчитываются для всех ветвей.
+class FrangiVesselGraph
+{
+public:
+    static const int kBlockSize = 32;
+
+    FrangiVesselGraph();
+
+    // skeleton - width*height байт, ненулевые - скелет. scales - sigma
+    // максимума по пикселям (multi-scale режим) или nullptr, тогда sigma
+    void update(const uchar *skeleton, int width, int height, const float *scales, float sigma);
+    void clear();
+
+    const QVector<FrangiVesselNode> &nodes() const { return m_nodes; }
+    const QVector<FrangiVesselBranch> &branches() const { return m_branches; }
+    int nodeCount() const { return m_nodeCount; }
+    int branchCount() const { return m_branchCount; }
+    float totalLength() const;
+
+    // Перестроено блоков последним update() из blockCount() (все - при смене размера)
+    int rebuiltBlocks() const { return m_rebuiltBlocks; }
+    int blockCount() const { return m_blocksX * m_blocksY; }
+
+private:
+    bool isSkeleton(int index) const { return m_skeleton[index] != 0; }
+    bool isNodePixel(int x, int y) const;
+    int neighbour(int index, int direction) const;
+    int blockOf(int index) const;
+    void registerIn(QVector<QVector<int>> &blocks, int block, int id, bool nodes);
+    void removeNode(int id, QVector<int> &freed);
+    void removeBranch(int id, QVector<int> &freed);
+    void createNode(int seed);
+    void traceBranch(int seed);
+    int walk(int start, int id, QVector<QPoint> &points, int &nodePixel);
+    void updateRadii(const float *scales, float sigma);
+
+    int m_width;
+    int m_height;
+    int m_blocksX;
+    int m_blocksY;
+
+    // Маска прошлого update() и метки пикселей:
+    // 0 - нет, > 0 - ветвь label - 1, < 0 - узел -label - 1
+    QVector<uchar> m_skeleton;
+    QVector<int> m_labels;
+
+    QVector<FrangiVesselNode> m_nodes;
+    QVector<FrangiVesselBranch> m_branches;
+    QVector<int> m_freeNodes;
+    QVector<int> m_freeBranches;
+    int m_nodeCount;
+    int m_branchCount;
+
+    // Узлы и ветви, задевающие блок (могут остаться индексы перестроенных)
+    QVector<QVector<int>> m_blockNodes;
+    QVector<QVector<int>> m_blockBranches;
+    int m_rebuiltBlocks;
+};
+
+#endif // FRANGIVESSELGRAPH_H
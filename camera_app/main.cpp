@@ -1,14 +1,156 @@
 #include <QApplication>
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QStringList>
+#include <cstdio>
 #include "mainwindow.h"
+#include "offlinerunner.h"
 
 int main(int argc, char *argv[])
 {
+    // Аргументы разбираются до создания приложения: для режима без окна
+    // нужно выставить платформу до QGuiApplication
+    QStringList arguments;
+    for (int i = 0; i < argc; ++i) {
+        arguments << QString::fromLocal8Bit(argv[i]);
+    }
+    
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Frangi vesselness filter for camera and recorded frames");
+    parser.addHelpOption();
+    QCommandLineOption inputOption("input",
+        "Input: camera, camera:N, video file, Y4M stream, .frec recording, image or directory of images. "
+        "Repeat to show several streams in a grid; without display only the first one is used.",
+        "source", "camera");
+    QCommandLineOption noDisplayOption("no-display",
+        "Process the input without a window as fast as possible and report fps.");
+    QCommandLineOption benchmarkOption("benchmark",
+        "Like --no-display, with warm-up and frame time statistics.");
+    QCommandLineOption backendOption("backend",
+        "Backend without display: auto, gl or cpu.", "backend", "auto");
+    QCommandLineOption loopsOption("loops",
+        "How many times to process the input without display.", "count", "1");
+    QCommandLineOption multiScaleOption("multi-scale",
+        "Multi-scale vesselness (sigma 1-8, 5 scales) without display.");
+    QCommandLineOption temporalOption("temporal",
+        "Motion-compensated temporal averaging of vesselness without display.");
+    QCommandLineOption computeOption("compute",
+        "Compute shader blur in the GL backend (GL 4.3+, otherwise fragment shaders).");
+    QCommandLineOption latencyBudgetOption("latency-budget",
+        "Window only: lower processing resolution, scale count and frame rate "
+        "to keep frame latency within the budget.", "ms");
+    QCommandLineOption latencyTestOption("latency-test",
+        "Window only: measure glass-to-glass latency with a time pattern drawn on screen "
+        "(for a camera filming the display) and stamped into frames of file inputs.");
+    QCommandLineOption profileCsvOption("profile-csv",
+        "Write per-stage timings of every frame to a CSV file.", "file");
+    QCommandLineOption precisionOption("precision",
+        "Intermediate render target precision without display: full, balanced or half.",
+        "precision", "balanced");
+    QCommandLineOption validateOption("validate",
+        "Compare GL and CPU pipelines with the double-precision reference on synthetic phantoms.");
+    QCommandLineOption frameBudgetOption("frame-budget",
+        "With --validate: fail if the mean frame time exceeds this budget.", "ms", "0");
+    QCommandLineOption recordOption("record",
+        "Record raw frames with filter parameters (and vesselness without display) "
+        "to a .frec file; replay it with --input file.frec.", "file.frec");
+    QCommandLineOption centerlineOption("centerline",
+        "Without display: extract vessel centerlines, build the vessel graph "
+        "and write the branches of the last frame to a CSV file.", "graph.csv");
+    QCommandLineOption tiledOption("tiled",
+        "Process a PGM/PPM image of any size in overlapping tiles without display "
+        "and write vesselness to a PFM file.", "output.pfm");
+    QCommandLineOption tileSizeOption("tile-size",
+        "With --tiled: tile size in pixels, without the apron.", "pixels", "2048");
+    parser.addOption(inputOption);
+    parser.addOption(noDisplayOption);
+    parser.addOption(benchmarkOption);
+    parser.addOption(backendOption);
+    parser.addOption(loopsOption);
+    parser.addOption(multiScaleOption);
+    parser.addOption(temporalOption);
+    parser.addOption(computeOption);
+    parser.addOption(latencyBudgetOption);
+    parser.addOption(latencyTestOption);
+    parser.addOption(profileCsvOption);
+    parser.addOption(precisionOption);
+    parser.addOption(validateOption);
+    parser.addOption(frameBudgetOption);
+    parser.addOption(recordOption);
+    parser.addOption(centerlineOption);
+    parser.addOption(tiledOption);
+    parser.addOption(tileSizeOption);
+    
+    // Неизвестные опции могут быть опциями Qt (-platform и т.п.), их разберет приложение
+    if (!parser.parse(arguments) && parser.unknownOptionNames().isEmpty()) {
+        fprintf(stderr, "%s\n", qPrintable(parser.errorText()));
+        return 1;
+    }
+    if (parser.isSet("help")) {
+        printf("%s", qPrintable(parser.helpText()));
+        return 0;
+    }
+    
+    if (parser.isSet(noDisplayOption) || parser.isSet(benchmarkOption) || parser.isSet(validateOption) ||
+        parser.isSet(tiledOption)) {
+        FrangiEngine::prepareHeadlessEnvironment();
+        QGuiApplication app(argc, argv);
+        
+        OfflineOptions options;
+        options.input = parser.values(inputOption).value(0);
+        options.loops = parser.value(loopsOption).toInt();
+        options.benchmark = parser.isSet(benchmarkOption);
+        options.multiScale = parser.isSet(multiScaleOption);
+        options.temporal = parser.isSet(temporalOption);
+        options.compute = parser.isSet(computeOption);
+        options.profileCsv = parser.value(profileCsvOption);
+        options.recordPath = parser.value(recordOption);
+        options.centerlineCsv = parser.value(centerlineOption);
+        const QString backend = parser.value(backendOption);
+        if (backend == "gl") {
+            options.backend = FrangiEngine::BackendOpenGL;
+        } else if (backend == "cpu") {
+            options.backend = FrangiEngine::BackendCpu;
+        }
+        const QString precision = parser.value(precisionOption);
+        if (precision == "full") {
+            options.precision = FrangiPrecisionFull;
+        } else if (precision == "half") {
+            options.precision = FrangiPrecisionHalf;
+        }
+        if (parser.isSet(validateOption)) {
+            options.frameBudget = parser.value(frameBudgetOption).toDouble();
+            return runValidation(options);
+        }
+        if (parser.isSet(tiledOption)) {
+            options.tiledOutput = parser.value(tiledOption);
+            options.tileSize = parser.value(tileSizeOption).toInt();
+            return runTiled(options);
+        }
+        return runOffline(options);
+    }
+    
     QApplication app(argc, argv);
     
-    MainWindow window;
+    MainWindow window(parser.values(inputOption));
     window.setWindowTitle("Приложение с камерой");
     window.resize(800, 600);
+    if (parser.isSet(profileCsvOption) && !window.startProfileCsv(parser.value(profileCsvOption))) {
+        fprintf(stderr, "Cannot write profile CSV: %s\n", qPrintable(parser.value(profileCsvOption)));
+    }
+    if (parser.isSet(recordOption) && !window.startRecording(parser.value(recordOption))) {
+        fprintf(stderr, "Cannot write recording: %s\n", qPrintable(parser.value(recordOption)));
+    }
+    if (parser.isSet(computeOption)) {
+        window.setComputeEnabled(true);
+    }
+    if (parser.isSet(latencyBudgetOption)) {
+        window.setLatencyBudget(parser.value(latencyBudgetOption).toDouble());
+    }
+    if (parser.isSet(latencyTestOption)) {
+        window.setLatencyTestEnabled(true);
+    }
     window.show();
     
     return app.exec();
-}
\ No newline at end of file
+}
@@ -5,43 +5,44 @@
 #include <QMediaDevices>
 #include <QSize>
 #include <QVideoFrame>
+#include <QStatusBar>
+#include <QFileInfo>
+#include <QUrl>
+#include <QDebug>
+#include "frangiframesource.h"
+#include "frangivesselgraph.h"
 
-MainWindow::MainWindow(QWidget *parent)
+// Multi-scale режим окна: sigma 1-8, планировщик может сократить число масштабов
+static const int kMultiScaleCount = 5;
+
+MainWindow::MainWindow(const QStringList &inputs, QWidget *parent)
     : QMainWindow(parent)
+    , profilingCsv(false)
+    , recorder(new FrangiRecorder())
+    , scheduler(new FrangiLatencyScheduler())
+    , pendingArrival(0)
 {
     // Создаем центральный виджет и основной layout
     QWidget *centralWidget = new QWidget(this);
     QVBoxLayout *mainLayout = new QVBoxLayout(centralWidget);
     
-    // Создаем горизонтальный layout для двух видео виджетов
-    QHBoxLayout *videoLayout = new QHBoxLayout();
-    
-    // Виджет для исходного видео с камеры
-    QVBoxLayout *rawLayout = new QVBoxLayout();
+    // Заголовки половин split view
+    QHBoxLayout *titlesLayout = new QHBoxLayout();
     QLabel *rawTitle = new QLabel("Raw Camera Feed", this);
     rawTitle->setAlignment(Qt::AlignCenter);
-    rawLayout->addWidget(rawTitle);
-    
-    rawVideoLabel = new QLabel(this);
-    rawVideoLabel->setMinimumSize(320, 240);
-    rawVideoLabel->setScaledContents(true);
-    rawVideoLabel->setStyleSheet("border: 2px solid green;");
-    rawLayout->addWidget(rawVideoLabel);
-    videoLayout->addLayout(rawLayout);
-    
-    // Виджет для обработанного видео (Frangi)
-    QVBoxLayout *frangiLayout = new QVBoxLayout();
+    titlesLayout->addWidget(rawTitle);
     QLabel *frangiTitle = new QLabel("Frangi Filter Output", this);
     frangiTitle->setAlignment(Qt::AlignCenter);
-    frangiLayout->addWidget(frangiTitle);
+    titlesLayout->addWidget(frangiTitle);
+    mainLayout->addLayout(titlesLayout);
     
+    // Исходное и обработанное видео в одном GL виджете: исходный кадр
+    // рисуется из текстуры, которую конвейер уже загрузил
     frangiWidget = new FrangiGLWidget(this);
-    frangiWidget->setMinimumSize(320, 240);
+    frangiWidget->setMinimumSize(640, 240);
     frangiWidget->setStyleSheet("border: 2px solid blue;");
-    frangiLayout->addWidget(frangiWidget);
-    videoLayout->addLayout(frangiLayout);
-    
-    mainLayout->addLayout(videoLayout);
+    frangiWidget->setSplitViewEnabled(true);
+    mainLayout->addWidget(frangiWidget);
     
     // Создаем панель управления параметрами
     QVBoxLayout *controlsLayout = new QVBoxLayout();
@@ -93,6 +94,52 @@ MainWindow::MainWindow(QWidget *parent)
     invertCheckBox->setChecked(true);  // По умолчанию включено
     controlsLayout->addWidget(invertCheckBox);
     
+    // Multi-scale checkbox: максимум vesselness по sigma 1-8 (5 масштабов)
+    multiScaleCheckBox = new QCheckBox("Multi-scale (sigma 1-8, 5 scales)", this);
+    multiScaleCheckBox->setChecked(false);
+    controlsLayout->addWidget(multiScaleCheckBox);
+    
+    // Temporal checkbox: усреднение vesselness по кадрам с компенсацией движения
+    temporalCheckBox = new QCheckBox("Temporal (motion-compensated averaging)", this);
+    temporalCheckBox->setChecked(false);
+    controlsLayout->addWidget(temporalCheckBox);
+    
+    // Compute checkbox: blur compute шейдерами, выигрыш зависит от драйвера
+    // (см. frangi_bench), без GL 4.3 конвейер остается на fragment пути
+    computeCheckBox = new QCheckBox("Compute blur (GL 4.3+)", this);
+    computeCheckBox->setChecked(false);
+    controlsLayout->addWidget(computeCheckBox);
+    
+    // Profiling checkbox: p50/p95/p99 времени stage'ей поверх кадра
+    profilingCheckBox = new QCheckBox("Profiling HUD", this);
+    profilingCheckBox->setChecked(false);
+    controlsLayout->addWidget(profilingCheckBox);
+    
+    // Pause checkbox: кадр замораживается, параметры пересчитывают только
+    // зависящие от них stage'и
+    pauseCheckBox = new QCheckBox("Pause (still frame)", this);
+    pauseCheckBox->setChecked(false);
+    controlsLayout->addWidget(pauseCheckBox);
+    
+    // ROI checkbox: обрабатывается только прямоугольник, выделенный на выходе
+    roiCheckBox = new QCheckBox("ROI (drag on output, double-click to reset)", this);
+    roiCheckBox->setChecked(false);
+    controlsLayout->addWidget(roiCheckBox);
+    
+    // Latency budget: при задержке кадра выше бюджета обработка переходит на
+    // меньше масштабов, уменьшенный кадр и пропуск кадров
+    QHBoxLayout *latencyLayout = new QHBoxLayout();
+    latencyBudgetCheckBox = new QCheckBox("Adaptive quality, latency budget:", this);
+    latencyBudgetCheckBox->setChecked(false);
+    latencyBudgetSpinBox = new QSpinBox(this);
+    latencyBudgetSpinBox->setRange(5, 500);
+    latencyBudgetSpinBox->setValue(33);
+    latencyBudgetSpinBox->setSuffix(" ms");
+    latencyLayout->addWidget(latencyBudgetCheckBox);
+    latencyLayout->addWidget(latencyBudgetSpinBox);
+    latencyLayout->addStretch();
+    controlsLayout->addLayout(latencyLayout);
+    
     // Display Stage selector
     QHBoxLayout *stageLayout = new QHBoxLayout();
     QLabel *stageTitle = new QLabel("Display Stage:", this);
@@ -105,11 +152,24 @@ MainWindow::MainWindow(QWidget *parent)
     stageComboBox->addItem("5: Eigenvalues");
     stageComboBox->addItem("6: Vesselness");
     stageComboBox->addItem("7: Overlay on Original");
+    stageComboBox->addItem("8: Centerline (skeleton)");
     stageComboBox->setCurrentIndex(7);  // По умолчанию Overlay
     stageLayout->addWidget(stageTitle);
     stageLayout->addWidget(stageComboBox);
     controlsLayout->addLayout(stageLayout);
     
+    // Precision selector: формат промежуточных FBO (порядок как в FrangiPrecision)
+    QHBoxLayout *precisionLayout = new QHBoxLayout();
+    QLabel *precisionTitle = new QLabel("Precision:", this);
+    precisionComboBox = new QComboBox(this);
+    precisionComboBox->addItem("Full (32F)");
+    precisionComboBox->addItem("Balanced (16F derivatives)");
+    precisionComboBox->addItem("Half (16F)");
+    precisionComboBox->setCurrentIndex(FrangiPrecisionBalanced);
+    precisionLayout->addWidget(precisionTitle);
+    precisionLayout->addWidget(precisionComboBox);
+    controlsLayout->addLayout(precisionLayout);
+    
     mainLayout->addLayout(controlsLayout);
     
     // Создаем layout для кнопок
@@ -135,12 +195,97 @@ MainWindow::MainWindow(QWidget *parent)
     connect(cSlider, &QSlider::valueChanged, this, &MainWindow::onCChanged);
     connect(stageComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &MainWindow::onStageChanged);
+    connect(precisionComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &MainWindow::onPrecisionChanged);
     connect(invertCheckBox, &QCheckBox::toggled, this, &MainWindow::onInvertToggled);
+    connect(multiScaleCheckBox, &QCheckBox::toggled, this, &MainWindow::onMultiScaleToggled);
+    connect(temporalCheckBox, &QCheckBox::toggled, this, &MainWindow::onTemporalToggled);
+    connect(computeCheckBox, &QCheckBox::toggled, this, &MainWindow::onComputeToggled);
+    connect(profilingCheckBox, &QCheckBox::toggled, this, &MainWindow::onProfilingToggled);
+    connect(pauseCheckBox, &QCheckBox::toggled, this, &MainWindow::onPauseToggled);
+    connect(roiCheckBox, &QCheckBox::toggled, this, &MainWindow::onRoiToggled);
+    connect(latencyBudgetCheckBox, &QCheckBox::toggled, this, &MainWindow::onLatencyBudgetToggled);
+    connect(latencyBudgetSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
+            this, &MainWindow::onLatencyBudgetChanged);
+    // Кадр показан: задержка от прихода в поток захвата
+    connect(frangiWidget, &QOpenGLWidget::frameSwapped, this, &MainWindow::onFrameSwapped);
     
     // Подключаем сигналы кнопок (они ничего не делают, как и требовалось)
     connect(button1, &QPushButton::clicked, this, &MainWindow::onButton1Clicked);
     connect(button2, &QPushButton::clicked, this, &MainWindow::onButton2Clicked);
     
+    // Счетчики обработанных и отброшенных кадров в статусной строке
+    captureStatsTimer = new QTimer(this);
+    connect(captureStatsTimer, &QTimer::timeout, this, &MainWindow::onCaptureStatsTimeout);
+    captureStatsTimer->start(1000);
+    
+    // Поток на каждый источник: все кадры обрабатываются одним атласом
+    // конвейера и показываются сеткой в том же виджете
+    const QStringList sources = inputs.isEmpty() ? QStringList("camera") : inputs;
+    streams.reserve(sources.size());
+    frangiWidget->setStreamCount(sources.size());
+    for (const QString &input : sources) {
+        createStream(input);
+    }
+    updateStillMode();
+    // ROI выбирается только на одном потоке
+    roiCheckBox->setEnabled(streams.size() == 1);
+    temporalCheckBox->setEnabled(streams.size() == 1);
+    latencyBudgetCheckBox->setEnabled(streams.size() == 1);
+}
+
+MainWindow::~MainWindow()
+{
+    for (InputStream &stream : streams) {
+        if (stream.camera) {
+            stream.camera->stop();
+        }
+        if (stream.mediaPlayer) {
+            stream.mediaPlayer->stop();
+        }
+        
+        // Останавливаем поток захвата до удаления очереди
+        disconnect(stream.videoSink, nullptr, stream.captureWorker, nullptr);
+        stream.captureThread->quit();
+        stream.captureThread->wait();
+        delete stream.captureWorker;
+        delete stream.frameQueue;
+    }
+    
+    // Дописывает очередь записи и закрывает файл
+    delete recorder;
+    delete scheduler;
+}
+
+void MainWindow::createStream(const QString &input)
+{
+    const int index = streams.size();
+    streams.append(InputStream());
+    InputStream &stream = streams.last();
+    
+    // Кадры разбираются в потоке захвата: GUI поток только загружает
+    // самый новый кадр в конвейер
+    stream.frameQueue = new FrangiFrameQueue();
+    stream.captureThread = new QThread(this);
+    stream.captureWorker = new CaptureWorker(stream.frameQueue);
+    stream.captureWorker->moveToThread(stream.captureThread);
+    connect(stream.captureWorker, &CaptureWorker::frameReady, this, [this, index]() {
+        onCaptureFrameReady(index);
+    });
+    stream.captureThread->start();
+    
+    // Создаем video sink для получения кадров. Direct: submit() только
+    // запоминает кадр, поэтому события не копятся в очереди потока захвата
+    stream.videoSink = new QVideoSink(this);
+    connect(stream.videoSink, &QVideoSink::videoFrameChanged,
+            stream.captureWorker, &CaptureWorker::submit, Qt::DirectConnection);
+    
+    // Источник кадров: камера, видео файл или файлы кадров (Y4M, изображения)
+    startInput(stream, input);
+}
+
+bool MainWindow::startCamera(InputStream &stream, int index)
+{
     // Получаем список доступных камер и выводим их
     QList<QCameraDevice> devices = QMediaDevices::videoInputs();
     // QString cameraList;
@@ -151,11 +296,19 @@ MainWindow::MainWindow(QWidget *parent)
 
     // QMessageBox::information(this, "Доступные камеры", cameraList);
 
+    // Без камеры приложение продолжает работать, просто без кадров
+    if (index < 0 || index >= devices.size()) {
+        stream.inputStatus = QString("Camera %1 not found").arg(index);
+        qDebug() << "No camera with index" << index << "- available:" << devices.size();
+        return false;
+    }
+    
     // // Настраиваем камеру (специально выбираем USB20 Camera)
-    QCameraDevice selectedDevice = devices [0];
+    QCameraDevice selectedDevice = devices [index];
+    stream.inputStatus = selectedDevice.description();
 
-    camera = new QCamera(selectedDevice, this);
-    captureSession = new QMediaCaptureSession(this);
+    QCamera *camera = new QCamera(selectedDevice, this);
+    stream.camera = camera;
     
     // Настраиваем формат для минимальной задержки
     QCameraFormat bestFormat;
@@ -186,23 +339,54 @@ MainWindow::MainWindow(QWidget *parent)
         camera->setCameraFormat(bestFormat);
     }
     
-    // Создаем video sink для получения кадров
-    videoSink = new QVideoSink(this);
-    connect(videoSink, &QVideoSink::videoFrameChanged,
-            this, &MainWindow::onVideoFrameChanged);
-    
-    captureSession->setCamera(camera);
-    captureSession->setVideoOutput(videoSink);
+    stream.captureSession = new QMediaCaptureSession(this);
+    stream.captureSession->setCamera(camera);
+    stream.captureSession->setVideoOutput(stream.videoSink);
     
     // Запускаем камеру
     camera->start();
+    return true;
 }
 
-MainWindow::~MainWindow()
+bool MainWindow::startInput(InputStream &stream, const QString &input)
 {
-    if (camera) {
-        camera->stop();
+    // camera или camera:N - камера с индексом N
+    if (input == "camera" || input.startsWith("camera:")) {
+        return startCamera(stream, input == "camera" ? 0 : input.mid(7).toInt());
     }
+    
+    // Y4M, записи *.frec и изображения читает поток захвата сам, с частотой из файла
+    if (FrangiFrameSource::canOpen(input)) {
+        QString error;
+        FrangiFrameSource *source = FrangiFrameSource::open(input, &error);
+        if (!source) {
+            stream.inputStatus = error;
+            qDebug() << "Failed to open input:" << error;
+            return false;
+        }
+        const double frameRate = source->frameRate() > 0.0 ? source->frameRate() : 30.0;
+        stream.inputStatus = QFileInfo(input).fileName();
+        stream.stillImage = QFileInfo(input).isFile() && dynamic_cast<FrangiImageSequenceSource *>(source);
+        CaptureWorker *worker = stream.captureWorker;
+        QMetaObject::invokeMethod(worker, [worker, source, frameRate]() {
+            worker->playSource(source, frameRate);
+        }, Qt::QueuedConnection);
+        return true;
+    }
+    
+    // Остальные файлы - видео через QMediaPlayer в тот же video sink
+    if (QFileInfo(input).isFile()) {
+        stream.mediaPlayer = new QMediaPlayer(this);
+        stream.mediaPlayer->setVideoOutput(stream.videoSink);
+        stream.mediaPlayer->setLoops(QMediaPlayer::Infinite);
+        stream.mediaPlayer->setSource(QUrl::fromLocalFile(QFileInfo(input).absoluteFilePath()));
+        stream.mediaPlayer->play();
+        stream.inputStatus = QFileInfo(input).fileName();
+        return true;
+    }
+    
+    stream.inputStatus = QString("Input not found: %1").arg(input);
+    return false;
 }
 
 void MainWindow::onButton1Clicked()
@@ -215,28 +399,107 @@ void MainWindow::onButton2Clicked()
     // Кнопка 2 ничего не делает, как и требовалось
 }
 
-void MainWindow::onVideoFrameChanged(const QVideoFrame &frame)
+void MainWindow::onCaptureFrameReady(int stream)
 {
-    if (frame.isValid()) {
-        QVideoFrame clonedFrame(frame);
-        if (clonedFrame.map(QVideoFrame::ReadOnly)) {
-            QImage image = clonedFrame.toImage();
-            clonedFrame.unmap();
-            
-            if (!image.isNull()) {
-                // Показываем исходное изображение
-                QPixmap pixmap = QPixmap::fromImage(image.scaled(
-                    rawVideoLabel->size(),
-                    Qt::KeepAspectRatio,
-                    Qt::SmoothTransformation
-                ));
-                rawVideoLabel->setPixmap(pixmap);
-                
-                // Отправляем на обработку через Frangi
-                frangiWidget->setFrame(image);
-            }
+    InputStream &input = streams[stream];
+    input.captureWorker->acknowledge();
+    
+    // Более старые кадры из очереди уже не нужны: загружаем только последний
+    FrangiFrameBuffer *buffer = input.frameQueue->takeLatest();
+    if (!buffer) return;
+    
+    // На паузе и для изображения, которое уже загружено, кадр не меняется:
+    // конвейер пересчитывает только stage'и после измененных параметров
+    if (pauseCheckBox->isChecked() || (input.stillImage && input.hasFrame)) {
+        input.frameQueue->release(buffer);
+        return;
+    }
+    
+    // Уровень качества с пропуском кадров (планировщик - только для одного потока)
+    if (streams.size() == 1 && !scheduler->acceptFrame()) {
+        input.frameQueue->release(buffer);
+        return;
+    }
+    input.hasFrame = true;
+    
+    frangiWidget->setFrame(stream, buffer->view());
+    if (stream == 0) {
+        pendingArrival = buffer->arrivalTime;
+    }
+    
+    // Запись копирует кадр в свой буфер, файл пишет ее поток
+    if (stream == 0 && recorder->isOpen()) {
+        FrangiRecordParams params;
+        params.sigma = sigmaSlider->value() / 100.0f;
+        params.beta = betaSlider->value() / 100.0f;
+        params.c = cSlider->value() / 100.0f;
+        params.invert = invertCheckBox->isChecked();
+        params.multiScale = multiScaleCheckBox->isChecked();
+        recorder->submit(buffer->view(), params);
+    }
+    
+    // Время разбора кадра в потоке захвата относится к тому же кадру профайлера
+    FrangiProfiler *profiler = frangiWidget->profiler();
+    profiler->addCpuTime(FrangiProfiler::SectionCapture, buffer->captureTime);
+    profiler->addCpuTime(FrangiProfiler::SectionConvert, buffer->convertTime);
+    input.frameQueue->release(buffer);
+}
+
+void MainWindow::onCaptureStatsTimeout()
+{
+    // Счетчики всех потоков суммируются
+    QStringList statuses;
+    quint64 processed = 0;
+    quint64 dropped = 0;
+    for (const InputStream &stream : streams) {
+        statuses << stream.inputStatus;
+        processed += stream.frameQueue->processedCount();
+        dropped += stream.frameQueue->droppedCount();
+    }
+    QString message = QString("%1 | Frames processed: %2, dropped: %3")
+                      .arg(statuses.join(", "))
+                      .arg(processed)
+                      .arg(dropped);
+    if (recorder->isOpen()) {
+        message += QString(" | Recorded: %1, dropped: %2")
+                   .arg(recorder->recordedCount())
+                   .arg(recorder->droppedCount());
+    }
+    if (streams.size() == 1) {
+        const FrangiLatencyScheduler::Metrics metrics = scheduler->metrics();
+        message += QString(" | Latency p50 %1 / p90 %2 ms")
+                   .arg(metrics.latencyP50, 0, 'f', 1)
+                   .arg(metrics.latencyP90, 0, 'f', 1);
+        if (metrics.enabled) {
+            message += QString(", level %1 (%2), skipped %3, down %4 / up %5")
+                       .arg(metrics.level)
+                       .arg(metrics.quality.toString())
+                       .arg(metrics.skippedFrames)
+                       .arg(metrics.downgrades)
+                       .arg(metrics.upgrades);
+        }
+    }
+    const FrangiLatencyTracker *tracker = frangiWidget->latencyTracker();
+    const FrangiLatencyHistogram &present = tracker->histogram(FrangiLatencyTracker::CaptureToPresent);
+    if (present.count()) {
+        message += QString(" | Capture>present p50 %1 / p99 %2 ms")
+                   .arg(present.percentile(0.5), 0, 'f', 0)
+                   .arg(present.percentile(0.99), 0, 'f', 0);
+        const FrangiLatencyHistogram &glass = tracker->histogram(FrangiLatencyTracker::GlassToGlass);
+        if (glass.count()) {
+            message += QString(", glass-to-glass p50 %1 / p99 %2 ms")
+                       .arg(glass.percentile(0.5), 0, 'f', 0)
+                       .arg(glass.percentile(0.99), 0, 'f', 0);
         }
     }
+    if (stageComboBox->currentIndex() == FrangiPipeline::StageCenterline) {
+        const FrangiVesselGraph &graph = frangiWidget->vesselGraph();
+        message += QString(" | Graph: %1 nodes, %2 branches, length %3 px")
+                   .arg(graph.nodeCount())
+                   .arg(graph.branchCount())
+                   .arg(graph.totalLength(), 0, 'f', 0);
+    }
+    statusBar()->showMessage(message);
 }
 
 void MainWindow::onSigmaChanged(int value)
@@ -265,7 +528,138 @@ void MainWindow::onStageChanged(int index)
     frangiWidget->setDisplayStage(index);
 }
 
+void MainWindow::onPrecisionChanged(int index)
+{
+    frangiWidget->setPrecision(FrangiPrecision(index));
+}
+
 void MainWindow::onInvertToggled(bool checked)
 {
     frangiWidget->setInvertEnabled(checked);
+}
+
+void MainWindow::onMultiScaleToggled(bool checked)
+{
+    scheduler->setScaleCount(checked ? kMultiScaleCount : 0);
+    applyQualityLevel();
+    frangiWidget->setMultiScaleEnabled(checked);
+    
+    // Нормированный Hessian на порядки меньше single-scale, поэтому
+    // переставляем c на типичное значение для выбранного режима
+    cSlider->setValue(checked ? 10 : 1500);
+}
+
+void MainWindow::onTemporalToggled(bool checked)
+{
+    frangiWidget->setTemporalEnabled(checked);
+}
+
+void MainWindow::onComputeToggled(bool checked)
+{
+    frangiWidget->setComputeEnabled(checked);
+}
+
+void MainWindow::onPauseToggled(bool checked)
+{
+    Q_UNUSED(checked);
+    updateStillMode();
+}
+
+void MainWindow::onRoiToggled(bool checked)
+{
+    // Выключение ROI режима возвращает весь кадр
+    frangiWidget->setRoiSelectionEnabled(checked);
+}
+
+void MainWindow::onLatencyBudgetToggled(bool checked)
+{
+    // Выключенный планировщик возвращает полное качество
+    scheduler->setEnabled(checked);
+    applyQualityLevel();
+}
+
+void MainWindow::onLatencyBudgetChanged(int value)
+{
+    scheduler->setBudget(value);
+}
+
+void MainWindow::onFrameSwapped()
+{
+    // Перерисовки без нового кадра (параметры, stage) задержку не добавляют
+    if (!pendingArrival) return;
+    const double latency = (frangiMonotonicTime() - pendingArrival) / 1e6;
+    pendingArrival = 0;
+    if (scheduler->addLatency(latency)) {
+        applyQualityLevel();
+    }
+}
+
+void MainWindow::applyQualityLevel()
+{
+    // Масштабы остаются в диапазоне sigma 1-8, меняется только их число
+    const FrangiQualityLevel &quality = scheduler->quality();
+    frangiWidget->setProcessingDownscale(quality.downscale);
+    frangiWidget->setScaleRange(1.0f, 8.0f, quality.scaleCount > 0 ? quality.scaleCount : kMultiScaleCount);
+}
+
+void MainWindow::setLatencyBudget(double milliseconds)
+{
+    // Планировщик работает только с одним потоком
+    latencyBudgetSpinBox->setValue(qRound(milliseconds));
+    latencyBudgetCheckBox->setChecked(streams.size() == 1);
+}
+
+void MainWindow::setLatencyTestEnabled(bool enabled)
+{
+    // Камеры принесут шаблон с экрана сами, файловые источники вписывают его
+    frangiWidget->setLatencyPatternEnabled(enabled);
+    for (const InputStream &stream : streams) {
+        stream.captureWorker->setLatencyPatternEnabled(enabled);
+    }
+    frangiWidget->latencyTracker()->clear();
+}
+
+void MainWindow::setComputeEnabled(bool enabled)
+{
+    computeCheckBox->setChecked(enabled);
+}
+
+void MainWindow::updateStillMode()
+{
+    // Промежуточные stage'и стоит хранить, только пока ни один поток не присылает новые кадры
+    bool still = pauseCheckBox->isChecked();
+    if (!still) {
+        still = true;
+        for (const InputStream &stream : streams) {
+            still = still && stream.stillImage;
+        }
+    }
+    frangiWidget->setStillMode(still);
+}
+
+void MainWindow::onProfilingToggled(bool checked)
+{
+    // Профайлер остается включенным, пока пишется CSV
+    frangiWidget->setProfilingEnabled(checked || profilingCsv);
+    frangiWidget->setHudVisible(checked);
+}
+
+bool MainWindow::startRecording(const QString &path)
+{
+    // Частота камеры не известна заранее, при воспроизведении есть timestamp'ы
+    // кадров. Vesselness не пишется: ее повторяет воспроизведение записи
+    if (!recorder->open(path, false)) {
+        qDebug() << "Failed to start recording:" << recorder->errorString();
+        return false;
+    }
+    return true;
+}
+
+bool MainWindow::startProfileCsv(const QString &path)
+{
+    if (!frangiWidget->profiler()->startCsv(path)) return false;
+    
+    profilingCsv = true;
+    frangiWidget->setProfilingEnabled(true);
+    return true;
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <QLabel>
 #include <QComboBox>
 #include <QCheckBox>
+#include <QSpinBox>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QMediaCaptureSession>
@@ -15,32 +16,91 @@
 #include <QMediaDevices>
 #include <QVideoSink>
 #include <QVideoFrame>
+#include <QMediaPlayer>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <QStringList>
 #include "frangiglwidget.h"
+#include "frangiframequeue.h"
+#include "captureworker.h"
+#include "frangirecording.h"
+#include "frangischeduler.h"
 
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
 
 public:
-    MainWindow(QWidget *parent = nullptr);
+    // inputs: по источнику на поток - camera, camera:N, видео файл, Y4M поток,
+    // изображение или каталог изображений. Несколько потоков показываются сеткой
+    explicit MainWindow(const QStringList &inputs = QStringList(), QWidget *parent = nullptr);
     ~MainWindow();
 
+    // Время stage'ей по кадрам в CSV (включает профайлер без HUD)
+    bool startProfileCsv(const QString &path);
+    // Запись кадров потока 0 с параметрами фильтра в *.frec (см. FrangiRecorder)
+    bool startRecording(const QString &path);
+    // Планировщик качества под бюджет задержки кадра (см. FrangiLatencyScheduler)
+    void setLatencyBudget(double milliseconds);
+    // Тестовый режим задержки glass-to-glass: шаблон времени на экране и в
+    // кадрах файловых источников (см. FrangiGLWidget::setLatencyPatternEnabled)
+    void setLatencyTestEnabled(bool enabled);
+    // Compute blur в GL конвейере (GL 4.3+, иначе fragment шейдеры)
+    void setComputeEnabled(bool enabled);
+
 private slots:
     void onButton1Clicked();
     void onButton2Clicked();
-    void onVideoFrameChanged(const QVideoFrame &frame);
+    void onCaptureFrameReady(int stream);
+    void onCaptureStatsTimeout();
+    void onFrameSwapped();
     void onSigmaChanged(int value);
     void onBetaChanged(int value);
     void onCChanged(int value);
     void onStageChanged(int index);
     void onInvertToggled(bool checked);
+    void onMultiScaleToggled(bool checked);
+    void onTemporalToggled(bool checked);
+    void onComputeToggled(bool checked);
+    void onProfilingToggled(bool checked);
+    void onPrecisionChanged(int index);
+    void onPauseToggled(bool checked);
+    void onRoiToggled(bool checked);
+    void onLatencyBudgetToggled(bool checked);
+    void onLatencyBudgetChanged(int value);
 
 private:
-    QCamera *camera;
+    // Источник кадров одного потока
+    struct InputStream {
+        QCamera *camera = nullptr;
+        QMediaPlayer *mediaPlayer = nullptr;  // Для видео файлов
+        QMediaCaptureSession *captureSession = nullptr;
+        QVideoSink *videoSink = nullptr;
+        
+        // Разбор кадров в отдельном потоке и очередь кадров для GUI потока
+        QThread *captureThread = nullptr;
+        CaptureWorker *captureWorker = nullptr;
+        FrangiFrameQueue *frameQueue = nullptr;
+        QString inputStatus;  // Имя источника или ошибка открытия для статусной строки
+        bool stillImage = false;  // Одно изображение: нужен только первый кадр
+        bool hasFrame = false;
+    };
+
+    void createStream(const QString &input);
+    bool startInput(InputStream &stream, const QString &input);
+    bool startCamera(InputStream &stream, int index);
+    void updateStillMode();
+    void applyQualityLevel();
+
     FrangiGLWidget *frangiWidget;
-    QLabel *rawVideoLabel;  // Для отображения исходного видео
-    QMediaCaptureSession *captureSession;
-    QVideoSink *videoSink;
+    QVector<InputStream> streams;
+    QTimer *captureStatsTimer;
+    bool profilingCsv;    // Профайлер пишет CSV (--profile-csv)
+    FrangiRecorder *recorder;  // Запись кадров (--record)
+    // Уровень качества под бюджет задержки и приход кадра, который еще не показан
+    FrangiLatencyScheduler *scheduler;
+    qint64 pendingArrival;
     QPushButton *button1;
     QPushButton *button2;
     
@@ -52,7 +112,16 @@ private:
     QLabel *betaLabel;
     QLabel *cLabel;
     QComboBox *stageComboBox;
+    QComboBox *precisionComboBox;
     QCheckBox *invertCheckBox;
+    QCheckBox *multiScaleCheckBox;
+    QCheckBox *temporalCheckBox;
+    QCheckBox *computeCheckBox;
+    QCheckBox *profilingCheckBox;
+    QCheckBox *pauseCheckBox;
+    QCheckBox *roiCheckBox;
+    QCheckBox *latencyBudgetCheckBox;
+    QSpinBox *latencyBudgetSpinBox;
 };
 
 #endif // MAINWINDOW_H
\ No newline at end of file
@@ -0,0 +1,431 @@
+#include "offlinerunner.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+#include <algorithm>
+#include <cstring>
+#include "frangiframesource.h"
+#include "frangirecording.h"
+#include "frangireference.h"
+#include "frangitiledprocessor.h"
+#include "frangivesselgraph.h"
+
+namespace {
+
+// Параметры записи при воспроизведении *.frec
+void applyRecordParams(FrangiEngine &engine, const FrangiRecordParams &params)
+{
+    engine.setSigma(params.sigma);
+    engine.setBeta(params.beta);
+    engine.setC(params.c);
+    engine.setGamma(params.gamma);
+    engine.setInvertEnabled(params.invert);
+    engine.setScaleRange(params.minScale, params.maxScale, params.scaleCount);
+    engine.setMultiScaleEnabled(params.multiScale);
+}
+
+// Ветви графа с координатами узлов (пусто у контура без узлов),
+// точки "x y" через ";", строки кадра сверху вниз
+bool writeGraphCsv(const QString &path, const FrangiVesselGraph &graph)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+    
+    QTextStream stream(&file);
+    stream << "branch,from,to,from_x,from_y,to_x,to_y,length,radius,points\n";
+    const QVector<FrangiVesselNode> &nodes = graph.nodes();
+    const QVector<FrangiVesselBranch> &branches = graph.branches();
+    for (int i = 0; i < branches.size(); ++i) {
+        const FrangiVesselBranch &branch = branches[i];
+        if (!branch.valid) continue;
+        
+        QStringList ends;
+        for (int node : { branch.from, branch.to }) {
+            if (node < 0) {
+                ends << QString() << QString();
+            } else {
+                ends << QString::number(nodes[node].position.x(), 'f', 1)
+                     << QString::number(nodes[node].position.y(), 'f', 1);
+            }
+        }
+        QStringList points;
+        for (const QPoint &point : branch.points) {
+            points << QString("%1 %2").arg(point.x()).arg(point.y());
+        }
+        stream << i << ',' << branch.from << ',' << branch.to << ',' << ends.join(',') << ','
+               << QString::number(branch.length, 'f', 2) << ',' << QString::number(branch.radius, 'f', 2)
+               << ',' << points.join(';') << '\n';
+    }
+    return true;
+}
+
+} // namespace
+
+int runOffline(const OfflineOptions &options)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    
+    if (!FrangiFrameSource::canOpen(options.input)) {
+        // QMediaPlayer отдает кадры только в темпе воспроизведения,
+        // поэтому для замеров видео нужно сначала распаковать в Y4M
+        if (QFileInfo(options.input).isFile()) {
+            err << "Video files are not supported without display, convert to Y4M first:\n"
+                << "  ffmpeg -i " << options.input << " -pix_fmt yuv420p frames.y4m\n";
+        } else {
+            err << "Input must be a Y4M stream, an image or a directory of images: "
+                << options.input << "\n";
+        }
+        return 1;
+    }
+    
+    QString error;
+    FrangiFrameSource *source = FrangiFrameSource::open(options.input, &error);
+    if (!source) {
+        err << error << "\n";
+        return 1;
+    }
+    
+    FrangiEngine engine;
+    engine.setBackend(options.backend);
+    if (!engine.initialize()) {
+        err << "Failed to initialize FrangiEngine\n";
+        delete source;
+        return 1;
+    }
+    
+    // Параметры по умолчанию, как у ползунков MainWindow
+    engine.setSigma(1.5f);
+    engine.setBeta(0.5f);
+    engine.setInvertEnabled(true);
+    engine.setPrecision(options.precision);
+    engine.setComputeEnabled(options.compute);
+    if (options.multiScale) {
+        engine.setScaleRange(1.0f, 8.0f, 5);
+        engine.setMultiScaleEnabled(true);
+        engine.setC(0.1f);
+    } else {
+        engine.setC(15.0f);
+    }
+    engine.setTemporalEnabled(options.temporal);
+    engine.setCenterlineEnabled(!options.centerlineCsv.isEmpty());
+    
+    // Запись повторяет свои параметры кадр за кадром и сверяет результат
+    FrangiRecordingSource *recording = dynamic_cast<FrangiRecordingSource *>(source);
+    FrangiRecordParams lastParams;
+    bool paramsApplied = false;
+    double replayMaxError = 0.0;
+    int replayCompared = 0;
+    
+    FrangiRecordParams params;
+    params.multiScale = options.multiScale;
+    params.c = options.multiScale ? 0.1f : 15.0f;
+    FrangiRecorder recorder;
+    if (!options.recordPath.isEmpty() && !recorder.open(options.recordPath, true, source->frameRate())) {
+        err << recorder.errorString() << "\n";
+        delete source;
+        return 1;
+    }
+    
+    FrangiFrameView frame;
+    
+    // Прогрев: шейдеры, FBO и пулы потоков создаются на первом кадре
+    if (options.benchmark) {
+        if (source->read(&frame)) {
+            engine.process(frame);
+        }
+        source->rewind();
+    }
+    
+    // Профайлер включается после прогрева, чтобы не учитывать компиляцию шейдеров
+    FrangiProfiler *profiler = engine.profiler();
+    if (options.benchmark || !options.profileCsv.isEmpty()) {
+        profiler->setEnabled(true);
+    }
+    if (!options.profileCsv.isEmpty() && !profiler->startCsv(options.profileCsv)) {
+        err << "Cannot write profile CSV: " << options.profileCsv << "\n";
+    }
+    
+    QVector<double> frameTimes;
+    QElapsedTimer total;
+    QElapsedTimer timer;
+    total.start();
+    for (int loop = 0; loop < qMax(1, options.loops); ++loop) {
+        if (loop > 0 && !source->rewind()) break;
+        
+        while (true) {
+            timer.start();
+            if (!source->read(&frame)) break;
+            if (recording && (!paramsApplied ||
+                              std::memcmp(&lastParams, &recording->record()->params, sizeof(lastParams)) != 0)) {
+                lastParams = recording->record()->params;
+                applyRecordParams(engine, lastParams);
+                paramsApplied = true;
+            }
+            const FrangiVesselnessMap map = engine.process(frame);
+            frameTimes.append(timer.nsecsElapsed() / 1e6);
+            
+            if (recorder.isOpen()) {
+                recorder.submit(frame, paramsApplied ? lastParams : params,
+                                map.isNull() ? nullptr : map.data.constData());
+            }
+            if (recording && recording->vesselness() && !map.isNull()) {
+                const float *recorded = recording->vesselness();
+                for (int i = 0; i < map.data.size(); ++i) {
+                    replayMaxError = qMax(replayMaxError, double(qAbs(map.data[i] - recorded[i])));
+                }
+                ++replayCompared;
+            }
+        }
+        if (!source->errorString().isEmpty()) {
+            err << source->errorString() << "\n";
+            break;
+        }
+    }
+    const double seconds = total.nsecsElapsed() / 1e9;
+    delete source;
+    recorder.close();
+    
+    engine.flushProfiler();
+    profiler->stopCsv();
+    
+    if (frameTimes.isEmpty()) {
+        err << "No frames processed\n";
+        return 1;
+    }
+    
+    const char *backendName = engine.backend() == FrangiEngine::BackendCpu ? "CPU" : "OpenGL";
+    out << "Input: " << options.input << ", backend: " << backendName
+        << (options.multiScale ? ", multi-scale" : "") << (options.temporal ? ", temporal" : "")
+        << (options.compute && engine.isComputeAvailable() ? ", compute blur" : "") << "\n";
+    out << "Frames: " << frameTimes.size() << ", time: " << QString::number(seconds, 'f', 3)
+        << " s, fps: " << QString::number(frameTimes.size() / seconds, 'f', 1) << "\n";
+    if (!options.recordPath.isEmpty()) {
+        out << "Recorded: " << recorder.recordedCount() << " frames to " << options.recordPath
+            << ", dropped: " << recorder.droppedCount() << "\n";
+    }
+    if (!options.centerlineCsv.isEmpty()) {
+        const FrangiVesselGraph &graph = engine.vesselGraph();
+        out << "Graph: " << graph.nodeCount() << " nodes, " << graph.branchCount() << " branches, total length "
+            << QString::number(graph.totalLength(), 'f', 1) << " px\n";
+        if (!writeGraphCsv(options.centerlineCsv, graph)) {
+            err << "Cannot write graph CSV: " << options.centerlineCsv << "\n";
+        }
+    }
+    if (replayCompared > 0) {
+        out << "Replay: " << replayCompared << " frames, max difference from recorded vesselness "
+            << QString::number(replayMaxError, 'e', 2) << "\n";
+    }
+    
+    // Время кадра включает чтение и декодирование файла
+    if (options.benchmark) {
+        double sum = 0.0;
+        for (double time : frameTimes) {
+            sum += time;
+        }
+        out << "Frame time (ms): min " << QString::number(*std::min_element(frameTimes.begin(), frameTimes.end()), 'f', 2)
+            << ", mean " << QString::number(sum / frameTimes.size(), 'f', 2)
+            << ", max " << QString::number(*std::max_element(frameTimes.begin(), frameTimes.end()), 'f', 2) << "\n";
+        
+        // Stage'и по последним FrangiProfiler::kWindowSize кадрам
+        out << "Stage (ms)      p50      p95      p99\n";
+        for (int section = 0; section < FrangiProfiler::SectionCount; ++section) {
+            const FrangiProfiler::Stats stats = profiler->stats(FrangiProfiler::Section(section));
+            if (stats.count == 0) continue;
+            out << QString("%1 %2 %3 %4\n")
+                   .arg(FrangiProfiler::sectionName(FrangiProfiler::Section(section)), -12)
+                   .arg(stats.p50, 8, 'f', 3)
+                   .arg(stats.p95, 8, 'f', 3)
+                   .arg(stats.p99, 8, 'f', 3);
+        }
+        if (engine.backend() != FrangiEngine::BackendCpu && !profiler->gpuTimingAvailable()) {
+            out << "GPU timer queries are not available, GPU stages are not measured\n";
+        }
+    }
+    return 0;
+}
+
+namespace {
+
+// Конвейер под проверкой и допуски относительно эталона
+struct ValidationConfig
+{
+    const char *name;
+    FrangiEngine::Backend backend;
+    bool compute;
+    bool fused;
+    FrangiPrecision precision;
+    double maxError;
+    double minPsnr;
+};
+
+// Fragment blur берет пары texel'ей аппаратной билинейной выборкой
+// (~8 бит дробной части), поэтому его допуск шире. Half FBO дают до ~2e-3
+// (оценка округлением эталона, см. FrangiPrecision)
+const ValidationConfig kValidationConfigs[] = {
+    { "gl-fragment", FrangiEngine::BackendOpenGL, false, false, FrangiPrecisionBalanced, 5e-3, 55.0 },
+    { "gl-compute", FrangiEngine::BackendOpenGL, true, false, FrangiPrecisionBalanced, 1e-3, 70.0 },
+    { "gl-fused", FrangiEngine::BackendOpenGL, true, true, FrangiPrecisionBalanced, 1e-3, 70.0 },
+    { "gl-full", FrangiEngine::BackendOpenGL, true, false, FrangiPrecisionFull, 1e-3, 70.0 },
+    { "gl-half", FrangiEngine::BackendOpenGL, true, false, FrangiPrecisionHalf, 3e-3, 65.0 },
+    { "cpu", FrangiEngine::BackendCpu, false, false, FrangiPrecisionFull, 1e-4, 90.0 }
+};
+
+// Пик vesselness может сместиться от оси не больше, чем у эталона, плюс полпикселя
+const double kCenterlineTolerance = 0.5;
+
+const int kTimingFrames = 30;
+
+} // namespace
+
+int runValidation(const OfflineOptions &options)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    
+    const QVector<FrangiPhantom> phantoms = frangiStandardPhantoms(256);
+    const FrangiPhantom timingPhantom = frangiStandardPhantoms(640).first();
+    
+    // Параметры по умолчанию, как у ползунков MainWindow
+    FrangiReferenceParams params;
+    QVector<QVector<double>> references;
+    QVector<double> referenceOffsets;
+    for (const FrangiPhantom &phantom : phantoms) {
+        references.append(frangiReferenceVesselness(phantom.image, params));
+        referenceOffsets.append(frangiCenterlineOffset(references.last(), phantom));
+    }
+    
+    FrangiEngine glEngine;
+    FrangiEngine cpuEngine;
+    glEngine.setBackend(FrangiEngine::BackendOpenGL);
+    cpuEngine.setBackend(FrangiEngine::BackendCpu);
+    bool glAvailable = false;
+    if (options.backend != FrangiEngine::BackendCpu) {
+        glAvailable = glEngine.initialize();
+        if (!glAvailable) {
+            err << "OpenGL backend is not available"
+                << (options.backend == FrangiEngine::BackendOpenGL ? "\n" : ", validating CPU only\n");
+            if (options.backend == FrangiEngine::BackendOpenGL) return 1;
+        }
+    }
+    if (options.backend != FrangiEngine::BackendOpenGL && !cpuEngine.initialize()) {
+        err << "Failed to initialize CPU backend\n";
+        return 1;
+    }
+    
+    bool passed = true;
+    out << QString("%1 %2 %3 %4 %5\n")
+           .arg("config", -12).arg("phantom", -13).arg("max error", 10).arg("PSNR dB", 8).arg("offset px", 10);
+    for (const ValidationConfig &config : kValidationConfigs) {
+        FrangiEngine &engine = config.backend == FrangiEngine::BackendCpu ? cpuEngine : glEngine;
+        if (!engine.isInitialized()) continue;
+        if (config.compute && !engine.isComputeAvailable()) {
+            out << config.name << ": compute shaders are not available, skipped\n";
+            continue;
+        }
+        
+        engine.setSigma(float(params.sigma));
+        engine.setBeta(float(params.beta));
+        engine.setC(float(params.c));
+        engine.setInvertEnabled(params.invert);
+        engine.setComputeEnabled(config.compute);
+        engine.setFusedEnabled(config.fused);
+        engine.setPrecision(config.precision);
+        
+        for (int i = 0; i < phantoms.size(); ++i) {
+            const FrangiVesselnessMap map = engine.process(phantoms[i].image);
+            const FrangiReferenceError error = frangiCompareVesselness(map.data, references[i], phantoms[i]);
+            const bool ok = error.maxError <= config.maxError && error.psnr >= config.minPsnr &&
+                            error.centerlineOffset <= referenceOffsets[i] + kCenterlineTolerance;
+            passed = passed && ok;
+            out << QString("%1 %2 %3 %4 %5 %6\n")
+                   .arg(config.name, -12)
+                   .arg(phantoms[i].name, -13)
+                   .arg(error.maxError, 10, 'e', 2)
+                   .arg(error.psnr, 8, 'f', 1)
+                   .arg(error.centerlineOffset, 10, 'f', 2)
+                   .arg(ok ? "ok" : "FAIL");
+        }
+        
+        // Время кадра после прогрева (шейдеры и FBO под разрешение)
+        engine.process(timingPhantom.image);
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < kTimingFrames; ++i) {
+            engine.process(timingPhantom.image);
+        }
+        const double frameTime = timer.nsecsElapsed() / 1e6 / kTimingFrames;
+        const bool inBudget = options.frameBudget <= 0.0 || frameTime <= options.frameBudget;
+        passed = passed && inBudget;
+        out << config.name << ": " << QString::number(frameTime, 'f', 2) << " ms/frame at "
+            << timingPhantom.image.width() << "x" << timingPhantom.image.height();
+        if (options.frameBudget > 0.0) {
+            out << ", budget " << QString::number(options.frameBudget, 'f', 2) << " ms "
+                << (inBudget ? "ok" : "FAIL");
+        }
+        out << "\n";
+    }
+    
+    out << (passed ? "Validation passed\n" : "Validation FAILED\n");
+    return passed ? 0 : 1;
+}
+
+int runTiled(const OfflineOptions &options)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    
+    FrangiEngine engine;
+    engine.setBackend(options.backend);
+    if (!engine.initialize()) {
+        err << "Failed to initialize FrangiEngine\n";
+        return 1;
+    }
+    
+    // Параметры по умолчанию, как у ползунков MainWindow
+    engine.setSigma(1.5f);
+    engine.setBeta(0.5f);
+    engine.setInvertEnabled(true);
+    engine.setPrecision(options.precision);
+    engine.setComputeEnabled(options.compute);
+    if (options.multiScale) {
+        engine.setScaleRange(1.0f, 8.0f, 5);
+        engine.setMultiScaleEnabled(true);
+        engine.setC(0.1f);
+    } else {
+        engine.setC(15.0f);
+    }
+    
+    FrangiTiledProcessor processor(&engine);
+    processor.setTileSize(options.tileSize);
+    if (!processor.open(options.input)) {
+        err << processor.errorString() << "\n";
+        return 1;
+    }
+    processor.setProgressCallback([&out](int tile, int tileCount) {
+        out << "\rTile " << tile << "/" << tileCount << Qt::flush;
+    });
+    
+    QElapsedTimer timer;
+    timer.start();
+    const bool ok = processor.process(options.tiledOutput);
+    const double seconds = timer.nsecsElapsed() / 1e9;
+    out << "\n";
+    if (!ok) {
+        err << processor.errorString() << "\n";
+        return 1;
+    }
+    
+    const QSize size = processor.imageSize();
+    const char *backendName = engine.backend() == FrangiEngine::BackendCpu ? "CPU" : "OpenGL";
+    out << "Input: " << options.input << " (" << size.width() << "x" << size.height()
+        << "), backend: " << backendName << (options.multiScale ? ", multi-scale" : "") << "\n";
+    out << "Tiles: " << processor.tileCount() << ", apron: " << processor.apron()
+        << " px, time: " << QString::number(seconds, 'f', 3) << " s, "
+        << QString::number(double(size.width()) * size.height() / seconds / 1e6, 'f', 1) << " Mpix/s\n";
+    out << "Output: " << options.tiledOutput << "\n";
+    return 0;
+}
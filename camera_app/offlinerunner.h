@@ -0,0 +1,43 @@
+#ifndef OFFLINERUNNER_H
+#define OFFLINERUNNER_H
+
+#include <QString>
+#include "frangiengine.h"
+
+// Параметры обработки файлов без окна (--no-display / --benchmark)
+struct OfflineOptions
+{
+    QString input;
+    FrangiEngine::Backend backend = FrangiEngine::BackendAuto;
+    int loops = 1;
+    bool benchmark = false;   // прогрев и статистика времени кадра
+    bool multiScale = false;
+    bool temporal = false;    // усреднение vesselness по кадрам
+    bool compute = false;     // compute blur в GL backend'е (GL 4.3+)
+    FrangiPrecision precision = FrangiPrecisionBalanced;
+    QString profileCsv;       // время stage'ей по кадрам, пусто - без CSV
+    QString recordPath;       // запись кадров и vesselness в *.frec, пусто - без записи
+    QString centerlineCsv;    // скелет и граф сосудов, ветви последнего кадра в CSV
+    double frameBudget = 0.0; // --validate: предел среднего времени кадра, мс (0 - без проверки)
+    QString tiledOutput;      // --tiled: PFM с vesselness
+    int tileSize = 2048;      // --tiled: сторона тайла без поля
+};
+
+// Обрабатывает все кадры источника через FrangiEngine так быстро, как
+// позволяет backend (без привязки к частоте кадров файла), и печатает fps.
+// Запись *.frec воспроизводится со своими параметрами, а результат сверяется
+// с записанной vesselness. Возвращает код завершения процесса. Требует QGuiApplication
+int runOffline(const OfflineOptions &options);
+
+// Сравнивает GL (fragment blur, compute blur, fused, точность FBO) и CPU конвейеры
+// с эталоном в double на синтетических фантомах (FrangiReference):
+// max ошибка, PSNR и смещение пика от оси трубок, плюс среднее время кадра
+// 640x640 против frameBudget. backend выбирает проверяемые конвейеры
+// (auto - все доступные). Возвращает 0, если все проверки прошли
+int runValidation(const OfflineOptions &options);
+
+// Обрабатывает PGM/PPM любого размера тайлами (FrangiTiledProcessor) и пишет
+// vesselness в PFM tiledOutput. Возвращает код завершения процесса
+int runTiled(const OfflineOptions &options);
+
+#endif // OFFLINERUNNER_H